@@ -0,0 +1,16 @@
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = hexdump_bench
+TEMPLATE = app
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    main.cpp \
+    ../../src/hexdump.cpp
+
+HEADERS += \
+    ../../src/hexdump.h
@@ -0,0 +1,138 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+/*
+ * Compares cost of hexadecimal dump of received data:
+ *  - QString per byte: former Console::dumpBuf(), QString::asprintf() and
+ *    QString concatenation for every character,
+ *  - HexDump: digits from table, ASCII column 16 bytes at a time, rows
+ *    written into a preallocated buffer.
+ * Former dumpBuf() dropped the result of the static asprintf(), here it is
+ * assigned, so the outputs can be compared. Cost of the call is the same.
+ *
+ * Usage: hexdump_bench [bytes]
+ */
+#include <QCoreApplication>
+#include <QElapsedTimer>
+#include <QTextStream>
+#include <QStringList>
+
+#include "hexdump.h"
+
+static QString dumpBufQString(const QByteArray &buf, int hexWrap)
+{
+    QString str;
+    QString str2;
+    int i, j, s;
+    int bufSize = buf.length ();
+
+    /* Extend buffer size to be dividable with hexWrap */
+    if (bufSize % hexWrap == 0)
+    {
+        s = bufSize;
+    }
+    else
+    {
+        s = bufSize + hexWrap - (bufSize % hexWrap);
+    }
+    for (i = 0; i < s; i++)
+    {
+        /* Print buffer in hexadecimal format */
+        if (i < bufSize)
+        {
+            str2 = QString::asprintf ("%02X", (quint8) buf[i]);
+            str += str2;
+        }
+        else
+        {
+            str += "  ";
+        }
+        str += " ";
+        if ((i + 1) % hexWrap == 0)
+        {
+            /* Print buffer in ASCII format */
+            str += "  ";
+            for (j = i - (hexWrap - 1); j <= i; j++)
+            {
+                if (j < bufSize)
+                {
+                    if ((quint8) buf[j] >= 0x20u && (quint8)buf[j] <= 0x7Fu)
+                    {
+                        str += buf[j];
+                    }
+                    else
+                    {
+                        str += ".";
+                    }
+                }
+                else
+                {
+                    str += " ";
+                }
+            }
+            str += "\n";
+        }
+    }
+
+    return str;
+}
+
+static void report(QTextStream &out, const char *name, int hexWrap, qint64 elapsed_ns, int bytes)
+{
+    out << QString("%1 wrap %2: %3 ns/byte, %4 MiB/s")
+           .arg(QString::fromLatin1(name), -20)
+           .arg(hexWrap, 4)
+           .arg(static_cast<double>(elapsed_ns) / bytes, 8, 'f', 2)
+           .arg(bytes / 1048576.0 / (qMax<qint64>(elapsed_ns, 1) / 1e9), 8, 'f', 1)
+        << "\n";
+    out.flush();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    int bytes = args.size() > 1 ? args.at(1).toInt() : 4 * 1024 * 1024;
+    QTextStream out(stdout);
+    QElapsedTimer timer;
+    QByteArray data;
+    const int hexWraps[] = { 16, 1024 };
+
+    if (bytes <= 0)
+    {
+        bytes = 4 * 1024 * 1024;
+    }
+    /* Mix of printable text and binary, last row is partial */
+    bytes += 7;
+    data.resize(bytes);
+    for (int i = 0; i < bytes; i++)
+    {
+        data[i] = static_cast<char>(i % 3 ? 0x20 + (i * 7) % 95 : (i * 131) & 0xFF);
+    }
+    out << "bytes: " << bytes << "\n";
+    out.flush();
+
+    for (size_t w = 0; w < sizeof(hexWraps) / sizeof(hexWraps[0]); w++)
+    {
+        int hexWrap = hexWraps[w];
+
+        timer.start();
+        QByteArray reference = dumpBufQString(data, hexWrap).toLatin1();
+        report(out, "QString per byte", hexWrap, timer.nsecsElapsed(), bytes);
+
+        QByteArray buf;
+        timer.start();
+        HexDump::appendRows(buf, data.constData(), data.size(), hexWrap);
+        report(out, "HexDump", hexWrap, timer.nsecsElapsed(), bytes);
+        if (buf != reference)
+        {
+            out << "ERROR: output differs from QString per byte\n";
+            return 1;
+        }
+    }
+
+    return 0;
+}
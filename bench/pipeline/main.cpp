@@ -0,0 +1,316 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+/*
+ * End-to-end receive pipeline: pseudo-terminal -> SerialThread ->
+ * MainWindow-like drain -> Console::putData(). A generator writes numbered
+ * lines to the slave side of the "pty" port at the rate of the given baud
+ * rate (10 bits per byte).
+ *
+ * Per case it reports sustained throughput, latency percentiles (written to
+ * pty until read from port, and until shown by console), data not arrived
+ * and peak memory. Result is JSON, so runs of different builds can be
+ * compared.
+ *
+ * Usage: pipeline_bench [--duration ms] [--bauds list] [--lines list]
+ *                       [--modes plain,timestamp,hex] [--output file.json]
+ *
+ * Console is a widget: QT_QPA_PLATFORM=offscreen is used unless set.
+ */
+#include <QApplication>
+#include <QCommandLineParser>
+#include <QEventLoop>
+#include <QTimer>
+#include <QFile>
+#include <QJsonArray>
+#include <QJsonDocument>
+#include <QJsonObject>
+#include <QTextStream>
+#include <QSettings>
+
+#include <algorithm>
+
+#include <fcntl.h>
+#include <unistd.h>
+
+#include "pipelinebench.h"
+#include "ptyportbackend.h"
+#include "serialsettings.h"
+#include "serialthread.h"
+#include "console.h"
+#include "version.h"
+
+/** Time to wait for data still in the pipeline when generator stopped. */
+static const int drainTimeout_ms = 5000;
+
+#if QT_VERSION >= 0x050E00
+static const Qt::SplitBehavior skipEmptyParts = Qt::SkipEmptyParts;
+#else
+static const QString::SplitBehavior skipEmptyParts = QString::SkipEmptyParts;
+#endif
+
+/**
+ * @brief readStatusValue_kB
+ * @return Value of a "kB" field of /proc/self/status, -1 if not available.
+ */
+static qint64 readStatusValue_kB(const char *name)
+{
+    QFile file("/proc/self/status");
+    if (!file.open(QFile::ReadOnly))
+    {
+        return -1;
+    }
+    foreach (const QByteArray &line, file.readAll().split('\n'))
+    {
+        if (line.startsWith(name))
+        {
+            return line.mid(static_cast<int>(strlen(name))).trimmed().split(' ').first().toLongLong();
+        }
+    }
+    return -1;
+}
+
+/** Resets peak RSS (VmHWM), so it can be measured per case. */
+static void resetPeakMemory()
+{
+    QFile file("/proc/self/clear_refs");
+    if (file.open(QFile::WriteOnly))
+    {
+        file.write("5");
+    }
+}
+
+static QJsonObject percentiles_us(QVector<qint64> samples)
+{
+    QJsonObject result;
+    const double ranks[] = { 50.0, 90.0, 99.0, 99.9 };
+    const char *names[] = { "p50", "p90", "p99", "p999" };
+
+    result["samples"] = samples.size();
+    if (samples.isEmpty())
+    {
+        return result;
+    }
+    std::sort(samples.begin(), samples.end());
+    for (int i = 0; i < 4; i++)
+    {
+        int idx = qMin(static_cast<int>(samples.size() * ranks[i] / 100.0), samples.size() - 1);
+        result[names[i]] = static_cast<double>(samples.at(idx)) / 1000.0;
+    }
+    result["max"] = static_cast<double>(samples.last()) / 1000.0;
+    return result;
+}
+
+/**
+ * @brief waitForOpen
+ * Runs event loop until port is opened or closed.
+ */
+static bool waitForOpen(SerialThread *serialThread, bool opened, int timeout_ms)
+{
+    QEventLoop loop;
+    QTimer timer;
+    int elapsed_ms = 0;
+
+    timer.setInterval(10);
+    QObject::connect(&timer, SIGNAL(timeout()), &loop, SLOT(quit()));
+    timer.start();
+    while (serialThread->isOpen() != opened && elapsed_ms < timeout_ms)
+    {
+        loop.exec();
+        elapsed_ms += 10;
+    }
+    return serialThread->isOpen() == opened;
+}
+
+static QJsonObject runCase(qint32 baudRate, int lineLength, const QString &mode, int duration_ms, qint64 readyReadInterval_us)
+{
+    QJsonObject result;
+    SerialSettings serialSettings;
+    Console console;
+
+    result["baudRate"] = baudRate;
+    result["lineLength"] = lineLength;
+    result["mode"] = mode;
+    result["duration_ms"] = duration_ms;
+
+    console.resize(800, 600);
+    console.setDisplayHexValuesEnabled(mode.contains("hex"));
+    console.setDisplayTimestampEnabled(mode.contains("timestamp"));
+    console.show();
+
+    serialSettings.m_serialSettings.name = "pty";
+    serialSettings.m_serialSettings.baudRate = baudRate;
+    SerialThread serialThread(NULL, &serialSettings);
+    if (readyReadInterval_us >= 0)
+    {
+        serialThread.setReadyReadInterval_us(readyReadInterval_us);
+    }
+    result["readyReadInterval_us"] = serialThread.readyReadInterval_us();
+    serialThread.startIo(QThread::NormalPriority);
+    serialThread.open(QIODevice::ReadWrite);
+    if (!waitForOpen(&serialThread, true, 2000))
+    {
+        result["error"] = QString("cannot open pty");
+        return result;
+    }
+    PtyPortBackend *pty = qobject_cast<PtyPortBackend *>(serialThread.getSerialPort());
+    int fd = pty ? ::open(pty->slaveName().toLocal8Bit().constData(), O_WRONLY | O_NOCTTY | O_NONBLOCK | O_CLOEXEC) : -1;
+    if (fd < 0)
+    {
+        result["error"] = QString("cannot open pty slave");
+        serialThread.stop(1000);
+        return result;
+    }
+
+    qint64 rate_Bps = baudRate / 10;
+    QVector<qint64> sendTimes(static_cast<int>(rate_Bps * duration_ms / 1000 / lineLength + 16));
+    Generator generator(fd, rate_Bps, lineLength, duration_ms, &sendTimes);
+    Receiver receiver(&serialThread, &console, &generator, &sendTimes, lineLength);
+    QObject::connect(&serialThread, SIGNAL(readyRead()), &receiver, SLOT(readData()));
+
+    resetPeakMemory();
+    qint64 start_ns = monotonicTime_ns();
+    generator.start(QThread::HighPriority);
+
+    /* Run GUI until generator finished and pipeline is drained */
+    QEventLoop loop;
+    QTimer timer;
+    qint64 stopped_ns = 0;
+    timer.setInterval(10);
+    QObject::connect(&timer, SIGNAL(timeout()), &loop, SLOT(quit()));
+    timer.start();
+    for (;;)
+    {
+        loop.exec();
+        receiver.readData();
+        if (generator.isFinished())
+        {
+            if (stopped_ns == 0)
+            {
+                stopped_ns = monotonicTime_ns();
+            }
+            if (receiver.bytesReceived() >= generator.bytesWritten()
+                    || monotonicTime_ns() - stopped_ns > drainTimeout_ms * Q_INT64_C(1000000))
+            {
+                break;
+            }
+        }
+    }
+    generator.wait();
+
+    qint64 sent = generator.bytesWritten();
+    qint64 received = receiver.bytesReceived();
+    qint64 elapsed_ns = qMax(receiver.lastByte_ns() - qMax(receiver.firstByte_ns(), start_ns), static_cast<qint64>(1));
+    result["targetBytesPerSecond"] = rate_Bps;
+    result["bytesSent"] = sent;
+    result["bytesReceived"] = received;
+    result["bytesDropped"] = sent - received;
+    result["bytesPerSecond"] = static_cast<double>(received) * 1e9 / elapsed_ns;
+    result["senderStalled_ms"] = generator.stalled_ms();
+    result["readLatency_us"] = percentiles_us(receiver.readLatencies_ns());
+    result["screenLatency_us"] = percentiles_us(receiver.screenLatencies_ns());
+    result["peakRss_kB"] = readStatusValue_kB("VmHWM:");
+
+    QObject::disconnect(&serialThread, SIGNAL(readyRead()), &receiver, SLOT(readData()));
+    ::close(fd);
+    serialThread.close();
+    waitForOpen(&serialThread, false, 1000);
+    serialThread.stop(1000);
+    return result;
+}
+
+static QList<int> parseList(const QString &str)
+{
+    QList<int> list;
+    foreach (const QString &item, str.split(',', skipEmptyParts))
+    {
+        list.append(item.trimmed().toInt());
+    }
+    return list;
+}
+
+int main(int argc, char *argv[])
+{
+    if (!qEnvironmentVariableIsSet("QT_QPA_PLATFORM"))
+    {
+        qputenv("QT_QPA_PLATFORM", "offscreen");
+    }
+    QApplication app(argc, argv);
+    /* Own settings, user's auto-log and console settings are not used */
+    QCoreApplication::setOrganizationName("iserterm");
+    QCoreApplication::setApplicationName("iserterm_pipeline_bench");
+
+    QCommandLineParser parser;
+    QCommandLineOption durationOption("duration", "Duration of each case in milliseconds.", "ms", "2000");
+    QCommandLineOption baudsOption("bauds", "Baud rates to run.", "list", "9600,115200,921600,3000000,12000000");
+    QCommandLineOption linesOption("lines", "Line lengths to run, including CR LF.", "list", "16,80,1024");
+    QCommandLineOption modesOption("modes", "Console modes to run: plain, timestamp, hex.", "list", "plain,timestamp,hex");
+    QCommandLineOption intervalOption("interval", "Minimum time between readyRead() signals in microseconds, -1: default.", "us", "-1");
+    QCommandLineOption outputOption("output", "Write JSON to file instead of standard output.", "file");
+    parser.addHelpOption();
+    parser.addOption(durationOption);
+    parser.addOption(baudsOption);
+    parser.addOption(linesOption);
+    parser.addOption(modesOption);
+    parser.addOption(intervalOption);
+    parser.addOption(outputOption);
+    parser.process(app);
+
+    int duration_ms = qMax(parser.value(durationOption).toInt(), 100);
+    qint64 readyReadInterval_us = parser.value(intervalOption).toLongLong();
+    QTextStream err(stderr);
+    QJsonArray cases;
+
+    foreach (int baudRate, parseList(parser.value(baudsOption)))
+    {
+        foreach (int lineLength, parseList(parser.value(linesOption)))
+        {
+            foreach (const QString &mode, parser.value(modesOption).split(',', skipEmptyParts))
+            {
+                /* Sequence number and line ending shall fit */
+                lineLength = qMax(lineLength, 12);
+                QJsonObject result = runCase(baudRate, lineLength, mode.trimmed(), duration_ms, readyReadInterval_us);
+                QJsonObject screen = result["screenLatency_us"].toObject();
+                err << QString("%1 baud, %2 B lines, %3: %4 B/s, dropped %5 B, screen latency p50 %6 us p99 %7 us, peak RSS %8 kB")
+                       .arg(baudRate, 8).arg(lineLength, 4).arg(mode, -9)
+                       .arg(result["bytesPerSecond"].toDouble(), 0, 'f', 0)
+                       .arg(result["bytesDropped"].toDouble(), 0, 'f', 0)
+                       .arg(screen["p50"].toDouble(), 0, 'f', 0)
+                       .arg(screen["p99"].toDouble(), 0, 'f', 0)
+                       .arg(result["peakRss_kB"].toDouble(), 0, 'f', 0)
+                    << "\n";
+                if (result.contains("error"))
+                {
+                    err << "ERROR: " << result["error"].toString() << "\n";
+                }
+                /* Progress is shown after each case */
+                err.flush();
+                cases.append(result);
+            }
+        }
+    }
+
+    QJsonObject root;
+    root["benchmark"] = QString("pipeline");
+    root["version"] = QString(VER_FILEVERSION_STR);
+    root["git"] = QString(GIT_VERSION);
+    root["cases"] = cases;
+    QByteArray json = QJsonDocument(root).toJson();
+    if (parser.isSet(outputOption))
+    {
+        QFile file(parser.value(outputOption));
+        if (!file.open(QFile::WriteOnly) || file.write(json) != json.size())
+        {
+            err << "Cannot write " << file.fileName() << ": " << file.errorString() << "\n";
+            return 1;
+        }
+    }
+    else
+    {
+        QTextStream(stdout) << json;
+    }
+    return 0;
+}
@@ -0,0 +1,64 @@
+QT += widgets serialport
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = pipeline_bench
+TEMPLATE = app
+GIT_VERSION = $$system(git --git-dir $$PWD/../../.git --work-tree $$PWD/../.. describe --always --tags)
+DEFINES += GIT_VERSION=\\\"$$GIT_VERSION\\\"
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    main.cpp \
+    pipelinebench.cpp \
+    ../../src/console.cpp \
+    ../../src/consoledatastore.cpp \
+    ../../src/consolelinestore.cpp \
+    ../../src/hexdump.cpp \
+    ../../src/serialthread.cpp \
+    ../../src/serialsettings.cpp \
+    ../../src/ringbuffer.cpp \
+    ../../src/readoverflow.cpp \
+    ../../src/commandqueue.cpp \
+    ../../src/arrivaltimes.cpp \
+    ../../src/logwriter.cpp \
+    ../../src/capturewriter.cpp \
+    ../../src/replaysource.cpp \
+    ../../src/timestampformatter.cpp \
+    ../../src/sendjob.cpp \
+    ../../src/portbackend.cpp \
+    ../../src/serialportbackend.cpp \
+    ../../src/fdportbackend.cpp \
+    ../../src/ptyportbackend.cpp \
+    ../../src/simulatedportbackend.cpp \
+    ../../src/modemlinewatcher.cpp \
+    ../../src/ioreactor.cpp
+
+HEADERS += \
+    pipelinebench.h \
+    ../../src/console.h \
+    ../../src/consoledatastore.h \
+    ../../src/consolelinestore.h \
+    ../../src/hexdump.h \
+    ../../src/serialthread.h \
+    ../../src/serialsettings.h \
+    ../../src/ringbuffer.h \
+    ../../src/readoverflow.h \
+    ../../src/commandqueue.h \
+    ../../src/arrivaltimes.h \
+    ../../src/logwriter.h \
+    ../../src/capturewriter.h \
+    ../../src/replaysource.h \
+    ../../src/timestampformatter.h \
+    ../../src/sendjob.h \
+    ../../src/portbackend.h \
+    ../../src/serialportbackend.h \
+    ../../src/fdportbackend.h \
+    ../../src/ptyportbackend.h \
+    ../../src/simulatedportbackend.h \
+    ../../src/modemlinewatcher.h \
+    ../../src/ioreactor.h
+
+LIBS += -lutil
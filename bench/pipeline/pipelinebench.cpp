@@ -0,0 +1,234 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <poll.h>
+#include <time.h>
+#include <unistd.h>
+#include <errno.h>
+#include <stdio.h>
+#include <string.h>
+
+#include "pipelinebench.h"
+#include "serialthread.h"
+#include "console.h"
+
+/** Generator wakes up in every millisecond to keep the rate. */
+static const qint64 slice_ns = 1000000;
+
+/**
+ * @brief monotonicTime_ns
+ * @return CLOCK_MONOTONIC time, same clock as SerialThread uses for arrival times.
+ */
+qint64 monotonicTime_ns()
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+Generator::Generator(int fd, qint64 rate_Bps, int lineLength, qint64 duration_ms, QVector<qint64> *sendTimes)
+    : QThread(NULL)
+    , m_fd(fd)
+    , m_rate_Bps(rate_Bps)
+    , m_lineLength(lineLength)
+    , m_duration_ms(duration_ms)
+    , m_sendTimes(sendTimes)
+    , m_bytesWritten(0)
+    , m_linesWritten(0)
+    , m_stalled_ns(0)
+{
+}
+
+qint64 Generator::bytesWritten() const
+{
+    return m_bytesWritten.load(std::memory_order_acquire);
+}
+
+qint64 Generator::linesWritten() const
+{
+    return m_linesWritten.load(std::memory_order_acquire);
+}
+
+qint64 Generator::stalled_ms() const
+{
+    return m_stalled_ns / 1000000;
+}
+
+/**
+ * @brief Generator::appendLine
+ * Line: 8 digit sequence number, printable filler, CR LF.
+ */
+void Generator::appendLine(QByteArray &buf, qint64 index) const
+{
+    char number[16];
+    int numberLen = snprintf(number, sizeof(number), "%08lld", static_cast<long long>(index % 100000000));
+    int fillLen = m_lineLength - numberLen - 2;
+
+    buf.append(number, numberLen);
+    for (int i = 0; i < fillLen; i++)
+    {
+        buf.append(static_cast<char>(' ' + 1 + (index + i) % 94));
+    }
+    buf.append("\r\n", 2);
+}
+
+void Generator::run()
+{
+    QByteArray out;
+    int outOffset = 0;
+    qint64 generated = 0;
+    qint64 written = 0;
+    qint64 lines = 0;
+    qint64 start_ns = monotonicTime_ns();
+    qint64 end_ns = start_ns + m_duration_ms * 1000000;
+    qint64 next_ns = start_ns;
+
+    while (monotonicTime_ns() < end_ns)
+    {
+        qint64 now_ns = monotonicTime_ns();
+        qint64 due = (now_ns - start_ns) * m_rate_Bps / 1000000000;
+
+        while (generated < due)
+        {
+            appendLine(out, generated / m_lineLength);
+            generated += m_lineLength;
+        }
+        while (written < due)
+        {
+            ssize_t len = ::write(m_fd, out.constData() + outOffset,
+                                  static_cast<size_t>(qMin(due - written, static_cast<qint64>(out.size() - outOffset))));
+            if (len > 0)
+            {
+                qint64 write_ns = monotonicTime_ns();
+                written += len;
+                outOffset += static_cast<int>(len);
+                while ((lines + 1) * m_lineLength <= written && lines < m_sendTimes->size())
+                {
+                    (*m_sendTimes)[static_cast<int>(lines)] = write_ns;
+                    lines++;
+                }
+                m_linesWritten.store(lines, std::memory_order_release);
+                m_bytesWritten.store(written, std::memory_order_release);
+            }
+            else if (len < 0 && (errno == EAGAIN || errno == EWOULDBLOCK))
+            {
+                /* Receiver cannot keep up, a real UART would overrun here */
+                struct pollfd fd;
+                qint64 wait_ns = monotonicTime_ns();
+                fd.fd = m_fd;
+                fd.events = POLLOUT;
+                fd.revents = 0;
+                ::poll(&fd, 1, 1);
+                m_stalled_ns += monotonicTime_ns() - wait_ns;
+                break;
+            }
+            else if (len < 0 && errno == EINTR)
+            {
+                continue;
+            }
+            else
+            {
+                fprintf(stderr, "write failed: %s\n", strerror(errno));
+                return;
+            }
+        }
+        if (outOffset >= 1024 * 1024)
+        {
+            out.remove(0, outOffset);
+            outOffset = 0;
+        }
+        next_ns += slice_ns;
+        if (next_ns > monotonicTime_ns())
+        {
+            struct timespec ts;
+            ts.tv_sec = next_ns / 1000000000;
+            ts.tv_nsec = next_ns % 1000000000;
+            clock_nanosleep(CLOCK_MONOTONIC, TIMER_ABSTIME, &ts, NULL);
+        }
+        else
+        {
+            next_ns = monotonicTime_ns();
+        }
+    }
+}
+
+Receiver::Receiver(SerialThread *serialThread, Console *console, const Generator *generator,
+                   const QVector<qint64> *sendTimes, int lineLength)
+    : QObject(NULL)
+    , m_serialThread(serialThread)
+    , m_console(console)
+    , m_generator(generator)
+    , m_sendTimes(sendTimes)
+    , m_lineLength(lineLength)
+    , m_bytesReceived(0)
+    , m_lines(0)
+    , m_firstByte_ns(0)
+    , m_lastByte_ns(0)
+{
+    m_readLatencies_ns.reserve(sendTimes->size());
+    m_screenLatencies_ns.reserve(sendTimes->size());
+}
+
+qint64 Receiver::bytesReceived() const
+{
+    return m_bytesReceived;
+}
+
+qint64 Receiver::firstByte_ns() const
+{
+    return m_firstByte_ns;
+}
+
+qint64 Receiver::lastByte_ns() const
+{
+    return m_lastByte_ns;
+}
+
+const QVector<qint64> &Receiver::readLatencies_ns() const
+{
+    return m_readLatencies_ns;
+}
+
+const QVector<qint64> &Receiver::screenLatencies_ns() const
+{
+    return m_screenLatencies_ns;
+}
+
+/**
+ * @brief Receiver::readData
+ * Same as MainWindow::readSessionData(), latency of lines which are
+ * completed by a chunk is measured after the chunk is put to the console.
+ */
+void Receiver::readData()
+{
+    const char *data;
+    qint64 len;
+    arrivalTime_t arrivalTime;
+
+    m_serialThread->acknowledgeReadyRead();
+    while ((len = m_serialThread->peekReadData(&data, &arrivalTime)) > 0)
+    {
+        m_console->putData(QByteArray::fromRawData(data, static_cast<int>(len)), arrivalTime.wallClock_ms);
+        qint64 now_ns = monotonicTime_ns();
+        m_serialThread->consumeReadData(len);
+        if (m_bytesReceived == 0)
+        {
+            m_firstByte_ns = arrivalTime.monotonic_ns;
+        }
+        m_bytesReceived += len;
+        m_lastByte_ns = now_ns;
+
+        /* Generator records time after write() returned, it may be late */
+        qint64 linesWritten = m_generator->linesWritten();
+        while ((m_lines + 1) * m_lineLength <= m_bytesReceived && m_lines < linesWritten)
+        {
+            qint64 send_ns = m_sendTimes->at(static_cast<int>(m_lines));
+            m_readLatencies_ns.append(qMax(arrivalTime.monotonic_ns - send_ns, static_cast<qint64>(0)));
+            m_screenLatencies_ns.append(now_ns - send_ns);
+            m_lines++;
+        }
+    }
+}
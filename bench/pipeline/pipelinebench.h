@@ -0,0 +1,92 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef PIPELINEBENCH_H
+#define PIPELINEBENCH_H
+
+#include <QThread>
+#include <QObject>
+#include <QVector>
+#include <QByteArray>
+
+#include <atomic>
+
+class SerialThread;
+class Console;
+
+qint64 monotonicTime_ns();
+
+/**
+ * @brief The Generator class
+ * Writes numbered lines of fixed length to the slave side of the
+ * pseudo-terminal at the rate of a serial line. Time of writing each line is
+ * recorded, so the receiver can calculate latency.
+ */
+class Generator : public QThread
+{
+public:
+    Generator(int fd, qint64 rate_Bps, int lineLength, qint64 duration_ms, QVector<qint64> *sendTimes);
+
+    qint64 bytesWritten() const;
+    qint64 linesWritten() const;
+    qint64 stalled_ms() const;
+
+protected:
+    void run();
+
+private:
+    Q_DISABLE_COPY(Generator)
+
+    void appendLine(QByteArray &buf, qint64 index) const;
+
+    int m_fd;
+    qint64 m_rate_Bps;
+    int m_lineLength;
+    qint64 m_duration_ms;
+    QVector<qint64> *m_sendTimes;       /**< Time when last byte of line was written, CLOCK_MONOTONIC. */
+    std::atomic<qint64> m_bytesWritten;
+    std::atomic<qint64> m_linesWritten; /**< Number of valid entries in m_sendTimes. */
+    std::atomic<qint64> m_stalled_ns;   /**< Time spent waiting for space in pseudo-terminal. */
+};
+
+/**
+ * @brief The Receiver class
+ * Drains SerialThread into Console like MainWindow::readData() and measures
+ * when each line reached the console.
+ */
+class Receiver : public QObject
+{
+    Q_OBJECT
+public:
+    Receiver(SerialThread *serialThread, Console *console, const Generator *generator,
+             const QVector<qint64> *sendTimes, int lineLength);
+
+    qint64 bytesReceived() const;
+    qint64 firstByte_ns() const;
+    qint64 lastByte_ns() const;
+    const QVector<qint64> &readLatencies_ns() const;
+    const QVector<qint64> &screenLatencies_ns() const;
+
+public slots:
+    void readData();
+
+private:
+    Q_DISABLE_COPY(Receiver)
+
+    SerialThread *m_serialThread;
+    Console *m_console;
+    const Generator *m_generator;
+    const QVector<qint64> *m_sendTimes;
+    int m_lineLength;
+    qint64 m_bytesReceived;
+    qint64 m_lines;                     /**< Lines whose latency is already measured. */
+    qint64 m_firstByte_ns;
+    qint64 m_lastByte_ns;
+    QVector<qint64> m_readLatencies_ns;     /**< Written to pty until read from port. */
+    QVector<qint64> m_screenLatencies_ns;   /**< Written to pty until Console::putData() returned. */
+};
+
+#endif // PIPELINEBENCH_H
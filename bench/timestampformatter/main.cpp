@@ -0,0 +1,99 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+/*
+ * Compares cost of putting a timestamp before a line:
+ *  - QDateTime::toString(): format string is parsed on every call,
+ *  - TimestampFormatter: format string is compiled once, only milliseconds
+ *    are rendered within the same second.
+ *
+ * Usage: timestampformatter_bench [lines] [format]
+ */
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "timestampformatter.h"
+
+/** Simulated time between lines: 80 characters at 115200 baud */
+static const qint64 lineInterval_us = 6944;
+
+static void report(QTextStream &out, const char *name, qint64 elapsed_ns, int lines, int bytes)
+{
+    out << QString("%1 %2 ns/line (%3 bytes)")
+           .arg(QString::fromLatin1(name), -32)
+           .arg(static_cast<double>(elapsed_ns) / lines, 8, 'f', 1)
+           .arg(bytes)
+        << "\n";
+    out.flush();
+}
+
+int main(int argc, char *argv[])
+{
+    QCoreApplication app(argc, argv);
+    QStringList args = app.arguments();
+    int lines = args.size() > 1 ? args.at(1).toInt() : 1000000;
+    QString format = args.size() > 2 ? args.at(2) : QString("HH:mm:ss.zzz  ");
+    QTextStream out(stdout);
+    qint64 start_ms = QDateTime::currentMSecsSinceEpoch();
+    QElapsedTimer timer;
+    QByteArray buf;
+
+    if (lines <= 0)
+    {
+        lines = 1000000;
+    }
+    out << "lines: " << lines << ", format: \"" << format << "\"\n";
+    out.flush();
+
+    /* Current path: QDateTime::toString() on every line */
+    buf.reserve(lines * 32);
+    timer.start();
+    for (int i = 0; i < lines; i++)
+    {
+        qint64 now_ms = start_ms + i * lineInterval_us / 1000;
+        buf.append(QDateTime::fromMSecsSinceEpoch(now_ms).toString(format).toLocal8Bit());
+    }
+    report(out, "QDateTime::toString()", timer.nsecsElapsed(), lines, buf.size());
+    QByteArray reference = buf;
+
+    /* Compiled formatter, writing straight into buffer */
+    TimestampFormatter formatter(format);
+    buf.clear();
+    buf.reserve(lines * 32);
+    timer.start();
+    for (int i = 0; i < lines; i++)
+    {
+        qint64 now_ms = start_ms + i * lineInterval_us / 1000;
+        formatter.append(buf, now_ms);
+    }
+    report(out, "TimestampFormatter::append()", timer.nsecsElapsed(), lines, buf.size());
+    if (buf != reference)
+    {
+        out << "ERROR: output differs from QDateTime::toString()\n";
+        return 1;
+    }
+
+    /* Both include reading the clock, as Console does */
+    buf.clear();
+    timer.start();
+    for (int i = 0; i < lines; i++)
+    {
+        buf.append(QDateTime::currentDateTime().toString(format).toLocal8Bit());
+    }
+    report(out, "currentDateTime().toString()", timer.nsecsElapsed(), lines, buf.size());
+
+    buf.clear();
+    timer.start();
+    for (int i = 0; i < lines; i++)
+    {
+        formatter.appendCurrent(buf);
+    }
+    report(out, "appendCurrent()", timer.nsecsElapsed(), lines, buf.size());
+
+    return 0;
+}
@@ -0,0 +1,16 @@
+QT -= gui
+
+CONFIG += console
+CONFIG -= app_bundle
+
+TARGET = timestampformatter_bench
+TEMPLATE = app
+
+INCLUDEPATH += ../../src
+
+SOURCES += \
+    main.cpp \
+    ../../src/timestampformatter.cpp
+
+HEADERS += \
+    ../../src/timestampformatter.h
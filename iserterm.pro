@@ -15,16 +15,34 @@ SOURCES += \
     src/mainwindow.cpp \
     src/settingsdialog.cpp \
     src/console.cpp \
+    src/consoledatastore.cpp \
+    src/consolelinestore.cpp \
+    src/hexdump.cpp \
     src/consolesettingsdialog.cpp \
     src/serialthread.cpp \
     src/serialsettings.cpp \
     src/multistring.cpp \
     src/shiftdeleventfilter.cpp \
-    src/finddialog.cpp
+    src/finddialog.cpp \
+    src/ringbuffer.cpp \
+    src/readoverflow.cpp \
+    src/commandqueue.cpp \
+    src/arrivaltimes.cpp \
+    src/logwriter.cpp \
+    src/capturewriter.cpp \
+    src/replaysource.cpp \
+    src/timestampformatter.cpp \
+    src/sendjob.cpp \
+    src/portbackend.cpp \
+    src/serialportbackend.cpp \
+    src/headlesssession.cpp
 
 HEADERS += \
     src/common.h \
     src/console.h \
+    src/consoledatastore.h \
+    src/consolelinestore.h \
+    src/hexdump.h \
     src/multivalidator.h \
     src/mainwindow.h \
     src/settingsdialog.h \
@@ -34,7 +52,38 @@ HEADERS += \
     src/serialsettings.h \
     src/multistring.h \
     src/shiftdeleventfilter.h \
-    src/finddialog.h
+    src/finddialog.h \
+    src/ringbuffer.h \
+    src/readoverflow.h \
+    src/commandqueue.h \
+    src/arrivaltimes.h \
+    src/logwriter.h \
+    src/capturewriter.h \
+    src/replaysource.h \
+    src/captureformat.h \
+    src/timestampformatter.h \
+    src/sendjob.h \
+    src/portbackend.h \
+    src/serialportbackend.h \
+    src/headlesssession.h
+
+linux {
+    # Virtual ports: pseudo-terminal and simulated device
+    # All ports are served by one epoll thread
+    SOURCES += \
+        src/fdportbackend.cpp \
+        src/ptyportbackend.cpp \
+        src/simulatedportbackend.cpp \
+        src/modemlinewatcher.cpp \
+        src/ioreactor.cpp
+    HEADERS += \
+        src/fdportbackend.h \
+        src/ptyportbackend.h \
+        src/simulatedportbackend.h \
+        src/modemlinewatcher.h \
+        src/ioreactor.h
+    LIBS += -lutil
+}
 
 FORMS += \
     ui/mainwindow.ui \
@@ -0,0 +1,111 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include "arrivaltimes.h"
+
+/**
+ * @brief ArrivalTimes::ArrivalTimes
+ * @param capacity Number of records. It is rounded up to power of two.
+ */
+ArrivalTimes::ArrivalTimes(int capacity)
+    : m_lastWallClock_ms(-1)
+    , m_lastTransmitted(false)
+    , m_head(0)
+    , m_tail(0)
+{
+    quint64 size = 16u;
+    while (size < static_cast<quint64>(capacity))
+    {
+        size <<= 1;
+    }
+    m_records = new arrivalTime_t[size];
+    m_mask = size - 1u;
+}
+
+ArrivalTimes::~ArrivalTimes()
+{
+    delete[] m_records;
+    m_records = NULL;
+}
+
+/**
+ * @brief ArrivalTimes::stamp
+ * Records arrival time of a chunk. It shall be called before the chunk is
+ * committed to the receive buffer. Only the producer thread may call it.
+ *
+ * @param offset Position of first byte of chunk in the receive stream.
+ * @param monotonic_ns Monotonic time of reception.
+ * @param wallClock_ms Wall clock time of reception.
+ * @param transmitted true: chunk is replayed sent data.
+ */
+void ArrivalTimes::stamp(quint64 offset, qint64 monotonic_ns, qint64 wallClock_ms, bool transmitted)
+{
+    quint64 head = m_head.load(std::memory_order_relaxed);
+    quint64 tail = m_tail.load(std::memory_order_acquire);
+
+    if (wallClock_ms == m_lastWallClock_ms && transmitted == m_lastTransmitted && head != tail)
+    {
+        /* Same millisecond and direction as previous chunk */
+        return;
+    }
+    if (head - tail > m_mask)
+    {
+        /* Full */
+        return;
+    }
+    arrivalTime_t &record = m_records[head & m_mask];
+    record.offset = offset;
+    record.monotonic_ns = monotonic_ns;
+    record.wallClock_ms = wallClock_ms;
+    record.transmitted = transmitted;
+    m_lastWallClock_ms = wallClock_ms;
+    m_lastTransmitted = transmitted;
+    m_head.store(head + 1u, std::memory_order_release);
+}
+
+/**
+ * @brief ArrivalTimes::lookup
+ * Gets arrival time of byte at offset and drops records of chunks before it.
+ * Offsets shall not decrease between calls. Only the consumer thread may
+ * call it.
+ *
+ * @param offset Position in the receive stream.
+ * @param arrivalTime Arrival time of chunk which contains the byte.
+ * @param chunkEnd Position after the last byte of the chunk.
+ * @return false: no record found, chunkEnd is still valid.
+ */
+bool ArrivalTimes::lookup(quint64 offset, arrivalTime_t *arrivalTime, quint64 *chunkEnd)
+{
+    quint64 tail = m_tail.load(std::memory_order_relaxed);
+    quint64 head = m_head.load(std::memory_order_acquire);
+
+    while (head - tail >= 2u && m_records[(tail + 1u) & m_mask].offset <= offset)
+    {
+        tail++;
+    }
+    m_tail.store(tail, std::memory_order_release);
+    if (head == tail)
+    {
+        *chunkEnd = ~static_cast<quint64>(0);
+        return false;
+    }
+    if (m_records[tail & m_mask].offset > offset)
+    {
+        /* Queue was full when byte arrived */
+        *chunkEnd = m_records[tail & m_mask].offset;
+        return false;
+    }
+    *arrivalTime = m_records[tail & m_mask];
+    if (head - tail >= 2u)
+    {
+        *chunkEnd = m_records[(tail + 1u) & m_mask].offset;
+    }
+    else
+    {
+        *chunkEnd = ~static_cast<quint64>(0);
+    }
+    return true;
+}
@@ -0,0 +1,57 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef ARRIVALTIMES_H
+#define ARRIVALTIMES_H
+
+#include <QtGlobal>
+
+#include <atomic>
+
+/**
+ * @brief Arrival time of a received chunk.
+ */
+typedef struct
+{
+    quint64 offset;             /**< Position of first byte of chunk in the receive stream. */
+    qint64 monotonic_ns;        /**< Monotonic clock when chunk was read. */
+    qint64 wallClock_ms;        /**< Milliseconds since epoch when chunk was read. */
+    bool transmitted;           /**< Chunk was sent, not received (replay of capture). */
+} arrivalTime_t;
+
+/**
+ * @brief The ArrivalTimes class
+ * Side queue of RingBuffer: arrival time of received chunks, for exactly one
+ * producer and one consumer thread. Chunks which arrive within the same
+ * millisecond and direction share one record. If the queue is full, new
+ * chunks get the time and direction of the last recorded chunk.
+ */
+class ArrivalTimes
+{
+public:
+    explicit ArrivalTimes(int capacity = 16384);
+    ~ArrivalTimes();
+
+    /* Producer side */
+    void stamp(quint64 offset, qint64 monotonic_ns, qint64 wallClock_ms, bool transmitted = false);
+
+    /* Consumer side */
+    bool lookup(quint64 offset, arrivalTime_t *arrivalTime, quint64 *chunkEnd);
+
+private:
+    Q_DISABLE_COPY(ArrivalTimes)
+
+    arrivalTime_t *m_records;
+    quint64 m_mask;             /**< Capacity - 1, capacity is power of two. */
+    qint64 m_lastWallClock_ms;  /**< Time of last record. Only the producer uses it. */
+    bool m_lastTransmitted;     /**< Direction of last record. Only the producer uses it. */
+    /** Total number of records written. Only the producer modifies it. */
+    alignas(64) std::atomic<quint64> m_head;
+    /** Total number of records read. Only the consumer modifies it. */
+    alignas(64) std::atomic<quint64> m_tail;
+};
+
+#endif // ARRIVALTIMES_H
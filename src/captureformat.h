@@ -0,0 +1,55 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef CAPTUREFORMAT_H
+#define CAPTUREFORMAT_H
+
+#include <QtGlobal>
+
+/*
+ * Binary capture file (*.iscap), all integers are little-endian.
+ *
+ * File header (32 bytes):
+ *   char[8]  magic "ISCAP\0\0\1"
+ *   u32      version
+ *   u32      header size in bytes
+ *   i64      wall clock at start of capture (ms since epoch)
+ *   i64      monotonic clock at start of capture (ns)
+ *
+ * Records follow the header, each one is:
+ *   u32      payload length in bytes
+ *   u8       type (captureRecordType_t)
+ *   u8       reserved
+ *   u16      reserved
+ *   i64      monotonic clock (ns)
+ *   u8[]     payload
+ *
+ * Block index (*.iscap.idx) is written next to the capture file. After its
+ * header (same layout as the capture file's header with index magic), it
+ * contains one entry for the first record of each block of captureBlockSize
+ * bytes:
+ *   u64      file offset of the record
+ *   u64      index of the record
+ *   i64      monotonic clock of the record (ns)
+ * The index is optional: it can be rebuilt by reading the records.
+ */
+
+static const char captureMagic[8] = { 'I', 'S', 'C', 'A', 'P', '\0', '\0', '\1' };
+static const char captureIndexMagic[8] = { 'I', 'S', 'I', 'D', 'X', '\0', '\0', '\1' };
+static const quint32 captureVersion = 1u;
+static const int captureHeaderSize = 32;
+static const int captureRecordHeaderSize = 16;
+static const int captureIndexEntrySize = 24;
+static const qint64 captureBlockSize = 64 * 1024;
+
+typedef enum
+{
+    CAPTURE_rx = 0,         /**< Received data. */
+    CAPTURE_tx = 1,         /**< Sent data. */
+    CAPTURE_lineEvent = 2   /**< Pinout signals changed, payload: u32 QSerialPort::PinoutSignals. */
+} captureRecordType_t;
+
+#endif // CAPTUREFORMAT_H
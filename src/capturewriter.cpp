@@ -0,0 +1,283 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QtEndian>
+#include <QDebug>
+
+#include <string.h>
+
+#include "capturewriter.h"
+
+CaptureWriter::CaptureWriter(int bufferSize)
+    : m_bufferSize(bufferSize)
+    , m_flushInterval_ms(1000)
+    , m_bufferTime_ns(0)
+    , m_fileOffset(0)
+    , m_nextIndexOffset(0)
+    , m_recordIdx(0)
+{
+}
+
+CaptureWriter::~CaptureWriter()
+{
+    close();
+}
+
+/**
+ * @brief CaptureWriter::open
+ * Creates capture file and its index. Existing files are overwritten.
+ *
+ * @param filePath Path of capture file. Index is written to filePath + ".idx".
+ * @param wallClock_ms Wall clock at start of capture.
+ * @param monotonic_ns Monotonic clock at start of capture.
+ * @return true: capture file opened.
+ */
+bool CaptureWriter::open(const QString &filePath, qint64 wallClock_ms, qint64 monotonic_ns)
+{
+    close();
+    m_errorString.clear();
+    m_file.setFileName(filePath);
+    m_indexFile.setFileName(filePath + ".idx");
+    if (!m_file.open(QIODevice::WriteOnly | QIODevice::Unbuffered))
+    {
+        m_errorString = m_file.errorString();
+        qCritical() << __PRETTY_FUNCTION__ << "cannot open" << filePath << m_errorString;
+        return false;
+    }
+    if (!m_indexFile.open(QIODevice::WriteOnly | QIODevice::Unbuffered))
+    {
+        /* Capture is usable without index */
+        qCritical() << __PRETTY_FUNCTION__ << "cannot open" << m_indexFile.fileName() << m_indexFile.errorString();
+    }
+    m_buffer.clear();
+    m_buffer.reserve(m_bufferSize);
+    m_fileOffset = 0;
+    m_nextIndexOffset = captureHeaderSize;
+    m_recordIdx = 0;
+    if (!writeHeader(m_file, captureMagic, wallClock_ms, monotonic_ns))
+    {
+        fail();
+        return false;
+    }
+    if (m_indexFile.isOpen() && !writeHeader(m_indexFile, captureIndexMagic, wallClock_ms, monotonic_ns))
+    {
+        m_indexFile.close();
+    }
+    return true;
+}
+
+/**
+ * @brief CaptureWriter::close
+ * Writes buffered records and closes capture file and index.
+ */
+void CaptureWriter::close()
+{
+    if (m_file.isOpen())
+    {
+        flush();
+        m_file.close();
+    }
+    if (m_indexFile.isOpen())
+    {
+        m_indexFile.close();
+    }
+    m_buffer.clear();
+}
+
+bool CaptureWriter::isOpen() const
+{
+    return m_file.isOpen();
+}
+
+QString CaptureWriter::errorString() const
+{
+    return m_errorString;
+}
+
+/**
+ * @brief CaptureWriter::write
+ * Adds a record to capture.
+ *
+ * @param type Type of record.
+ * @param data Payload.
+ * @param len Length of payload in bytes.
+ * @param monotonic_ns Monotonic time of data.
+ */
+void CaptureWriter::write(captureRecordType_t type, const char *data, qint64 len, qint64 monotonic_ns)
+{
+    if (!m_file.isOpen())
+    {
+        return;
+    }
+    uchar header[captureRecordHeaderSize];
+    memset(header, 0, sizeof(header));
+    qToLittleEndian<quint32>(static_cast<quint32>(len), header);
+    header[4] = static_cast<uchar>(type);
+    qToLittleEndian<qint64>(monotonic_ns, header + 8);
+
+    if (m_fileOffset >= m_nextIndexOffset)
+    {
+        writeIndexEntry(monotonic_ns);
+    }
+    qint64 recordLen = captureRecordHeaderSize + len;
+    if (m_buffer.size() + recordLen > m_bufferSize)
+    {
+        flush();
+    }
+    if (recordLen > m_bufferSize)
+    {
+        /* Too large for buffer, write it directly */
+        if (!writeFile(reinterpret_cast<const char *>(header), captureRecordHeaderSize)
+                || !writeFile(data, len))
+        {
+            fail();
+            return;
+        }
+    }
+    else
+    {
+        if (m_buffer.isEmpty())
+        {
+            m_bufferTime_ns = monotonic_ns;
+        }
+        m_buffer.append(reinterpret_cast<const char *>(header), captureRecordHeaderSize);
+        m_buffer.append(data, static_cast<int>(len));
+    }
+    m_fileOffset += recordLen;
+    m_recordIdx++;
+    flushIfDue(monotonic_ns);
+}
+
+/**
+ * @brief CaptureWriter::writeLineEvent
+ * Adds a record of changed pinout signals (CTS, DSR, etc.) to capture.
+ *
+ * @param pinoutSignals New state of pinout signals.
+ * @param monotonic_ns Monotonic time of change.
+ */
+void CaptureWriter::writeLineEvent(quint32 pinoutSignals, qint64 monotonic_ns)
+{
+    uchar payload[4];
+    qToLittleEndian<quint32>(pinoutSignals, payload);
+    write(CAPTURE_lineEvent, reinterpret_cast<const char *>(payload), sizeof(payload), monotonic_ns);
+}
+
+/**
+ * @brief CaptureWriter::flushIfDue
+ * Writes buffered records if the oldest one is older than flush interval.
+ *
+ * @param monotonic_ns Current monotonic time.
+ */
+void CaptureWriter::flushIfDue(qint64 monotonic_ns)
+{
+    if (!m_buffer.isEmpty() && m_flushInterval_ms > 0
+            && monotonic_ns - m_bufferTime_ns >= static_cast<qint64>(m_flushInterval_ms) * 1000000)
+    {
+        flush();
+    }
+}
+
+/**
+ * @brief CaptureWriter::flush
+ * Writes buffered records to capture file.
+ */
+void CaptureWriter::flush()
+{
+    if (m_buffer.isEmpty() || !m_file.isOpen())
+    {
+        return;
+    }
+    if (!writeFile(m_buffer.constData(), m_buffer.size()))
+    {
+        fail();
+        return;
+    }
+    m_buffer.resize(0);
+}
+
+int CaptureWriter::flushInterval_ms() const
+{
+    return m_flushInterval_ms;
+}
+
+/**
+ * @brief CaptureWriter::setFlushInterval_ms
+ * @param flushInterval_ms Records are written to file at least this often.
+ * 0: records are written only when buffer is full or capture is closed.
+ */
+void CaptureWriter::setFlushInterval_ms(int flushInterval_ms)
+{
+    m_flushInterval_ms = flushInterval_ms;
+}
+
+bool CaptureWriter::writeHeader(QFile &file, const char *magic, qint64 wallClock_ms, qint64 monotonic_ns)
+{
+    uchar header[captureHeaderSize];
+    memcpy(header, magic, 8);
+    qToLittleEndian<quint32>(captureVersion, header + 8);
+    qToLittleEndian<quint32>(static_cast<quint32>(captureHeaderSize), header + 12);
+    qToLittleEndian<qint64>(wallClock_ms, header + 16);
+    qToLittleEndian<qint64>(monotonic_ns, header + 24);
+    if (file.write(reinterpret_cast<const char *>(header), captureHeaderSize) != captureHeaderSize)
+    {
+        m_errorString = file.errorString();
+        return false;
+    }
+    if (&file == &m_file)
+    {
+        m_fileOffset = captureHeaderSize;
+    }
+    return true;
+}
+
+/**
+ * @brief CaptureWriter::writeIndexEntry
+ * Adds an index entry for the next record and starts a new block.
+ *
+ * @param monotonic_ns Monotonic time of the next record.
+ */
+void CaptureWriter::writeIndexEntry(qint64 monotonic_ns)
+{
+    m_nextIndexOffset = m_fileOffset + captureBlockSize;
+    if (!m_indexFile.isOpen())
+    {
+        return;
+    }
+    uchar entry[captureIndexEntrySize];
+    qToLittleEndian<quint64>(static_cast<quint64>(m_fileOffset), entry);
+    qToLittleEndian<quint64>(m_recordIdx, entry + 8);
+    qToLittleEndian<qint64>(monotonic_ns, entry + 16);
+    if (m_indexFile.write(reinterpret_cast<const char *>(entry), captureIndexEntrySize) != captureIndexEntrySize)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot write index:" << m_indexFile.errorString();
+        m_indexFile.close();
+    }
+}
+
+bool CaptureWriter::writeFile(const char *data, qint64 len)
+{
+    if (m_file.write(data, len) != len)
+    {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief CaptureWriter::fail
+ * Stops capturing after a write error.
+ */
+void CaptureWriter::fail()
+{
+    qCritical() << __PRETTY_FUNCTION__ << "capture stopped:" << m_errorString;
+    m_buffer.clear();
+    m_file.close();
+    if (m_indexFile.isOpen())
+    {
+        m_indexFile.close();
+    }
+}
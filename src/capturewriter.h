@@ -0,0 +1,62 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef CAPTUREWRITER_H
+#define CAPTUREWRITER_H
+
+#include <QByteArray>
+#include <QString>
+#include <QFile>
+
+#include "captureformat.h"
+
+/**
+ * @brief The CaptureWriter class
+ * Writes binary capture file (see captureformat.h) and its block index.
+ * Records are collected in a fixed size buffer which is written to file when
+ * it is full or too old, so memory usage is bounded and few system calls
+ * are needed. It is used by the serial thread only.
+ */
+class CaptureWriter
+{
+public:
+    explicit CaptureWriter(int bufferSize = captureBlockSize);
+    ~CaptureWriter();
+
+    bool open(const QString &filePath, qint64 wallClock_ms, qint64 monotonic_ns);
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+    void write(captureRecordType_t type, const char *data, qint64 len, qint64 monotonic_ns);
+    void writeLineEvent(quint32 pinoutSignals, qint64 monotonic_ns);
+    void flushIfDue(qint64 monotonic_ns);
+    void flush();
+
+    int flushInterval_ms() const;
+    void setFlushInterval_ms(int flushInterval_ms);
+
+private:
+    Q_DISABLE_COPY(CaptureWriter)
+
+    bool writeHeader(QFile &file, const char *magic, qint64 wallClock_ms, qint64 monotonic_ns);
+    void writeIndexEntry(qint64 monotonic_ns);
+    bool writeFile(const char *data, qint64 len);
+    void fail();
+
+    QFile m_file;
+    QFile m_indexFile;
+    QByteArray m_buffer;            /**< Records not written to file yet. */
+    int m_bufferSize;
+    int m_flushInterval_ms;         /**< Maximum age of data in m_buffer. */
+    qint64 m_bufferTime_ns;         /**< Time of oldest record in m_buffer. */
+    qint64 m_fileOffset;            /**< Offset of next record in capture file. */
+    qint64 m_nextIndexOffset;       /**< Next record from this offset gets an index entry. */
+    quint64 m_recordIdx;            /**< Index of next record. */
+    QString m_errorString;
+};
+
+#endif // CAPTUREWRITER_H
@@ -0,0 +1,85 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include "commandqueue.h"
+
+CommandQueue::CommandQueue()
+    : m_head(&m_stub)
+    , m_tail(&m_stub)
+{
+    m_stub.next.store(NULL, std::memory_order_relaxed);
+}
+
+CommandQueue::~CommandQueue()
+{
+    serialCommand_t *command;
+
+    while ((command = pop()) != NULL)
+    {
+        delete command;
+    }
+}
+
+/**
+ * @brief CommandQueue::push
+ * Adds a command to the end of queue. Queue takes ownership of command.
+ * Wait-free: it is one atomic exchange and a store.
+ */
+void CommandQueue::push(serialCommand_t *command)
+{
+    command->next.store(NULL, std::memory_order_relaxed);
+    link(command);
+}
+
+/**
+ * @brief CommandQueue::pop
+ * Takes the oldest command. Caller shall delete it.
+ *
+ * @return NULL if queue is empty or a producer is just linking its command;
+ * in the latter case the producer wakes up the consumer after push().
+ */
+serialCommand_t *CommandQueue::pop()
+{
+    serialCommand_t *tail = m_tail;
+    serialCommand_t *next = tail->next.load(std::memory_order_acquire);
+
+    if (tail == &m_stub)
+    {
+        if (!next)
+        {
+            return NULL;
+        }
+        m_tail = next;
+        tail = next;
+        next = next->next.load(std::memory_order_acquire);
+    }
+    if (next)
+    {
+        m_tail = next;
+        return tail;
+    }
+    if (tail != m_head.load(std::memory_order_acquire))
+    {
+        /* Producer exchanged head but has not linked its command yet */
+        return NULL;
+    }
+    /* Last command: stub is put behind it, so it can be taken */
+    m_stub.next.store(NULL, std::memory_order_relaxed);
+    link(&m_stub);
+    next = tail->next.load(std::memory_order_acquire);
+    if (next)
+    {
+        m_tail = next;
+        return tail;
+    }
+    return NULL;
+}
+
+void CommandQueue::link(serialCommand_t *command)
+{
+    serialCommand_t *prev = m_head.exchange(command, std::memory_order_acq_rel);
+    prev->next.store(command, std::memory_order_release);
+}
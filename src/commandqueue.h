@@ -0,0 +1,91 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef COMMANDQUEUE_H
+#define COMMANDQUEUE_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+#include <QIODevice>
+#include <QSerialPort>
+
+#include <atomic>
+
+#include "serialsettings.h"
+
+/** Auto-log settings of SerialThread, I/O thread gets a copy with CMD_open. */
+typedef struct
+{
+    bool enabled;
+    bool overwrite;
+    QString fileName;       /**< QDateTime format of log file name. */
+    QString filePath;
+    bool capture;           /**< Binary capture is written next to the log. */
+    int flushInterval_ms;
+    qint64 flushSize;
+    bool syncOnClose;
+} autoLogSettings_t;
+
+/**
+ * @brief Command of SerialThread. It is created by any thread, executed and
+ * deleted by the I/O thread.
+ */
+typedef struct serialCommand_s
+{
+    typedef enum
+    {
+        CMD_open,
+        CMD_close,
+        CMD_write,
+        CMD_replay,
+        CMD_abort,
+        CMD_setLines,
+        CMD_reconfigure,
+        CMD_setTimestampFormat,
+        CMD_stop
+    } type_t;
+
+    std::atomic<struct serialCommand_s *> next; /**< Used by CommandQueue. */
+    type_t type;
+    QIODevice::OpenMode openMode;           /**< CMD_open */
+    SerialSettings::serialSettings_t serialSettings;    /**< CMD_open, CMD_replay, CMD_reconfigure */
+    autoLogSettings_t autoLog;              /**< CMD_open */
+    QByteArray data;                        /**< CMD_write: data to send, empty if file is sent. */
+    QString fileName;                       /**< CMD_write: file to send, CMD_replay: recorded session. */
+    qint64 length;                          /**< CMD_write: size of data or file. */
+    double speed;                           /**< CMD_replay */
+    QSerialPort::PinoutSignal line;         /**< CMD_setLines: DTR or RTS. */
+    bool set;                               /**< CMD_setLines */
+    QString timestampFormat;                /**< CMD_setTimestampFormat */
+} serialCommand_t;
+
+/**
+ * @brief The CommandQueue class
+ * Intrusive multi-producer, single-consumer queue. push() never blocks and
+ * can be called by any thread, only the I/O thread may call pop().
+ * Commands are executed in the order they were pushed.
+ */
+class CommandQueue
+{
+public:
+    CommandQueue();
+    ~CommandQueue();
+
+    void push(serialCommand_t *command);
+    serialCommand_t *pop();
+
+private:
+    Q_DISABLE_COPY(CommandQueue)
+
+    void link(serialCommand_t *command);
+
+    std::atomic<serialCommand_t *> m_head;  /**< Last pushed command, producers exchange it. */
+    serialCommand_t *m_tail;    /**< Next command to pop. Used only by the consumer. */
+    serialCommand_t m_stub;     /**< Keeps queue non-empty, so producers never touch m_tail. */
+};
+
+#endif // COMMANDQUEUE_H
@@ -15,6 +15,9 @@
 #ifdef __WIN32__
 #define WINDOWS           1
 #endif
+#ifdef __linux__
+#define LINUX             1
+#endif
 
 #define TOSTR(s)          XSTR(s)
 #define XSTR(s)           #s
@@ -38,20 +38,27 @@
 
 #include "console.h"
 #include "common.h"
+#include "hexdump.h"
 
 #include <QScrollBar>
 #include <QApplication>
 #include <QClipboard>
 #include <QDateTime>
+#include <QPainter>
+#include <QPaintEvent>
+#include <QRegExp>
 
 #include <QtCore/QDebug>
 #include <QSettings>
 #include <QMenu>
 
+#include <string.h>
+
 Console::Console(QWidget *parent)
-    : QPlainTextEdit(parent)
+    : QAbstractScrollArea(parent)
     , m_localEchoEnabled(false)
     , m_updateEnabled(true)
+    , m_readOnly(false)
     , m_displayTimestampEnabled(false)
     , m_displayHexValuesEnabled(false)
     , m_hexWrap(16)
@@ -62,21 +69,26 @@ Console::Console(QWidget *parent)
     , m_autoWrapColumn(80)  /* automatically wrap text after 80 characters */
     , m_noLineEndingCntr(0)
     , m_timestampFormatString("HH:mm:ss.zzz  ")
-    , m_startWithTimestamp(false)
+    , m_timestampFormatter(m_timestampFormatString)
+    , m_arrivalTime_ms(0)
+    , m_lineStart(true)
+    , m_hexRowLine(-1)
+    , m_selecting(false)
 {
-#if CURSOR_MODE == 1
-    setOverwriteMode(true);
-#endif
-    setLineWrapMode(NoWrap);
+    memset(&m_putDataStatistics, 0, sizeof(m_putDataStatistics));
+    m_selectionAnchor.line = 0;
+    m_selectionAnchor.column = 0;
+    m_selectionEnd = m_selectionAnchor;
     setAcceptDrops(false);
-    setUndoRedoEnabled(false);
-    document()->setMaximumBlockCount(10000);
+    setFocusPolicy(Qt::StrongFocus);
+    viewport()->setCursor(Qt::IBeamCursor);
+    m_lineStore.setMaximumLineCount(10000);
     QSettings settings;
     QString fontStr = settings.value("console/font", "Monospace,12").toString();
     QFont font;
     font.fromString(fontStr);
     font.setStyleHint(QFont::TypeWriter);
-    document()->setDefaultFont(font);
+    setFont(font);
     QPalette p = palette();
     m_bgcolordef = QColor (Qt::black).name(QColor::HexArgb); // Convert default color to "#aarrggbb" format string
     m_inactbgcolordef = QColor (Qt::gray).name(QColor::HexArgb); // Convert default color to "#aarrggbb" format string
@@ -94,10 +106,10 @@ Console::Console(QWidget *parent)
     setPalette(p);
 
     m_keyMap.clear();
-    /* Backspace and delete are not handled by QPlainTextEdit */
+    /* Backspace and delete are not echoed */
     m_keyMap.insert(Qt::Key_Backspace,                      KeyMap(false, "\x08"));
     m_keyMap.insert(Qt::Key_Delete,                         KeyMap(false, "\x7F"));
-    /* Others are handled by QPlainTextEdit */
+    /* Others are echoed */
     m_keyMap.insert(Qt::Key_Return,                         KeyMap(true, m_lineEndingTx));
     m_keyMap.insert(Qt::Key_Enter,                          KeyMap(true, m_lineEndingTx));
     m_keyMap.insert(Qt::Key_Enter | Qt::KeypadModifier,     KeyMap(true, m_lineEndingTx));
@@ -106,49 +118,81 @@ Console::Console(QWidget *parent)
     m_keyMap.insert(Qt::Key_A | Qt::ControlModifier,        KeyMap(true, ""));
 }
 
-void Console::putData(const QByteArray &dataRaw)
+/**
+ * @brief Console::putData
+ * Adds received data to the console. Data is stored once, split into runs
+ * at line starts and automatic wraps; views are rendered from the runs.
+ *
+ * @param dataRaw Received data.
+ * @param timestamp_ms Arrival time of data in milliseconds since epoch, -1: now.
+ * @param direction Received data or sent data shown by local echo.
+ */
+void Console::putData(const QByteArray &dataRaw, qint64 timestamp_ms, ConsoleDataStore::direction_t direction)
 {
     int i;
-    int j;
-    bool found;
-    int length = m_lineEndingRx.length();
-    QByteArray data;
+    int runStart = 0;
+    int length = dataRaw.length();
+    const char *data = dataRaw.constData();
+    QByteArray lineEndingRx = m_lineEndingRx.toLocal8Bit();
+    bool hasLineEnd = !lineEndingRx.isEmpty();
+    char lineEnd = hasLineEnd ? lineEndingRx.at(lineEndingRx.length() - 1) : '\0';
+    bool render = m_updateEnabled && !m_displayHexValuesEnabled;
+    QByteArray text;
+    quint8 flags;
+
+    /* Monotonic clock is read from vDSO, it is cheap enough for every call */
+    m_putDataTimer.start();
+    m_arrivalTime_ms = timestamp_ms >= 0 ? timestamp_ms : QDateTime::currentMSecsSinceEpoch();
 
-    if (m_autoWrapColumn > 0)
+    if (length > 0)
     {
-        for (i = 0; i < dataRaw.length(); i++)
+        flags = m_lineStart ? ConsoleDataStore::RUN_lineStart : 0;
+        for (i = 0; i < length; i++)
         {
-            /* Check if any of the line ending chars found in the buffer */
-            found = false;
-            for (j = 0; j < length; j++)
+            quint8 lineFlags = 0;
+            if (i > 0 && hasLineEnd && data[i - 1] == lineEnd)
             {
-                if (dataRaw[i] == m_lineEndingRx[j])
+                lineFlags = ConsoleDataStore::RUN_lineStart;
+            }
+            if (m_autoWrapColumn > 0)
+            {
+                /* Check if any of the line ending chars found in the buffer */
+                if (memchr(lineEndingRx.constData(), data[i], static_cast<size_t>(lineEndingRx.length())))
                 {
-                    found = true;
-                    break;
+                    m_noLineEndingCntr = 0u;
+                }
+                else
+                {
+                    m_noLineEndingCntr++;
+                }
+                if (m_noLineEndingCntr > m_autoWrapColumn)
+                {
+                    /* No line ending found, wrap the line! */
+                    lineFlags = ConsoleDataStore::RUN_lineStart | ConsoleDataStore::RUN_wrapped;
+                    m_noLineEndingCntr = 0u;
                 }
             }
-            if (found)
+            if (lineFlags && i > runStart)
             {
-                m_noLineEndingCntr = 0u;
+                m_dataStore.append(data + runStart, i - runStart, m_arrivalTime_ms, direction, flags);
+                if (render)
+                {
+                    renderRun(text, data + runStart, i - runStart, m_arrivalTime_ms, flags, m_displayTimestampEnabled);
+                }
+                runStart = i;
+                flags = lineFlags;
             }
             else
             {
-                m_noLineEndingCntr++;
-            }
-            if (m_noLineEndingCntr > m_autoWrapColumn)
-            {
-                /* No line ending found, wrap the line! */
-                data += m_lineEndingRx.toLocal8Bit();
-                m_noLineEndingCntr = 0u;
+                flags |= lineFlags;
             }
-            data += dataRaw[i];
         }
-    }
-    else
-    {
-        /* Auto wrap disabled, copy buffer */
-        data = dataRaw;
+        m_dataStore.append(data + runStart, length - runStart, m_arrivalTime_ms, direction, flags);
+        if (render)
+        {
+            renderRun(text, data + runStart, length - runStart, m_arrivalTime_ms, flags, m_displayTimestampEnabled);
+        }
+        m_lineStart = hasLineEnd && data[length - 1] == lineEnd;
     }
 
     if (m_updateEnabled)
@@ -157,44 +201,50 @@ void Console::putData(const QByteArray &dataRaw)
         /* Check if slider is scrolled to down */
         bool scrollToEnd = bar->sliderPosition() == bar->maximum();
 
-        appendDataToConsole (data, dataRaw, scrollToEnd);
+        appendDataToConsole (text, dataRaw, scrollToEnd);
     }
 
-    m_data.append(data);
-//    qDebug() << "m_data.len" << m_data.length();
-    if (m_data.length () > m_dataSizeLimit_bytes)
-    {
-        /* Remove unwanted bytes */
-        /* / 10 ---> 10 percent histeresys TODO configurable histeresys? */
-        m_data.remove (0, m_data.length () - m_dataSizeLimit_bytes + m_dataSizeLimit_bytes / m_dataSizeHysteresis_percent);
-    }
+    /* Oldest segments are freed, below the limit by hysteresis TODO configurable histeresys? */
+    m_dataStore.trim (m_dataSizeLimit_bytes,
+                      m_dataSizeLimit_bytes - static_cast<qint64> (m_dataSizeLimit_bytes) * m_dataSizeHysteresis_percent / 100);
 
-    m_dataRaw.append(dataRaw);
-//    qDebug() << "m_dataRaw.len" << m_dataRaw.length();
-    if (m_dataRaw.length () > m_dataSizeLimit_bytes)
-    {
-        /* Remove unwanted bytes */
-        /* / 10 ---> 10 percent histeresys TODO configurable histeresys? */
-        m_dataRaw.remove (0, m_dataRaw.length () - m_dataSizeLimit_bytes + m_dataSizeLimit_bytes / m_dataSizeHysteresis_percent);
-    }
+    qint64 elapsed_ns = m_putDataTimer.nsecsElapsed();
+    m_putDataStatistics.calls++;
+    m_putDataStatistics.bytes += dataRaw.length();
+    m_putDataStatistics.time_ns += elapsed_ns;
+    m_putDataStatistics.maxTime_ns = qMax(m_putDataStatistics.maxTime_ns, elapsed_ns);
+}
 
-    QByteArray data2 = data;
-    addTimestamp(data2);
-    m_dataTimestamp.append(data2);
-    if (m_dataTimestamp.length () > m_dataSizeLimit_bytes)
-    {
-        /* Remove unwanted bytes */
-        /* / 10 ---> 10 percent histeresys TODO configurable histeresys? */
-        m_dataTimestamp.remove (0, m_dataTimestamp.length () - m_dataSizeLimit_bytes + m_dataSizeLimit_bytes / m_dataSizeHysteresis_percent);
-    }
+/**
+ * @brief Console::takePutDataStatistics
+ * Gets cost of putData() calls since last call and restarts collecting.
+ */
+Console::putDataStatistics_t Console::takePutDataStatistics()
+{
+    putDataStatistics_t statistics = m_putDataStatistics;
+    memset(&m_putDataStatistics, 0, sizeof(m_putDataStatistics));
+    return statistics;
+}
+
+/**
+ * @brief Console::bufferMemory
+ * @return Memory allocated for received data and lines on display.
+ */
+qint64 Console::bufferMemory() const
+{
+    return m_dataStore.memory() + m_lineStore.memory();
 }
 
 void Console::clear()
 {
 //    qDebug() << __PRETTY_FUNCTION__;
-    QPlainTextEdit::clear ();
-    m_data.clear ();
-    m_dataTimestamp.clear ();
+    m_lineStore.clear ();
+    m_selectionEnd = m_selectionAnchor;
+    m_dataStore.clear ();
+    m_lineStart = true;
+    m_hexRowLine = -1;
+    updateScrollBars ();
+    viewport ()->update ();
 }
 
 bool Console::isLocalEchoEnabled() const
@@ -221,6 +271,22 @@ void Console::setUpdateEnabled(bool updateEnabled)
     m_updateEnabled = updateEnabled;
 }
 
+bool Console::isReadOnly() const
+{
+    return m_readOnly;
+}
+
+/**
+ * @brief Console::setReadOnly
+ * Read only console does not echo keys and has no cursor. Keys are still
+ * reported by getData().
+ */
+void Console::setReadOnly(bool readOnly)
+{
+    m_readOnly = readOnly;
+    viewport()->update();
+}
+
 QString Console::getLineEndingRx() const
 {
     return m_lineEndingRx;
@@ -244,27 +310,27 @@ void Console::setLineEndingTx(const QString &lineEndingTx)
     m_keyMap.insert(Qt::Key_Enter | Qt::KeypadModifier,     KeyMap(true, m_lineEndingTx));
 }
 
+/**
+ * @brief Console::getAllData
+ * @return Stored data with automatic wraps, and with timestamps if they are
+ * shown.
+ */
 QByteArray Console::getAllData() const
 {
-    if (m_displayTimestampEnabled)
-    {
-        return m_dataTimestamp;
-    }
-    else
-    {
-        return m_data;
-    }
+    return renderData(m_displayTimestampEnabled, -1);
 }
 
 QString Console::getTimestamp() const
 {
-    QDateTime now = QDateTime::currentDateTime();
-    return now.toString(m_timestampFormatString);
+    QByteArray timestamp;
+    m_timestampFormatter.appendCurrent(timestamp);
+    return QString::fromLocal8Bit(timestamp);
 }
 
 void Console::setTimestampFormatString(const QString &format)
 {
     m_timestampFormatString = format;
+    m_timestampFormatter.setFormat(format);
 }
 
 QString Console::getTimestampFormatString()
@@ -274,16 +340,128 @@ QString Console::getTimestampFormatString()
 
 void Console::paste()
 {
-    if (m_localEchoEnabled)
-    {
-        moveCursor(QTextCursor::End, QTextCursor::MoveAnchor);
-        QPlainTextEdit::paste();
-    }
     QClipboard *clipboard = QApplication::clipboard();
     QString originalText = clipboard->text();
+
+    if (m_localEchoEnabled && !m_readOnly)
+    {
+        appendText(originalText.toLocal8Bit());
+        scrollToBottom();
+    }
     emit getData(originalText.toLocal8Bit ());
 }
 
+void Console::copy()
+{
+    if (hasSelection())
+    {
+        QApplication::clipboard()->setText(selectedText());
+    }
+}
+
+void Console::selectAll()
+{
+    qint64 lastLine = m_lineStore.lastLineNumber();
+
+    m_selectionAnchor.line = m_lineStore.firstLineNumber();
+    m_selectionAnchor.column = 0;
+    m_selectionEnd.line = lastLine;
+    m_selectionEnd.column = displayLine(lastLine).length();
+    viewport()->update();
+}
+
+bool Console::hasSelection() const
+{
+    position_t start;
+    position_t end;
+
+    selectionRange(&start, &end);
+    return start.line != end.line || start.column != end.column;
+}
+
+/**
+ * @brief Console::selectedText
+ * @return Selected text, lines are separated by '\n'.
+ */
+QString Console::selectedText() const
+{
+    position_t start;
+    position_t end;
+    QString text;
+
+    selectionRange(&start, &end);
+    for (qint64 line = start.line; line <= end.line; line++)
+    {
+        QString lineText = displayLine(line);
+        int from = line == start.line ? start.column : 0;
+        if (line == end.line)
+        {
+            text += lineText.mid(from, end.column - from);
+        }
+        else
+        {
+            text += lineText.mid(from);
+            text += '\n';
+        }
+    }
+    return text;
+}
+
+/**
+ * @brief Console::find
+ * Searches forward from the end of selection, or from the first line if
+ * nothing is selected. Match is selected and scrolled into view.
+ * Matches do not span lines.
+ *
+ * @param text Text or regular expression to find.
+ * @return false: not found.
+ */
+bool Console::find(const QString &text, bool caseSens, bool wholeWords, bool regEx)
+{
+    QString pattern = regEx ? text : QRegExp::escape(text);
+    position_t start;
+    position_t end;
+
+    if (wholeWords)
+    {
+        pattern = "\\b(?:" + pattern + ")\\b";
+    }
+    QRegExp searchRegEx(pattern, caseSens ? Qt::CaseSensitive : Qt::CaseInsensitive, QRegExp::RegExp);
+    if (text.isEmpty() || !searchRegEx.isValid())
+    {
+        return false;
+    }
+
+    selectionRange(&start, &end);
+    if (start.line == end.line && start.column == end.column)
+    {
+        end.line = m_lineStore.firstLineNumber();
+        end.column = 0;
+    }
+    for (qint64 line = end.line; line <= m_lineStore.lastLineNumber(); line++)
+    {
+        QString lineText = displayLine(line);
+        int index = searchRegEx.indexIn(lineText, line == end.line ? end.column : 0);
+        while (index >= 0 && searchRegEx.matchedLength() == 0)
+        {
+            /* Empty match, e.g. "x*" */
+            index = index < lineText.length() ? searchRegEx.indexIn(lineText, index + 1) : -1;
+        }
+        if (index >= 0)
+        {
+            m_selectionAnchor.line = line;
+            m_selectionAnchor.column = index;
+            m_selectionEnd.line = line;
+            m_selectionEnd.column = index + searchRegEx.matchedLength();
+            ensureVisible(m_selectionAnchor);
+            ensureVisible(m_selectionEnd);
+            viewport()->update();
+            return true;
+        }
+    }
+    return false;
+}
+
 bool Console::isDisplayHexValuesEnabled() const
 {
     return m_displayHexValuesEnabled;
@@ -334,12 +512,19 @@ void Console::setDataSizeLimit(int dataSizeLimit_bytes)
 
 int Console::getDisplaySize() const
 {
-    return document ()->maximumBlockCount ();
+    return m_lineStore.maximumLineCount ();
 }
 
 void Console::setDisplaySize(int displaySize)
 {
-    document ()->setMaximumBlockCount (displaySize);
+    m_lineStore.setMaximumLineCount (displaySize);
+    updateScrollBars ();
+    viewport ()->update ();
+}
+
+qint64 Console::lineCount() const
+{
+    return m_lineStore.lineCount();
 }
 
 int Console::getHexWrap() const
@@ -367,107 +552,253 @@ void Console::keyPressEvent(QKeyEvent *e)
 {
     int key = e->key();
     int modifier = static_cast<int> (e->modifiers ());
+    bool echo = m_localEchoEnabled && !m_displayHexValuesEnabled && !m_readOnly;
 //    qDebug() << __PRETTY_FUNCTION__ << key;
     if (modifier == Qt::ControlModifier && (key == Qt::Key_C || key == Qt::Key_V || key == Qt::Key_A))
     {
-        if (key == Qt::Key_C || key == Qt::Key_A)
+        /* Ctrl-C (Copy) and Ctrl-A (Select all) can be used anytime */
+        if (key == Qt::Key_C)
+        {
+            copy();
+        }
+        else if (key == Qt::Key_A)
         {
-            /* Ctrl-C (Copy) and Ctrl-A (Select all) can be forwarded anytime */
-            QPlainTextEdit::keyPressEvent(e);
+            selectAll();
         }
         else
         {
             /* Ctrl-V (Paste) */
-            if (m_localEchoEnabled)
-            {
-                moveCursor(QTextCursor::End, QTextCursor::MoveAnchor);
-                QPlainTextEdit::keyPressEvent(e);
-            }
-            QClipboard *clipboard = QApplication::clipboard();
-            QString originalText = clipboard->text();
-            emit getData(originalText.toLocal8Bit ());
+            paste();
         }
     }
     else if ((key >= Qt::Key_Space && key <= Qt::Key_ydiaeresis)
             && (modifier == Qt::NoModifier || modifier == Qt::ShiftModifier || modifier == Qt::KeypadModifier ))
     {
-        if (m_localEchoEnabled && !m_displayHexValuesEnabled)
+        if (echo)
         {
-            moveCursor(QTextCursor::End, QTextCursor::MoveAnchor);
-            QPlainTextEdit::keyPressEvent(e);
+            appendText(e->text().toLocal8Bit());
+            scrollToBottom();
         }
         emit getData(e->text().toLocal8Bit());
     }
     else
     {
         key |= modifier;
-        if (m_localEchoEnabled && !m_displayHexValuesEnabled)
+        if (m_keyMap.contains(key))
         {
-            if ((m_keyMap.contains(key) && m_keyMap[key].m_handleKey) || !m_keyMap.contains(key))
+            if (echo && m_keyMap[key].m_handleKey)
             {
-                moveCursor(QTextCursor::End, QTextCursor::MoveAnchor);
-                QPlainTextEdit::keyPressEvent(e);
+                /* Return and Enter */
+                appendText(NATIVE_LINEENDNG);
+                scrollToBottom();
             }
-        }
-        if (m_keyMap.contains(key))
-        {
             QByteArray data = m_keyMap[key].m_str.toLocal8Bit();
             if (data.length () > 0)
             {
                 emit getData(data);
             }
         }
+        else
+        {
+            /* Arrows and page up/down scroll */
+            QAbstractScrollArea::keyPressEvent(e);
+        }
     }
 }
 
 void Console::contextMenuEvent(QContextMenuEvent *e)
 {
-    const bool showTextSelectionActions = textInteractionFlags() & (Qt::TextEditable | Qt::TextSelectableByKeyboard | Qt::TextSelectableByMouse);
-
     QMenu *menu = new QMenu;
     QAction *a;
 
-    if (showTextSelectionActions)
-    {
-        a = menu->addAction(tr("&Copy"), this, SLOT(copy()), QKeySequence::Copy);
-        a->setEnabled(textCursor().hasSelection());
-    }
+    a = menu->addAction(tr("&Copy"), this, SLOT(copy()), QKeySequence::Copy);
+    a->setEnabled(hasSelection());
 
-    if (textInteractionFlags() & Qt::TextEditable)
+    if (!m_readOnly)
     {
 #if !defined(QT_NO_CLIPBOARD)
         a = menu->addAction(tr("&Paste"), this, SLOT(paste()), QKeySequence::Paste);
-        a->setEnabled(canPaste());
+        a->setEnabled(!QApplication::clipboard()->text().isEmpty());
 #endif
     }
 
-    if (showTextSelectionActions)
+    menu->addSeparator();
+    a = menu->addAction(tr("Select All"), this, SLOT(selectAll()), QKeySequence::SelectAll);
+    a->setEnabled(m_lineStore.lineCount() > 1 || !m_lineStore.line(m_lineStore.lastLineNumber()).isEmpty());
+
+    menu->exec(e->globalPos());
+    delete menu;
+}
+
+void Console::paintEvent(QPaintEvent *e)
+{
+    QPainter painter(viewport());
+    QFontMetrics metrics = fontMetrics();
+    int lineHeight = metrics.height();
+    int width = charWidth();
+    int x = -horizontalScrollBar()->value();
+    qint64 topLine = m_lineStore.firstLineNumber() + verticalScrollBar()->value();
+    qint64 lastLine = qMin(topLine + e->rect().bottom() / lineHeight, m_lineStore.lastLineNumber());
+    position_t start;
+    position_t end;
+
+    selectionRange(&start, &end);
+    painter.setFont(font());
+    /* Only rows on the screen are painted */
+    for (qint64 line = topLine + e->rect().top() / lineHeight; line <= lastLine; line++)
+    {
+        QString text = displayLine(line);
+        int y = static_cast<int>(line - topLine) * lineHeight;
+
+        painter.setPen(palette().color(QPalette::Text));
+        painter.drawText(x, y + metrics.ascent(), text);
+        if (line >= start.line && line <= end.line && (start.line != end.line || start.column != end.column))
+        {
+            int from = line == start.line ? start.column : 0;
+            /* Line ending is selected too */
+            int to = line == end.line ? end.column : text.length() + 1;
+            QRect rect(x + from * width, y, (to - from) * width, lineHeight);
+
+            painter.fillRect(rect, palette().brush(QPalette::Highlight));
+            painter.save();
+            painter.setClipRect(rect);
+            painter.setPen(palette().color(QPalette::HighlightedText));
+            painter.drawText(x, y + metrics.ascent(), text);
+            painter.restore();
+        }
+        if (line == m_lineStore.lastLineNumber() && hasFocus() && !m_readOnly)
+        {
+            /* Cursor at end of text */
+            painter.fillRect(x + text.length() * width, y, qMax(width / 8, 1), lineHeight,
+                             palette().brush(QPalette::Text));
+        }
+    }
+}
+
+void Console::resizeEvent(QResizeEvent *e)
+{
+    QAbstractScrollArea::resizeEvent(e);
+    updateScrollBars();
+}
+
+void Console::changeEvent(QEvent *e)
+{
+    QAbstractScrollArea::changeEvent(e);
+    if (e->type() == QEvent::FontChange)
     {
-        menu->addSeparator();
-        a = menu->addAction(tr("Select All"), this, SLOT(selectAll()), QKeySequence::SelectAll);
-        a->setEnabled(!document()->isEmpty());
+        updateScrollBars();
+        viewport()->update();
     }
+}
 
-    menu->exec(mapToGlobal(e->pos()));
-    delete menu;
+void Console::focusInEvent(QFocusEvent *e)
+{
+    QAbstractScrollArea::focusInEvent(e);
+    viewport()->update();
+}
+
+void Console::focusOutEvent(QFocusEvent *e)
+{
+    QAbstractScrollArea::focusOutEvent(e);
+    viewport()->update();
+}
+
+void Console::mousePressEvent(QMouseEvent *e)
+{
+    if (e->button() == Qt::LeftButton)
+    {
+        position_t position = positionAt(e->pos());
+        if (!(e->modifiers() & Qt::ShiftModifier))
+        {
+            m_selectionAnchor = position;
+        }
+        m_selectionEnd = position;
+        m_selecting = true;
+        viewport()->update();
+    }
+}
+
+void Console::mouseMoveEvent(QMouseEvent *e)
+{
+    if (m_selecting)
+    {
+        /* Scroll while selecting above or below the view */
+        if (e->pos().y() < 0)
+        {
+            verticalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepSub);
+        }
+        else if (e->pos().y() >= viewport()->height())
+        {
+            verticalScrollBar()->triggerAction(QAbstractSlider::SliderSingleStepAdd);
+        }
+        m_selectionEnd = positionAt(e->pos());
+        viewport()->update();
+    }
+}
+
+void Console::mouseReleaseEvent(QMouseEvent *e)
+{
+    if (e->button() == Qt::LeftButton && m_selecting)
+    {
+        QClipboard *clipboard = QApplication::clipboard();
+
+        m_selecting = false;
+        if (hasSelection() && clipboard->supportsSelection())
+        {
+            clipboard->setText(selectedText(), QClipboard::Selection);
+        }
+    }
+}
+
+/**
+ * @brief Console::mouseDoubleClickEvent
+ * Selects word under mouse.
+ */
+void Console::mouseDoubleClickEvent(QMouseEvent *e)
+{
+    if (e->button() == Qt::LeftButton)
+    {
+        position_t position = positionAt(e->pos());
+        QString text = displayLine(position.line);
+        int start = position.column;
+        int end = position.column;
+
+        while (start > 0 && (text.at(start - 1).isLetterOrNumber() || text.at(start - 1) == '_'))
+        {
+            start--;
+        }
+        while (end < text.length() && (text.at(end).isLetterOrNumber() || text.at(end) == '_'))
+        {
+            end++;
+        }
+        m_selectionAnchor.line = position.line;
+        m_selectionAnchor.column = start;
+        m_selectionEnd.line = position.line;
+        m_selectionEnd.column = end;
+        viewport()->update();
+    }
+}
+
+void Console::scrollContentsBy(int dx, int dy)
+{
+    Q_UNUSED(dx);
+    Q_UNUSED(dy);
+    viewport()->update();
 }
 
 /**
  * @brief Console::appendDataToConsole
- * Append serial data to console document.
+ * Append serial data to console.
  *
  * @param data    Data to append (for ASCII view).
  * @param rawData Data to append (for hexadecimal view).
- * @param scrollToEnd Scroll to end of document.
- * @param rebuild Rebuild whole text document.
+ * @param scrollToEnd Scroll to end of console.
+ * @param rebuild Rebuild whole console.
  */
 void Console::appendDataToConsole(const QByteArray &data, const QByteArray &dataRaw, bool scrollToEnd, bool rebuild)
 {
-#if CURSOR_MODE == 0
-    moveCursor(QTextCursor::End, QTextCursor::MoveAnchor);
-#else
-    setCursor(m_cursor);
-#endif
+    /* Keep the same lines on screen when oldest lines are removed */
+    qint64 topLine = m_lineStore.firstLineNumber() + verticalScrollBar()->value();
 
     if (!m_displayHexValuesEnabled)
     {
@@ -475,11 +806,6 @@ void Console::appendDataToConsole(const QByteArray &data, const QByteArray &data
         QByteArray data2, newLine;
         data2 = data;
 
-        if (m_displayTimestampEnabled && !rebuild)
-        {
-            addTimestamp(data2);
-        }
-
         newLine = QByteArray(NATIVE_LINEENDNG);
         data2.replace (m_lineEndingRx.toLocal8Bit(), newLine);
         if (m_lineEndingRx == "\r\n" || m_lineEndingRx == "\n\r")
@@ -494,182 +820,363 @@ void Console::appendDataToConsole(const QByteArray &data, const QByteArray &data
                 int pos = data2.indexOf(BACKSPACE);
                 if (pos >= 0)
                 {
-                    insertPlainText(QString(data2.left(pos)));
+                    appendText(data2.left(pos));
                     data2.remove(0, pos + 1);
-#if CURSOR_MODE == 0
                     /* Not good solution: backspace should not clear character
                      * only move cursor left.
                      */
-                    QTextCursor cursor = textCursor();
-                    cursor.movePosition(QTextCursor::End);
-                    cursor.deletePreviousChar();
-#else
-                    moveCursor(QTextCursor::Left, QTextCursor::MoveAnchor);
-#endif
+                    m_lineStore.removeLastChar();
                 }
                 else
                 {
-                    insertPlainText(QString(data2));
+                    appendText(data2);
                     break;
                 }
             }
         }
         else
         {
-            insertPlainText(QString(data2));
+            appendText(data2);
         }
     }
     else if (rebuild)
     {
         /* Hexadecimal display mode, rebuild console */
-        insertPlainText (dumpBuf (dataRaw, m_hexWrap));
+        m_hexRowLine = -1;
+        appendHexData (dataRaw.constData (), dataRaw.size (), 0);
     }
     else
     {
-        int size = m_dataRaw.size ();
-        int mod = size % m_hexWrap;
+        /* Hexadecimal display mode, data is already stored */
+        appendHexData (dataRaw.constData (), dataRaw.size (), m_dataStore.endPosition () - dataRaw.size ());
+    }
 
-        /* Hexadecimal display mode */
-        if (mod > 0)
-        {
-            /* Delete last line, because it shall be rebuild again. */
-            QTextCursor cursor = textCursor();
-            cursor.movePosition(QTextCursor::End);
-            cursor.deletePreviousChar();
-            cursor.select(QTextCursor::LineUnderCursor);
-            cursor.removeSelectedText();
-            setTextCursor(cursor);
-        }
+    updateScrollBars();
+    if (scrollToEnd)
+    {
+        scrollToBottom();
+    }
+    else
+    {
+        verticalScrollBar()->setValue(static_cast<int>(topLine - m_lineStore.firstLineNumber()));
+    }
+}
+
+/**
+ * @brief Console::appendText
+ * Appends text to the last line of console, '\n' starts a new line.
+ */
+void Console::appendText(const QByteArray &text)
+{
+    m_lineStore.append(text.constData(), text.length());
+    viewport()->update();
+}
 
-        /* Get data which was in last line */
-        QByteArray data2;
-        data2 = m_dataRaw.right (mod);
-        data2.append (dataRaw);
+/**
+ * @brief Console::appendHexData
+ * Adds data to hexadecimal view. Rows are aligned to position of data.
+ * Cells of the partially filled last row are written in place and further
+ * bytes are appended as new rows, so cost depends only on new data.
+ *
+ * @param position Position of data in m_dataStore.
+ */
+void Console::appendHexData(const char *data, int len, qint64 position)
+{
+    int mod = static_cast<int> (position % m_hexWrap);
 
-        insertPlainText (dumpBuf (data2, m_hexWrap));
-    }
-#if CURSOR_MODE == 1
-    m_cursor = cursor();
-#endif
+    if (mod > 0 && len > 0)
+    {
+        int n = qMin (m_hexWrap - mod, len);
 
-    if (scrollToEnd)
+        if (m_hexRowLine >= m_lineStore.firstLineNumber ())
+        {
+            QByteArray cells;
+            /* One more byte is needed by HexDump::formatHex() */
+            cells.resize (n * 3 + 1);
+            HexDump::formatHex (cells.data (), data, n);
+            m_lineStore.overwrite (m_hexRowLine, mod * 3, cells.constData (), n * 3);
+            HexDump::formatAscii (cells.data (), data, n);
+            m_lineStore.overwrite (m_hexRowLine, m_hexWrap * 3 + 2 + mod, cells.constData (), n);
+            viewport ()->update ();
+        }
+        else
+        {
+            /* Row is not on display, it is started again from stored data */
+            appendText (dumpBuf (m_dataStore.mid (position - mod, mod + n), m_hexWrap));
+            m_hexRowLine = m_lineStore.lastLineNumber () - 1;
+        }
+        if (mod + n == m_hexWrap)
+        {
+            m_hexRowLine = -1;
+        }
+        data += n;
+        len -= n;
+    }
+    if (len > 0)
     {
-        QScrollBar *bar = verticalScrollBar();
-        bar->setValue(bar->maximum());
-        /* Maybe only this needed */
-        ensureCursorVisible();
+        QByteArray rows;
+        HexDump::appendRows (rows, data, len, m_hexWrap);
+        appendText (rows);
+        /* Every row ends with new line, partial row is the one before the open line */
+        m_hexRowLine = (len % m_hexWrap) ? m_lineStore.lastLineNumber () - 1 : -1;
     }
 }
 
 /**
  * @brief Console::rebuildConsole
- * Regenerate console document.
+ * Regenerate console lines.
  */
 void Console::rebuildConsole()
 {
-    QPlainTextEdit::clear();
-    if (!m_displayHexValuesEnabled && m_displayTimestampEnabled)
+    m_lineStore.clear();
+    m_selectionEnd = m_selectionAnchor;
+    /* Only data of lines which fit on display is rendered */
+    if (m_displayHexValuesEnabled)
     {
-        appendDataToConsole (m_dataTimestamp, m_dataRaw, true, true);
+        qint64 end = m_dataStore.endPosition ();
+        qint64 start = qMax (m_dataStore.firstPosition (), end - static_cast<qint64> (getDisplaySize ()) * m_hexWrap);
+        /* First row starts at a multiple of m_hexWrap like rows added later */
+        start += (m_hexWrap - start % m_hexWrap) % m_hexWrap;
+        appendDataToConsole (QByteArray(), m_dataStore.mid (start, end - start), true, true);
     }
     else
     {
-        appendDataToConsole (m_data, m_dataRaw, true, true);
+        appendDataToConsole (renderData(m_displayTimestampEnabled, getDisplaySize ()), QByteArray(), true, true);
     }
 }
 
 /**
- * @brief Console::dumpBuf
- * Creates hexadecimal dump of a buffer.
+ * @brief Console::renderData
+ * Renders stored data for the ASCII view.
  *
- * @param buf Buffer to convert hexadecimal ASCII.
- * @param hexWrap Wrap size. Usual values: 8, 16.
- * @return ASCII text.
+ * @param timestamp Add arrival time at start of lines.
+ * @param maximumLines Render only the last lines, -1: all.
  */
-QString Console::dumpBuf(const QByteArray &buf, int hexWrap)
+QByteArray Console::renderData(bool timestamp, qint64 maximumLines) const
 {
-    QString str;
-    QString str2;
-    int i, j, s;
-    int bufSize = buf.length ();
+    const QList<ConsoleDataStore::segment_t> &segments = m_dataStore.segments();
+    int firstSegment = 0;
+    int firstRun = 0;
+    QByteArray text;
 
-    /* Extend buffer size to be dividable with hexWrap */
-    if (bufSize % hexWrap == 0)
-    {
-        s = bufSize;
-    }
-    else
+    if (maximumLines >= 0)
     {
-        s = bufSize + hexWrap - (bufSize % hexWrap);
-    }
-    for (i = 0; i < s; i++)
-    {
-        /* Print buffer in hexadecimal format */
-        if (i < bufSize)
+        /* Find start of the last lines backwards */
+        qint64 lines = 0;
+        bool found = maximumLines == 0;
+        firstSegment = segments.size();
+        while (!found && firstSegment > 0)
         {
-            str2.asprintf ("%02X", (quint8) buf[i]);
-            str += str2;
+            const QVector<ConsoleDataStore::run_t> &runs = segments.at(--firstSegment).runs;
+            for (firstRun = runs.size() - 1; firstRun >= 0; firstRun--)
+            {
+                if ((runs.at(firstRun).flags & ConsoleDataStore::RUN_lineStart) && ++lines >= maximumLines)
+                {
+                    found = true;
+                    break;
+                }
+            }
+            /* Not found in this segment: continue with the previous one */
         }
-        else
+        if (!found && firstSegment == 0)
         {
-            str += "  ";
+            /* Fewer lines are stored, all of them are rendered */
+            firstRun = 0;
         }
-        str += " ";
-        if ((i + 1) % hexWrap == 0)
+    }
+    for (int i = firstSegment; i < segments.size(); i++)
+    {
+        const ConsoleDataStore::segment_t &segment = segments.at(i);
+        const char *data = segment.data.constData();
+        for (int j = 0; j < segment.runs.size(); j++)
         {
-            /* Print buffer in ASCII format */
-            str += "  ";
-            for (j = i - (hexWrap - 1); j <= i; j++)
+            const ConsoleDataStore::run_t &run = segment.runs.at(j);
+            if (i > firstSegment || j >= firstRun)
             {
-                if (j < bufSize)
-                {
-                    if ((quint8) buf[j] >= 0x20u && (quint8)buf[j] <= 0x7Fu)
-                    {
-                        str += buf[j];
-                    }
-                    else
-                    {
-                        str += ".";
-                    }
-                }
-                else
-                {
-                    str += " ";
-                }
+                renderRun(text, data, static_cast<int>(run.length), run.arrivalTime_ms, run.flags, timestamp);
             }
-            str += "\n";
+            data += run.length;
         }
     }
+    return text;
+}
 
-    return str;
+/**
+ * @brief Console::renderRun
+ * Appends a run to text: line ending of automatic wrap, timestamp at start
+ * of line and data.
+ */
+void Console::renderRun(QByteArray &text, const char *data, int len, qint64 arrivalTime_ms, quint8 flags, bool timestamp) const
+{
+    if (flags & ConsoleDataStore::RUN_wrapped)
+    {
+        text += m_lineEndingRx.toLocal8Bit();
+    }
+    if (timestamp && (flags & ConsoleDataStore::RUN_lineStart))
+    {
+        m_timestampFormatter.append(text, arrivalTime_ms);
+    }
+    text.append(data, len);
 }
 
-void Console::addTimestamp(QByteArray &buf)
+/**
+ * @brief Console::displayLine
+ * @return Line as it is painted: UTF-8 decoded, tabs are expanded.
+ */
+QString Console::displayLine(qint64 lineNumber) const
 {
-    QString timestamp = getTimestamp();
+    QString text = QString::fromUtf8(m_lineStore.line(lineNumber));
+    int i = 0;
 
-    /* Adding timestamps after every new line character */
-    QString data2 = buf;
-    /* -2 -> not adding timestamp for the last one */
-    if (data2.length())
+    while ((i = text.indexOf('\t', i)) >= 0)
     {
-        if ( m_startWithTimestamp)
-        {
-            m_startWithTimestamp = false;
-            data2.insert(0, timestamp.toLocal8Bit());
-        }
-        for (int i = data2.length() - 2; i >= 0; i--)
+        int spaces = tabStop - i % tabStop;
+        text.replace(i, 1, QString(spaces, ' '));
+        i += spaces;
+    }
+    return text;
+}
+
+/**
+ * @brief Console::charWidth
+ * @return Width of a character. Font of console is monospace.
+ */
+int Console::charWidth() const
+{
+#if QT_VERSION >= 0x050B00
+    return qMax(fontMetrics().horizontalAdvance(' '), 1);
+#else
+    return qMax(fontMetrics().width(' '), 1);
+#endif
+}
+
+/**
+ * @brief Console::visibleLines
+ * @return Number of lines which fit in the view.
+ */
+int Console::visibleLines() const
+{
+    return qMax(viewport()->height() / fontMetrics().height(), 1);
+}
+
+/**
+ * @brief Console::positionAt
+ * @return Character position nearest to a point of viewport.
+ */
+Console::position_t Console::positionAt(const QPoint &pos) const
+{
+    position_t position;
+    int row = pos.y() < 0 ? -1 : pos.y() / fontMetrics().height();
+    int width = charWidth();
+
+    position.line = qBound(m_lineStore.firstLineNumber(),
+                           m_lineStore.firstLineNumber() + verticalScrollBar()->value() + row,
+                           m_lineStore.lastLineNumber());
+    position.column = qBound(0, (pos.x() + horizontalScrollBar()->value() + width / 2) / width,
+                             displayLine(position.line).length());
+    return position;
+}
+
+/**
+ * @brief Console::selectionRange
+ * Gets selection in order. Part of selection which was removed with the
+ * oldest lines is dropped.
+ */
+void Console::selectionRange(Console::position_t *start, Console::position_t *end) const
+{
+    if (m_selectionEnd.line < m_selectionAnchor.line
+            || (m_selectionEnd.line == m_selectionAnchor.line && m_selectionEnd.column < m_selectionAnchor.column))
+    {
+        *start = m_selectionEnd;
+        *end = m_selectionAnchor;
+    }
+    else
+    {
+        *start = m_selectionAnchor;
+        *end = m_selectionEnd;
+    }
+    if (start->line < m_lineStore.firstLineNumber())
+    {
+        start->line = m_lineStore.firstLineNumber();
+        start->column = 0;
+        if (end->line < start->line)
         {
-            if (data2[i] == m_lineEndingRx.right(1).toLatin1())
-            {
-                data2.insert(i + 1, timestamp.toLocal8Bit());
-            }
+            *end = *start;
         }
     }
-    if (data2[data2.length() - 1] == m_lineEndingRx.right(1).toLatin1())
+}
+
+/**
+ * @brief Console::updateScrollBars
+ * Sets ranges of scroll bars: vertical is in lines, horizontal is in pixels.
+ */
+void Console::updateScrollBars()
+{
+    QScrollBar *bar = verticalScrollBar();
+    int lines = visibleLines();
+    /* One more character for the cursor */
+    int width = (m_lineStore.maximumLineLength() + 1) * charWidth();
+
+    bar->setRange(0, static_cast<int>(qMax<qint64>(m_lineStore.lineCount() - lines, 0)));
+    bar->setPageStep(lines);
+    bar->setSingleStep(1);
+    bar = horizontalScrollBar();
+    bar->setRange(0, qMax(width - viewport()->width(), 0));
+    bar->setPageStep(viewport()->width());
+    bar->setSingleStep(charWidth());
+}
+
+void Console::scrollToBottom()
+{
+    QScrollBar *bar = verticalScrollBar();
+
+    bar->setValue(bar->maximum());
+    horizontalScrollBar()->setValue(0);
+}
+
+/**
+ * @brief Console::ensureVisible
+ * Scrolls the view to show a character position.
+ */
+void Console::ensureVisible(const Console::position_t &position)
+{
+    QScrollBar *bar = verticalScrollBar();
+    int lines = visibleLines();
+    int width = charWidth();
+    int row = static_cast<int>(position.line - m_lineStore.firstLineNumber());
+    int x = position.column * width;
+
+    if (row < bar->value())
+    {
+        bar->setValue(row);
+    }
+    else if (row >= bar->value() + lines)
+    {
+        bar->setValue(row - lines + 1);
+    }
+    bar = horizontalScrollBar();
+    if (x < bar->value())
+    {
+        bar->setValue(x);
+    }
+    else if (x + width > bar->value() + viewport()->width())
     {
-        m_startWithTimestamp = true;
+        bar->setValue(x + width - viewport()->width());
     }
+}
+
+/**
+ * @brief Console::dumpBuf
+ * Creates hexadecimal dump of a buffer.
+ *
+ * @param buf Buffer to convert hexadecimal ASCII.
+ * @param hexWrap Wrap size. Usual values: 8, 16.
+ * @return ASCII text.
+ */
+QByteArray Console::dumpBuf(const QByteArray &buf, int hexWrap)
+{
+    QByteArray str;
 
-    buf = data2.toLocal8Bit();
+    HexDump::appendRows (str, buf.constData (), buf.length (), hexWrap);
+    return str;
 }
@@ -39,14 +39,21 @@
 #ifndef CONSOLE_H
 #define CONSOLE_H
 
-#include <QPlainTextEdit>
+#include <QAbstractScrollArea>
 #include <QDateTime>
-
-/* 0: working, but should be improved */
-/* 1: to be implemented */
-#define CURSOR_MODE  0
-
-class Console : public QPlainTextEdit
+#include <QElapsedTimer>
+
+#include "timestampformatter.h"
+#include "consolelinestore.h"
+#include "consoledatastore.h"
+
+/**
+ * @brief The Console class
+ * Terminal view of received data. Lines are kept in a ConsoleLineStore and
+ * only the rows on the screen are painted, so cost of painting does not
+ * depend on the number of lines.
+ */
+class Console : public QAbstractScrollArea
 {
     Q_OBJECT
 
@@ -54,9 +61,19 @@ signals:
     void getData(const QByteArray &data);
 
 public:
+    /** Cost of putData() calls, see takePutDataStatistics(). */
+    typedef struct
+    {
+        qint64 calls;
+        qint64 bytes;
+        qint64 time_ns;         /**< Time spent in putData(). */
+        qint64 maxTime_ns;      /**< Longest call. */
+    } putDataStatistics_t;
+
     explicit Console(QWidget *parent = 0);
 
-    void putData(const QByteArray &dataRaw);
+    void putData(const QByteArray &dataRaw, qint64 timestamp_ms = -1,
+                 ConsoleDataStore::direction_t direction = ConsoleDataStore::DIRECTION_rx);
 
     bool isLocalEchoEnabled() const;
     void setLocalEchoEnabled(bool localEchoEnabled = true);
@@ -64,11 +81,15 @@ public:
     bool isUpdateEnabled() const;
     void setUpdateEnabled(bool updateEnabled = true);
 
+    bool isReadOnly() const;
+    void setReadOnly(bool readOnly);
+
     int getDataSizeLimit() const;
     void setDataSizeLimit(int dataSizeLimit_bytes);
 
     int getDisplaySize() const;
     void setDisplaySize(int displaySize);
+    qint64 lineCount() const;
 
     int getHexWrap() const;
     void setHexWrap(int hexWrap);
@@ -94,9 +115,18 @@ public:
     void setTimestampFormatString(const QString& format);
     QString getTimestampFormatString();
 
+    bool hasSelection() const;
+    QString selectedText() const;
+    bool find(const QString &text, bool caseSens, bool wholeWords, bool regEx);
+
+    putDataStatistics_t takePutDataStatistics();
+    qint64 bufferMemory() const;
+
 public slots:
     void clear();
+    void copy();
     void paste();
+    void selectAll();
 
 public:
     QVariant m_bgcolordef;
@@ -105,13 +135,46 @@ public:
     QVariant m_fgcolordef;
     QVariant m_timestampcolordef;
 
+protected:
+    virtual void paintEvent(QPaintEvent *e);
+    virtual void resizeEvent(QResizeEvent *e);
+    virtual void changeEvent(QEvent *e);
+    virtual void focusInEvent(QFocusEvent *e);
+    virtual void focusOutEvent(QFocusEvent *e);
+    virtual void mousePressEvent(QMouseEvent *e);
+    virtual void mouseMoveEvent(QMouseEvent *e);
+    virtual void mouseReleaseEvent(QMouseEvent *e);
+    virtual void mouseDoubleClickEvent(QMouseEvent *e);
+    virtual void scrollContentsBy(int dx, int dy);
+
 private:
+    /** Tab stops are at every tabStop characters. */
+    static const int tabStop = 8;
+
+    /** Character position in the console, line is a ConsoleLineStore line number. */
+    typedef struct
+    {
+        qint64 line;
+        int column;
+    } position_t;
+
     virtual void keyPressEvent(QKeyEvent *e);
     virtual void contextMenuEvent(QContextMenuEvent *e);
     void appendDataToConsole(const QByteArray &data, const QByteArray &dataRaw, bool scrollToEnd = true, bool rebuild = false);
+    void appendText(const QByteArray &text);
+    void appendHexData(const char *data, int len, qint64 position);
     void rebuildConsole();
-    QString dumpBuf(const QByteArray& buf, int hexWrap);
-    void addTimestamp(QByteArray& buf);
+    QByteArray dumpBuf(const QByteArray& buf, int hexWrap);
+    QByteArray renderData(bool timestamp, qint64 maximumLines) const;
+    void renderRun(QByteArray &text, const char *data, int len, qint64 arrivalTime_ms, quint8 flags, bool timestamp) const;
+    QString displayLine(qint64 lineNumber) const;
+    int charWidth() const;
+    int visibleLines() const;
+    position_t positionAt(const QPoint &pos) const;
+    void selectionRange(position_t *start, position_t *end) const;
+    void updateScrollBars();
+    void scrollToBottom();
+    void ensureVisible(const position_t &position);
 
     class KeyMap
     {
@@ -119,37 +182,36 @@ private:
       KeyMap() : m_handleKey(false), m_str("") {}
       KeyMap(bool key, QString str) { m_handleKey = key; m_str = str; }
 
-      bool m_handleKey; /**< true: Handle key by QPlainTextEdit */
+      bool m_handleKey; /**< true: Key is echoed to console (local echo) */
       QString m_str;    /**< Text to be sent, when key is pressed */
     };
 
     bool m_localEchoEnabled;
     bool m_updateEnabled;
+    bool m_readOnly;
     bool m_displayTimestampEnabled;
     bool m_displayHexValuesEnabled;
     int m_hexWrap;
     QString m_lineEndingRx;
     QString m_lineEndingTx;
     QMap<unsigned int,KeyMap> m_keyMap;
-    /* TODO There should be different documents (QDocument?) for
-     * - ASCII without timestamp
-     * - ASCII with timestamp
-     * - hexadecimal
-     * Adding colors to timestamp could possible...
-     */
-    QByteArray m_data;          /**< Serial data for ASCII view */
-    QByteArray m_dataRaw;       /**< Raw serial data for hexadecimal view */
-    QByteArray m_dataTimestamp; /**< Serial data with timestamp */
+    ConsoleDataStore m_dataStore;   /**< Serial data, ASCII, timestamped and hexadecimal views are rendered from it */
     int m_dataSizeLimit_bytes;
     int m_dataSizeHysteresis_percent;
     int m_autoWrapColumn;       /**< Automatically wrap text after m_autoWrapColumn characters */
     int m_noLineEndingCntr;     /**< Distance from last line ending character (for auto wrap) */
     QString m_timestampFormatString;
-#if CURSOR_MODE == 1
-    QCursor m_cursor;
-#endif
-    /** Add timestamp before text because last time text finished with line ending */
-    bool m_startWithTimestamp;
+    mutable TimestampFormatter m_timestampFormatter;
+    qint64 m_arrivalTime_ms;    /**< Arrival time of data being processed by putData() */
+    QElapsedTimer m_putDataTimer;
+    putDataStatistics_t m_putDataStatistics;    /**< Collected since last takePutDataStatistics() */
+    /** Next data starts a line because last data finished with line ending */
+    bool m_lineStart;
+    ConsoleLineStore m_lineStore;   /**< Lines on display */
+    qint64 m_hexRowLine;            /**< Line of the partially filled last hexadecimal row, -1: row is complete */
+    position_t m_selectionAnchor;   /**< Where selection was started */
+    position_t m_selectionEnd;      /**< Equals to m_selectionAnchor if nothing is selected */
+    bool m_selecting;               /**< Left mouse button is pressed */
 };
 
 #endif // CONSOLE_H
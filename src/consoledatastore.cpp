@@ -0,0 +1,156 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include "consoledatastore.h"
+
+ConsoleDataStore::ConsoleDataStore()
+    : m_endPosition(0)
+{
+}
+
+/**
+ * @brief ConsoleDataStore::append
+ * Stores data. It is added to the last run if it continues the line in the
+ * same direction. Data which does not fit into the last segment goes to a
+ * new one, its run continues there.
+ *
+ * @param flags RUN_lineStart, RUN_wrapped or 0.
+ */
+void ConsoleDataStore::append(const char *data, int len, qint64 arrivalTime_ms, direction_t direction, quint8 flags)
+{
+    while (len > 0)
+    {
+        if (m_segments.isEmpty() || m_segments.last().data.size() >= segmentSize)
+        {
+            segment_t segment;
+            segment.position = m_endPosition;
+            segment.data.reserve(segmentSize);
+            m_segments.append(segment);
+        }
+        segment_t &segment = m_segments.last();
+        int partLen = qMin(len, segmentSize - segment.data.size());
+
+        segment.data.append(data, partLen);
+        if (!flags && !segment.runs.isEmpty() && segment.runs.last().direction == direction)
+        {
+            segment.runs.last().length += static_cast<quint32>(partLen);
+        }
+        else
+        {
+            run_t run;
+            run.arrivalTime_ms = arrivalTime_ms;
+            run.length = static_cast<quint32>(partLen);
+            run.direction = static_cast<quint8>(direction);
+            run.flags = flags;
+            segment.runs.append(run);
+        }
+        flags = 0;
+        data += partLen;
+        len -= partLen;
+        m_endPosition += partLen;
+    }
+}
+
+/**
+ * @brief ConsoleDataStore::trim
+ * Frees the oldest segments if size exceeds the limit. Hysteresis keeps it
+ * from running on every append.
+ *
+ * @param sizeLimit Nothing is freed below this size.
+ * @param targetSize Segments are freed until size is not above this.
+ */
+void ConsoleDataStore::trim(qint64 sizeLimit, qint64 targetSize)
+{
+    if (size() <= sizeLimit)
+    {
+        return;
+    }
+    while (!m_segments.isEmpty() && size() > targetSize)
+    {
+        m_segments.removeFirst();
+    }
+}
+
+/**
+ * @brief ConsoleDataStore::clear
+ * Removes all data, positions start from zero again.
+ */
+void ConsoleDataStore::clear()
+{
+    m_segments.clear();
+    m_endPosition = 0;
+}
+
+/**
+ * @brief ConsoleDataStore::firstPosition
+ * @return Position of the oldest byte stored.
+ */
+qint64 ConsoleDataStore::firstPosition() const
+{
+    return m_segments.isEmpty() ? m_endPosition : m_segments.first().position;
+}
+
+qint64 ConsoleDataStore::endPosition() const
+{
+    return m_endPosition;
+}
+
+qint64 ConsoleDataStore::size() const
+{
+    return m_endPosition - firstPosition();
+}
+
+/**
+ * @brief ConsoleDataStore::mid
+ * Copies stored data. Part of range which is not stored is left out.
+ *
+ * @param position Position of first byte.
+ * @param len Number of bytes.
+ */
+QByteArray ConsoleDataStore::mid(qint64 position, qint64 len) const
+{
+    qint64 end = qMin(position + len, m_endPosition);
+    QByteArray data;
+    int i;
+
+    position = qMax(position, firstPosition());
+    if (position >= end)
+    {
+        return data;
+    }
+    data.reserve(static_cast<int>(end - position));
+    /* Segments are full except the last one, the first one is found directly */
+    i = static_cast<int>((position - firstPosition()) / segmentSize);
+    for (; i < m_segments.size() && position < end; i++)
+    {
+        const segment_t &segment = m_segments.at(i);
+        int offset = static_cast<int>(position - segment.position);
+        int partLen = static_cast<int>(qMin<qint64>(end - position, segment.data.size() - offset));
+        data.append(segment.data.constData() + offset, partLen);
+        position += partLen;
+    }
+    return data;
+}
+
+const QList<ConsoleDataStore::segment_t> &ConsoleDataStore::segments() const
+{
+    return m_segments;
+}
+
+/**
+ * @brief ConsoleDataStore::memory
+ * @return Memory allocated for data and runs.
+ */
+qint64 ConsoleDataStore::memory() const
+{
+    qint64 memory = 0;
+
+    foreach (const segment_t &segment, m_segments)
+    {
+        memory += segment.data.capacity() + static_cast<qint64>(segment.runs.capacity()) * sizeof(run_t);
+    }
+    return memory;
+}
@@ -0,0 +1,77 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef CONSOLEDATASTORE_H
+#define CONSOLEDATASTORE_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+/**
+ * @brief The ConsoleDataStore class
+ * Data shown by the console, stored once as received. Bytes are grouped into
+ * runs: a run starts where a line starts (after line ending or at an
+ * automatic wrap) or where direction changes. Runs hold what is needed to
+ * render the ASCII, timestamped and hexadecimal views again: arrival time,
+ * direction and wrap points.
+ * Data is kept in fixed size segments, so the oldest data is freed a whole
+ * segment at a time without moving the rest.
+ */
+class ConsoleDataStore
+{
+public:
+    typedef enum
+    {
+        DIRECTION_rx,           /**< Received data. */
+        DIRECTION_tx            /**< Sent data shown by local echo. */
+    } direction_t;
+
+    typedef enum
+    {
+        RUN_lineStart = 0x01,   /**< Run starts a line, timestamp is shown before it. */
+        RUN_wrapped = 0x02      /**< Line was wrapped automatically before the run. */
+    } runFlag_t;
+
+    typedef struct
+    {
+        qint64 arrivalTime_ms;  /**< Arrival time of first byte, milliseconds since epoch. */
+        quint32 length;
+        quint8 direction;       /**< direction_t */
+        quint8 flags;           /**< runFlag_t, 0 if run continues the previous one. */
+    } run_t;
+
+    typedef struct
+    {
+        qint64 position;        /**< Position of first byte, counted from clear(). */
+        QByteArray data;
+        QVector<run_t> runs;    /**< Runs of data, lengths add up to its size. */
+    } segment_t;
+
+    ConsoleDataStore();
+
+    void append(const char *data, int len, qint64 arrivalTime_ms, direction_t direction, quint8 flags);
+    void trim(qint64 sizeLimit, qint64 targetSize);
+    void clear();
+
+    qint64 firstPosition() const;
+    qint64 endPosition() const;
+    qint64 size() const;
+    QByteArray mid(qint64 position, qint64 len) const;
+    const QList<segment_t> &segments() const;
+    qint64 memory() const;
+
+private:
+    Q_DISABLE_COPY(ConsoleDataStore)
+
+    static const int segmentSize = 64 * 1024;
+
+    QList<segment_t> m_segments;    /**< Oldest first, all but the last one are full. */
+    qint64 m_endPosition;           /**< Position after the last byte. */
+};
+
+#endif // CONSOLEDATASTORE_H
@@ -0,0 +1,249 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <string.h>
+
+#include "consolelinestore.h"
+
+ConsoleLineStore::ConsoleLineStore()
+    : m_firstLineNumber(0)
+    , m_lineCount(0)
+    , m_maximumLineCount(10000)
+    , m_maximumLineLength(0)
+{
+    clear();
+}
+
+/**
+ * @brief ConsoleLineStore::append
+ * Appends text to the open line. Every '\n' closes the line and opens a
+ * new one. Oldest lines are removed above the maximum line count.
+ */
+void ConsoleLineStore::append(const char *text, int len)
+{
+    while (len > 0)
+    {
+        const char *end = static_cast<const char *>(memchr(text, '\n', static_cast<size_t>(len)));
+        int lineLen = end ? static_cast<int>(end - text) : len;
+        block_t &block = m_blocks.last();
+
+        block.text.append(text, lineLen);
+        m_maximumLineLength = qMax(m_maximumLineLength, block.text.size() - block.lineStarts.last());
+        if (!end)
+        {
+            break;
+        }
+        newLine();
+        text += lineLen + 1;
+        len -= lineLen + 1;
+    }
+    removeFirstLines();
+}
+
+/**
+ * @brief ConsoleLineStore::removeLastChar
+ * Removes the last character of the open line. If the open line is empty,
+ * it is removed and the previous line is opened again.
+ */
+void ConsoleLineStore::removeLastChar()
+{
+    block_t &block = m_blocks.last();
+
+    if (block.text.size() > block.lineStarts.last())
+    {
+        block.text.chop(1);
+    }
+    else if (m_lineCount > 1)
+    {
+        if (block.lineStarts.size() > 1)
+        {
+            block.lineStarts.removeLast();
+        }
+        else
+        {
+            m_blocks.removeLast();
+        }
+        m_lineCount--;
+    }
+}
+
+/**
+ * @brief ConsoleLineStore::overwrite
+ * Replaces characters of a line in place, length of line does not change.
+ * Text beyond the end of line and removed lines are ignored.
+ *
+ * @param column Byte offset of first character replaced.
+ */
+void ConsoleLineStore::overwrite(qint64 lineNumber, int column, const char *text, int len)
+{
+    if (lineNumber < m_firstLineNumber || lineNumber > lastLineNumber() || column < 0)
+    {
+        return;
+    }
+    block_t &block = m_blocks[findBlock(lineNumber)];
+    int i = static_cast<int>(lineNumber - block.firstLineNumber);
+    int start = block.lineStarts.at(i);
+    int end = i + 1 < block.lineStarts.size() ? block.lineStarts.at(i + 1) : block.text.size();
+
+    len = qMin(len, end - start - column);
+    if (len > 0)
+    {
+        memcpy(block.text.data() + start + column, text, static_cast<size_t>(len));
+    }
+}
+
+/**
+ * @brief ConsoleLineStore::clear
+ * Removes all lines. Numbering continues, so numbers of removed lines are
+ * not reused.
+ */
+void ConsoleLineStore::clear()
+{
+    block_t block;
+
+    if (!m_blocks.isEmpty())
+    {
+        m_firstLineNumber = lastLineNumber() + 1;
+    }
+    m_blocks.clear();
+    block.firstLineNumber = m_firstLineNumber;
+    block.lineStarts.append(0);
+    m_blocks.append(block);
+    m_lineCount = 1;
+    m_maximumLineLength = 0;
+}
+
+/**
+ * @brief ConsoleLineStore::line
+ * @return Text of line without line ending, empty if line was removed.
+ */
+QByteArray ConsoleLineStore::line(qint64 lineNumber) const
+{
+    if (lineNumber < m_firstLineNumber || lineNumber > lastLineNumber())
+    {
+        return QByteArray();
+    }
+    const block_t &block = m_blocks.at(findBlock(lineNumber));
+    int i = static_cast<int>(lineNumber - block.firstLineNumber);
+    int start = block.lineStarts.at(i);
+    int end = i + 1 < block.lineStarts.size() ? block.lineStarts.at(i + 1) : block.text.size();
+
+    return block.text.mid(start, end - start);
+}
+
+qint64 ConsoleLineStore::firstLineNumber() const
+{
+    return m_firstLineNumber;
+}
+
+qint64 ConsoleLineStore::lastLineNumber() const
+{
+    const block_t &block = m_blocks.last();
+
+    return block.firstLineNumber + block.lineStarts.size() - 1;
+}
+
+qint64 ConsoleLineStore::lineCount() const
+{
+    return m_lineCount;
+}
+
+int ConsoleLineStore::maximumLineLength() const
+{
+    return m_maximumLineLength;
+}
+
+int ConsoleLineStore::maximumLineCount() const
+{
+    return m_maximumLineCount;
+}
+
+void ConsoleLineStore::setMaximumLineCount(int maximumLineCount)
+{
+    m_maximumLineCount = qMax(maximumLineCount, 1);
+    removeFirstLines();
+}
+
+/**
+ * @brief ConsoleLineStore::memory
+ * @return Memory allocated for lines and their index.
+ */
+qint64 ConsoleLineStore::memory() const
+{
+    qint64 memory = 0;
+
+    foreach (const block_t &block, m_blocks)
+    {
+        memory += block.text.capacity() + static_cast<qint64>(block.lineStarts.capacity()) * sizeof(int);
+    }
+    return memory;
+}
+
+void ConsoleLineStore::newLine()
+{
+    block_t &last = m_blocks.last();
+
+    if (last.text.size() < blockSize)
+    {
+        last.lineStarts.append(last.text.size());
+    }
+    else
+    {
+        block_t block;
+        /* Block is full, spare capacity is released */
+        last.text.squeeze();
+        last.lineStarts.squeeze();
+        block.firstLineNumber = lastLineNumber() + 1;
+        block.text.reserve(blockSize);
+        block.lineStarts.append(0);
+        m_blocks.append(block);
+    }
+    m_lineCount++;
+}
+
+/**
+ * @brief ConsoleLineStore::removeFirstLines
+ * Removes oldest lines above the maximum line count. A block is freed when
+ * its last line is removed.
+ */
+void ConsoleLineStore::removeFirstLines()
+{
+    while (m_lineCount > m_maximumLineCount)
+    {
+        const block_t &first = m_blocks.first();
+
+        m_firstLineNumber++;
+        m_lineCount--;
+        if (m_firstLineNumber >= first.firstLineNumber + first.lineStarts.size())
+        {
+            m_blocks.removeFirst();
+        }
+    }
+}
+
+/**
+ * @brief ConsoleLineStore::findBlock
+ * @return Index of block containing the line.
+ */
+int ConsoleLineStore::findBlock(qint64 lineNumber) const
+{
+    int low = 0;
+    int high = m_blocks.size() - 1;
+
+    while (low < high)
+    {
+        int mid = (low + high + 1) / 2;
+        if (m_blocks.at(mid).firstLineNumber <= lineNumber)
+        {
+            low = mid;
+        }
+        else
+        {
+            high = mid - 1;
+        }
+    }
+    return low;
+}
@@ -0,0 +1,68 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef CONSOLELINESTORE_H
+#define CONSOLELINESTORE_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QVector>
+
+/**
+ * @brief The ConsoleLineStore class
+ * Lines shown by the console. Lines are packed into large blocks with an
+ * index of line starts, so a line costs its text and four bytes. Any line
+ * can be reached by its number in O(log blocks), the oldest lines are
+ * removed in O(1).
+ * Lines are numbered from the start of the session, numbers of remaining
+ * lines do not change when old lines are removed. The last line is open,
+ * appended text goes there. The store always has at least one line.
+ */
+class ConsoleLineStore
+{
+public:
+    ConsoleLineStore();
+
+    void append(const char *text, int len);
+    void removeLastChar();
+    void overwrite(qint64 lineNumber, int column, const char *text, int len);
+    void clear();
+
+    QByteArray line(qint64 lineNumber) const;
+    qint64 firstLineNumber() const;
+    qint64 lastLineNumber() const;
+    qint64 lineCount() const;
+    int maximumLineLength() const;
+
+    int maximumLineCount() const;
+    void setMaximumLineCount(int maximumLineCount);
+
+    qint64 memory() const;
+
+private:
+    /** Lines are not split between blocks, a new block is started above this size. */
+    static const int blockSize = 64 * 1024;
+
+    typedef struct
+    {
+        qint64 firstLineNumber;     /**< Number of lineStarts[0]. */
+        QByteArray text;            /**< Lines without line ending. */
+        QVector<int> lineStarts;    /**< Offset of each line in text. */
+    } block_t;
+
+    void newLine();
+    void removeFirstLines();
+    int findBlock(qint64 lineNumber) const;
+
+    QList<block_t> m_blocks;
+    qint64 m_firstLineNumber;   /**< Oldest line, lines before it in the first block are removed. */
+    qint64 m_lineCount;
+    int m_maximumLineCount;
+    int m_maximumLineLength;    /**< Longest line since clear(), in bytes. */
+};
+
+#endif // CONSOLELINESTORE_H
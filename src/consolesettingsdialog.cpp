@@ -75,6 +75,16 @@ ConsoleSettingsDialog::ConsoleSettingsDialog(QWidget *parent) :
     ui->autoLogFilePathLineEdit->setEnabled(autoLogEnabled);
     ui->autoLogFilePathBrowseButton->setEnabled(autoLogEnabled);
     ui->autoLogTimestampComboBox->setEnabled(autoLogEnabled);
+    ui->autoLogFlushIntervalSpinBox->setValue(settings.value("serial/autoLogFlushInterval_ms", 1000).toInt());
+    ui->autoLogFlushIntervalSpinBox->setEnabled(autoLogEnabled);
+    ui->autoLogFlushSizeSpinBox->setValue(settings.value("serial/autoLogFlushSize_kB", 64).toInt());
+    ui->autoLogFlushSizeSpinBox->setEnabled(autoLogEnabled);
+    ui->autoLogSyncOnCloseCheckBox->setChecked(settings.value("serial/autoLogSyncOnClose", false).toBool());
+    ui->autoLogSyncOnCloseCheckBox->setEnabled(autoLogEnabled);
+    ui->autoLogCaptureCheckBox->setChecked(settings.value("serial/autoLogCapture", false).toBool());
+    ui->autoLogCaptureCheckBox->setEnabled(autoLogEnabled);
+    ui->readQueueSizeSpinBox->setValue(settings.value("serial/readQueueSize_kB", 4096).toInt());
+    ui->readQueuePolicyComboBox->setCurrentIndex(settings.value("serial/readQueuePolicy", 0).toInt());
 
     /* Hide unused buttons */
     ui->text1Button->hide();
@@ -223,6 +233,26 @@ void ConsoleSettingsDialog::setDelayAfterSendNewLine(const int delayAfterSendNew
     ui->delayAfterSendNewLineSpinBox->setValue (delayAfterSendNewline);
 }
 
+int ConsoleSettingsDialog::getDelayAfterSendByte_us()
+{
+    return ui->delayAfterSendByteUsSpinBox->value ();
+}
+
+void ConsoleSettingsDialog::setDelayAfterSendByte_us(const int delayAfterSendByte_us)
+{
+    ui->delayAfterSendByteUsSpinBox->setValue (delayAfterSendByte_us);
+}
+
+int ConsoleSettingsDialog::getDelayAfterSendNewLine_us()
+{
+    return ui->delayAfterSendNewLineUsSpinBox->value ();
+}
+
+void ConsoleSettingsDialog::setDelayAfterSendNewLine_us(const int delayAfterSendNewline_us)
+{
+    ui->delayAfterSendNewLineUsSpinBox->setValue (delayAfterSendNewline_us);
+}
+
 bool ConsoleSettingsDialog::isAutoLogEnabled()
 {
     qDebug() << __PRETTY_FUNCTION__ << ui->autoLogCheckBox->isChecked();
@@ -570,6 +600,10 @@ void ConsoleSettingsDialog::on_autoLogCheckBox_stateChanged(int arg1)
     ui->autoLogFilePathLineEdit->setEnabled(arg1);
     ui->autoLogFilePathBrowseButton->setEnabled(arg1);
     ui->autoLogTimestampComboBox->setEnabled(arg1);
+    ui->autoLogFlushIntervalSpinBox->setEnabled(arg1);
+    ui->autoLogFlushSizeSpinBox->setEnabled(arg1);
+    ui->autoLogSyncOnCloseCheckBox->setEnabled(arg1);
+    ui->autoLogCaptureCheckBox->setEnabled(arg1);
 }
 
 void ConsoleSettingsDialog::on_buttonBox_clicked(QAbstractButton *button)
@@ -599,6 +633,8 @@ void ConsoleSettingsDialog::on_buttonBox_clicked(QAbstractButton *button)
         settings.setValue("serial/hexWrap", hexWrap);
         settings.setValue("serial/delayAfterBytes_ms", delayAfterBytes_ms);
         settings.setValue("serial/delayAfterNewline_ms", delayAfterNewline_ms);
+        settings.setValue("serial/delayAfterBytes_us", getDelayAfterSendByte_us());
+        settings.setValue("serial/delayAfterNewline_us", getDelayAfterSendNewLine_us());
         settings.setValue("console/timestampFormatString", timestampFormatString);
         settings.setValue("completion/mode", getCompletionMode());
         settings.setValue("completion/caseSensitivity", getCompletionCaseSensitivity());
@@ -606,6 +642,12 @@ void ConsoleSettingsDialog::on_buttonBox_clicked(QAbstractButton *button)
         settings.setValue("serial/autoLogOverwrite", ui->autoLogOverwriteCheckBox->isChecked());
         settings.setValue("serial/autoLogFileName", ui->autoLogFileNameLineEdit->text());
         settings.setValue("serial/autoLogFilePath", ui->autoLogFilePathLineEdit->text());
+        settings.setValue("serial/autoLogFlushInterval_ms", ui->autoLogFlushIntervalSpinBox->value());
+        settings.setValue("serial/autoLogFlushSize_kB", ui->autoLogFlushSizeSpinBox->value());
+        settings.setValue("serial/autoLogSyncOnClose", ui->autoLogSyncOnCloseCheckBox->isChecked());
+        settings.setValue("serial/autoLogCapture", ui->autoLogCaptureCheckBox->isChecked());
+        settings.setValue("serial/readQueueSize_kB", ui->readQueueSizeSpinBox->value());
+        settings.setValue("serial/readQueuePolicy", ui->readQueuePolicyComboBox->currentIndex());
     }
 }
 
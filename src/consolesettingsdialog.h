@@ -48,6 +48,12 @@ public:
     int getDelayAfterSendNewLine();
     void setDelayAfterSendNewLine(const int delayAfterSendNewline);
 
+    int getDelayAfterSendByte_us();
+    void setDelayAfterSendByte_us(const int delayAfterSendByte_us);
+
+    int getDelayAfterSendNewLine_us();
+    void setDelayAfterSendNewLine_us(const int delayAfterSendNewline_us);
+
     bool isAutoLogEnabled();
     void setAutoLogEnabled(bool enabled=true);
 
@@ -0,0 +1,291 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QDebug>
+
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/ioctl.h>
+
+#include "fdportbackend.h"
+
+FdPortBackend::FdPortBackend(QObject *parent)
+    : PortBackend(parent)
+    , m_fd(-1)
+    , m_openMode(QIODevice::NotOpen)
+    , m_baudRate(115200)
+    , m_dataBits(QSerialPort::Data8)
+    , m_parity(QSerialPort::NoParity)
+    , m_stopBits(QSerialPort::OneStop)
+    , m_flowControl(QSerialPort::NoFlowControl)
+    , m_dataTerminalReady(false)
+    , m_requestToSend(false)
+{
+}
+
+FdPortBackend::~FdPortBackend()
+{
+    /* close() cannot be called here, closeDevice() is already gone */
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+    }
+}
+
+bool FdPortBackend::open(QIODevice::OpenMode mode)
+{
+    if (m_fd >= 0)
+    {
+        setErrorString(tr("Port is already opened"));
+        return false;
+    }
+    m_errorString.clear();
+    int fd = openDevice();
+    if (fd < 0)
+    {
+        return false;
+    }
+    int flags = fcntl(fd, F_GETFL);
+    if (flags < 0 || fcntl(fd, F_SETFL, flags | O_NONBLOCK) < 0)
+    {
+        setErrorString(QString::fromLocal8Bit(strerror(errno)));
+        ::close(fd);
+        closeDevice();
+        return false;
+    }
+    m_fd = fd;
+    m_openMode = mode;
+    m_dataTerminalReady = true;
+    m_requestToSend = true;
+    return true;
+}
+
+void FdPortBackend::close()
+{
+    if (m_fd >= 0)
+    {
+        ::close(m_fd);
+        m_fd = -1;
+        closeDevice();
+    }
+    m_openMode = QIODevice::NotOpen;
+}
+
+bool FdPortBackend::isOpen() const
+{
+    return m_fd >= 0;
+}
+
+bool FdPortBackend::isWritable() const
+{
+    return m_fd >= 0 && (m_openMode & QIODevice::WriteOnly);
+}
+
+int FdPortBackend::handle() const
+{
+    return m_fd;
+}
+
+QString FdPortBackend::portName() const
+{
+    return m_portName;
+}
+
+void FdPortBackend::setPortName(const QString &name)
+{
+    m_portName = name;
+}
+
+QString FdPortBackend::errorString() const
+{
+    return m_errorString;
+}
+
+void FdPortBackend::setErrorString(const QString &errorString)
+{
+    m_errorString = errorString;
+    qCritical() << __PRETTY_FUNCTION__ << m_portName << errorString;
+}
+
+qint64 FdPortBackend::bytesAvailable() const
+{
+    int available = 0;
+    if (m_fd < 0 || ioctl(m_fd, FIONREAD, &available) < 0)
+    {
+        return 0;
+    }
+    return available;
+}
+
+qint64 FdPortBackend::bytesToWrite() const
+{
+    /* Data is not buffered in user space */
+    return 0;
+}
+
+QByteArray FdPortBackend::read(qint64 maxLen)
+{
+    QByteArray data;
+    if (m_fd < 0 || maxLen <= 0)
+    {
+        return data;
+    }
+    data.resize(static_cast<int>(qMin(maxLen, bytesAvailable())));
+    ssize_t len = data.size() ? ::read(m_fd, data.data(), static_cast<size_t>(data.size())) : 0;
+    data.resize(len > 0 ? static_cast<int>(len) : 0);
+    return data;
+}
+
+qint64 FdPortBackend::write(const char *data, qint64 len)
+{
+    if (m_fd < 0)
+    {
+        return -1;
+    }
+    ssize_t written = ::write(m_fd, data, static_cast<size_t>(len));
+    if (written < 0)
+    {
+        if (errno == EAGAIN || errno == EWOULDBLOCK || errno == EINTR)
+        {
+            return 0;
+        }
+        setErrorString(QString::fromLocal8Bit(strerror(errno)));
+        emit error(QSerialPort::WriteError);
+    }
+    return written;
+}
+
+bool FdPortBackend::waitFor(short events, int msecs)
+{
+    if (m_fd < 0)
+    {
+        return false;
+    }
+    struct pollfd fd;
+    fd.fd = m_fd;
+    fd.events = events;
+    fd.revents = 0;
+    int ret;
+    do
+    {
+        ret = ::poll(&fd, 1, msecs);
+    } while (ret < 0 && errno == EINTR);
+    return ret > 0 && (fd.revents & events);
+}
+
+bool FdPortBackend::waitForReadyRead(int msecs)
+{
+    return waitFor(POLLIN, msecs);
+}
+
+bool FdPortBackend::waitForBytesWritten(int msecs)
+{
+    return waitFor(POLLOUT, msecs);
+}
+
+bool FdPortBackend::setBaudRate(qint32 baudRate, QSerialPort::Directions directions)
+{
+    Q_UNUSED(directions);
+    m_baudRate = baudRate;
+    return true;
+}
+
+qint32 FdPortBackend::baudRate(QSerialPort::Directions directions) const
+{
+    Q_UNUSED(directions);
+    return m_baudRate;
+}
+
+bool FdPortBackend::setDataBits(QSerialPort::DataBits dataBits)
+{
+    m_dataBits = dataBits;
+    return true;
+}
+
+QSerialPort::DataBits FdPortBackend::dataBits() const
+{
+    return m_dataBits;
+}
+
+bool FdPortBackend::setParity(QSerialPort::Parity parity)
+{
+    m_parity = parity;
+    return true;
+}
+
+QSerialPort::Parity FdPortBackend::parity() const
+{
+    return m_parity;
+}
+
+bool FdPortBackend::setStopBits(QSerialPort::StopBits stopBits)
+{
+    m_stopBits = stopBits;
+    return true;
+}
+
+QSerialPort::StopBits FdPortBackend::stopBits() const
+{
+    return m_stopBits;
+}
+
+bool FdPortBackend::setFlowControl(QSerialPort::FlowControl flowControl)
+{
+    m_flowControl = flowControl;
+    return true;
+}
+
+QSerialPort::FlowControl FdPortBackend::flowControl() const
+{
+    return m_flowControl;
+}
+
+bool FdPortBackend::setDataTerminalReady(bool set)
+{
+    m_dataTerminalReady = set;
+    return true;
+}
+
+bool FdPortBackend::isDataTerminalReady()
+{
+    return m_dataTerminalReady;
+}
+
+bool FdPortBackend::setRequestToSend(bool set)
+{
+    m_requestToSend = set;
+    return true;
+}
+
+bool FdPortBackend::isRequestToSend()
+{
+    return m_requestToSend;
+}
+
+/**
+ * @brief FdPortBackend::pinoutSignals
+ * Virtual device is always ready: DSR and CTS follow DTR and RTS.
+ */
+QSerialPort::PinoutSignals FdPortBackend::pinoutSignals()
+{
+    QSerialPort::PinoutSignals pinoutSignals = QSerialPort::NoSignal;
+    if (m_fd >= 0)
+    {
+        if (m_dataTerminalReady)
+        {
+            pinoutSignals |= QSerialPort::DataTerminalReadySignal | QSerialPort::DataSetReadySignal;
+        }
+        if (m_requestToSend)
+        {
+            pinoutSignals |= QSerialPort::RequestToSendSignal | QSerialPort::ClearToSendSignal;
+        }
+    }
+    return pinoutSignals;
+}
@@ -0,0 +1,81 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef FDPORTBACKEND_H
+#define FDPORTBACKEND_H
+
+#include "portbackend.h"
+
+/**
+ * @brief The FdPortBackend class
+ * Base of virtual ports which are represented by a file descriptor
+ * (pseudo-terminal, socket). Line parameters are only stored, they do not
+ * affect the transfer.
+ */
+class FdPortBackend : public PortBackend
+{
+    Q_OBJECT
+public:
+    explicit FdPortBackend(QObject *parent = 0);
+    ~FdPortBackend();
+
+    bool open(QIODevice::OpenMode mode);
+    void close();
+    bool isOpen() const;
+    bool isWritable() const;
+    int handle() const;
+
+    QString portName() const;
+    void setPortName(const QString &name);
+    QString errorString() const;
+
+    qint64 bytesAvailable() const;
+    qint64 bytesToWrite() const;
+    QByteArray read(qint64 maxLen);
+    qint64 write(const char *data, qint64 len);
+    bool waitForReadyRead(int msecs);
+    bool waitForBytesWritten(int msecs);
+
+    bool setBaudRate(qint32 baudRate, QSerialPort::Directions directions = QSerialPort::AllDirections);
+    qint32 baudRate(QSerialPort::Directions directions = QSerialPort::AllDirections) const;
+    bool setDataBits(QSerialPort::DataBits dataBits);
+    QSerialPort::DataBits dataBits() const;
+    bool setParity(QSerialPort::Parity parity);
+    QSerialPort::Parity parity() const;
+    bool setStopBits(QSerialPort::StopBits stopBits);
+    QSerialPort::StopBits stopBits() const;
+    bool setFlowControl(QSerialPort::FlowControl flowControl);
+    QSerialPort::FlowControl flowControl() const;
+
+    bool setDataTerminalReady(bool set);
+    bool isDataTerminalReady();
+    bool setRequestToSend(bool set);
+    bool isRequestToSend();
+    QSerialPort::PinoutSignals pinoutSignals();
+
+protected:
+    /** Creates the device. @return File descriptor, -1 on error. */
+    virtual int openDevice() = 0;
+    /** Releases the device after its file descriptor was closed. */
+    virtual void closeDevice() = 0;
+    void setErrorString(const QString &errorString);
+    bool waitFor(short events, int msecs);
+
+private:
+    int m_fd;
+    QIODevice::OpenMode m_openMode;
+    QString m_portName;
+    QString m_errorString;
+    qint32 m_baudRate;
+    QSerialPort::DataBits m_dataBits;
+    QSerialPort::Parity m_parity;
+    QSerialPort::StopBits m_stopBits;
+    QSerialPort::FlowControl m_flowControl;
+    bool m_dataTerminalReady;
+    bool m_requestToSend;
+};
+
+#endif // FDPORTBACKEND_H
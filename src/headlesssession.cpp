@@ -0,0 +1,267 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QCoreApplication>
+#include <QSettings>
+#include <QFileInfo>
+#include <QDebug>
+
+#include <signal.h>
+#include <stdio.h>
+
+#include "common.h"
+#include "headlesssession.h"
+
+/** Set by signal handler, checked by HeadlessSession::checkStop(). */
+static volatile sig_atomic_t s_stopSignal = 0;
+
+static void stopSignalHandler(int signum)
+{
+    s_stopSignal = signum;
+}
+
+HeadlessSession::HeadlessSession(QObject *parent)
+    : QObject(parent)
+    , m_serialThread(NULL)
+    , m_captureIsEnabled(false)
+    , m_timeout_ms(0)
+    , m_byteLimit(0)
+    , m_bytesReceived(0)
+    , m_opened(false)
+    , m_finished(false)
+    , m_err(stderr)
+{
+    /* Same settings as the GUI used last time */
+    m_serialSettings.loadSettings();
+}
+
+HeadlessSession::~HeadlessSession()
+{
+    if (m_serialThread)
+    {
+        m_serialThread->stop(1000);
+    }
+    delete m_serialThread;
+    m_serialThread = NULL;
+}
+
+/**
+ * @brief HeadlessSession::installSignalHandlers
+ * SIGINT and SIGTERM finish the session gently, so log files are closed.
+ */
+void HeadlessSession::installSignalHandlers()
+{
+    signal(SIGINT, stopSignalHandler);
+    signal(SIGTERM, stopSignalHandler);
+}
+
+/**
+ * @brief HeadlessSession::loadProfile
+ * Loads serial port settings from a profile saved in settings dialog.
+ *
+ * @param profileName Name of profile as it is shown in settings dialog.
+ * @return true: profile exists.
+ */
+bool HeadlessSession::loadProfile(const QString &profileName)
+{
+    QSettings settings;
+    QString storedName = profileName;
+
+    /* Replace '/' to 0x7F, because '/' is the separator... */
+    storedName.replace(SEP_CHAR, REPL_CHAR);
+    settings.beginGroup("profile");
+    if (!settings.childGroups().contains(storedName))
+    {
+        return false;
+    }
+    m_serialSettings.loadSettings(storedName);
+    return true;
+}
+
+void HeadlessSession::setPortName(const QString &portName)
+{
+    m_serialSettings.m_serialSettings.name = portName;
+}
+
+void HeadlessSession::setLogFilePath(const QString &logFilePath)
+{
+    m_logFilePath = logFilePath;
+}
+
+void HeadlessSession::setCaptureEnabled(bool enable)
+{
+    m_captureIsEnabled = enable;
+}
+
+void HeadlessSession::setTimeout_ms(qint64 timeout_ms)
+{
+    m_timeout_ms = timeout_ms;
+}
+
+void HeadlessSession::setByteLimit(qint64 byteLimit)
+{
+    m_byteLimit = byteLimit;
+}
+
+/**
+ * @brief HeadlessSession::start
+ * Starts serial thread and opens the port. Result is reported by
+ * serialPortStatusChanged() or serialMessage().
+ */
+void HeadlessSession::start()
+{
+    QSettings settings;
+
+    m_serialThread = new SerialThread(NULL, &m_serialSettings);
+    m_serialThread->setLineEndingRx(settings.value("serial/lineEndingRx", "\r\n").toString());
+    m_serialThread->setLineEndingTx(settings.value("serial/lineEndingTx", "\r").toString());
+    if (!m_logFilePath.isEmpty())
+    {
+        QFileInfo fileInfo(m_logFilePath);
+        QString fileName = fileInfo.fileName();
+        /* Auto-log file name is a date/time format, so it shall be quoted */
+        fileName.replace("'", "''");
+        m_serialThread->enableAutoLog(true);
+        m_serialThread->setAutoLogFilePath(fileInfo.absolutePath());
+        m_serialThread->setAutoLogFileName("'" + fileName + "'");
+    }
+    if (m_captureIsEnabled)
+    {
+        m_serialThread->enableAutoLogCapture(true);
+    }
+    /* open() would reload auto-log settings and lose --log and --capture */
+    m_serialThread->keepAutoLogSettings();
+    if (!m_serialThread->isAutoLogEnabled())
+    {
+        m_err << tr("Warning: auto-log is disabled, received data will not be saved") << "\n";
+        m_err.flush();
+    }
+
+    MY_ASSERT(connect(m_serialThread, SIGNAL(message(QString,bool)), this, SLOT(serialMessage(QString,bool))));
+    MY_ASSERT(connect(m_serialThread, SIGNAL(portStatusChanged(bool)), this, SLOT(serialPortStatusChanged(bool))));
+    MY_ASSERT(connect(m_serialThread, SIGNAL(error(QSerialPort::SerialPortError)), this,
+                      SLOT(handleError(QSerialPort::SerialPortError))));
+    MY_ASSERT(connect(m_serialThread, SIGNAL(readyRead()), this, SLOT(readData())));
+    MY_ASSERT(connect(&m_checkTimer, SIGNAL(timeout()), this, SLOT(checkStop())));
+
+    m_serialThread->startIo(QThread::NormalPriority);
+    m_serialThread->open(QIODevice::ReadWrite);
+    m_elapsedTimer.start();
+    m_checkTimer.start(checkInterval_ms);
+}
+
+/**
+ * @brief HeadlessSession::readData
+ * Data is already logged by serial thread, it is only counted and released.
+ */
+void HeadlessSession::readData()
+{
+    const char *data;
+    qint64 len;
+
+    m_serialThread->acknowledgeReadyRead();
+    while ((len = m_serialThread->peekReadData(&data)) > 0)
+    {
+        m_serialThread->consumeReadData(len);
+        m_bytesReceived += len;
+    }
+    if (m_byteLimit > 0 && m_bytesReceived >= m_byteLimit)
+    {
+        finish(0, tr("byte limit reached"));
+    }
+}
+
+void HeadlessSession::serialMessage(QString message, bool error)
+{
+    if (error)
+    {
+        m_err << tr("Error: ") << message << "\n";
+        m_err.flush();
+        /* Without GUI nobody could fix it: port cannot be opened, log cannot be written */
+        finish(1, tr("error"));
+    }
+    else
+    {
+        m_err << message << "\n";
+        m_err.flush();
+    }
+}
+
+void HeadlessSession::serialPortStatusChanged(bool opened)
+{
+    if (opened)
+    {
+        m_opened = true;
+        m_err << tr("Capturing %1").arg(m_serialSettings.toString()) << "\n";
+        m_err.flush();
+        /* Log file is opened before port is reported as opened */
+        if (!m_logFilePath.isEmpty() && !QFileInfo::exists(m_logFilePath))
+        {
+            finish(1, tr("log file was not created: %1").arg(m_logFilePath));
+        }
+    }
+    else if (m_opened)
+    {
+        finish(1, tr("port closed: %1").arg(m_serialThread->errorString()));
+    }
+}
+
+void HeadlessSession::handleError(QSerialPort::SerialPortError error)
+{
+    if (error != QSerialPort::NoError && error != QSerialPort::TimeoutError)
+    {
+        finish(1, tr("port error: %1").arg(m_serialThread->errorString()));
+    }
+}
+
+void HeadlessSession::checkStop()
+{
+    if (s_stopSignal)
+    {
+        finish(0, tr("signal %1").arg(static_cast<int>(s_stopSignal)));
+    }
+    else if (m_timeout_ms > 0 && m_elapsedTimer.elapsed() >= m_timeout_ms)
+    {
+        finish(0, tr("timeout"));
+    }
+}
+
+/**
+ * @brief HeadlessSession::finish
+ * Stops serial thread (it closes the port and log files) and quits event loop.
+ *
+ * @param exitCode Exit code of application.
+ * @param reason Reason of finishing, it is printed.
+ */
+void HeadlessSession::finish(int exitCode, const QString &reason)
+{
+    if (m_finished)
+    {
+        return;
+    }
+    m_finished = true;
+    m_checkTimer.stop();
+    m_serialThread->stop(1000);
+    readData();
+    qint64 elapsed_ms = qMax(m_elapsedTimer.elapsed(), static_cast<qint64>(1));
+    m_err << tr("Finished (%1): %2 bytes received in %3 s, %4 bytes/s")
+             .arg(reason)
+             .arg(m_bytesReceived)
+             .arg(static_cast<double>(elapsed_ms) / 1000.0, 0, 'f', 1)
+             .arg(m_bytesReceived * 1000 / elapsed_ms)
+          << "\n";
+    m_err.flush();
+    if (m_serialThread->bytesDropped() || m_serialThread->bytesSpilled())
+    {
+        /* Log is complete, only receive queue was affected */
+        m_err << tr("Receive queue full: %1 bytes dropped, %2 bytes spilled to disk")
+                 .arg(m_serialThread->bytesDropped())
+                 .arg(m_serialThread->bytesSpilled())
+              << "\n";
+        m_err.flush();
+    }
+    QCoreApplication::exit(exitCode);
+}
@@ -0,0 +1,71 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef HEADLESSSESSION_H
+#define HEADLESSSESSION_H
+
+#include <QObject>
+#include <QTimer>
+#include <QElapsedTimer>
+#include <QTextStream>
+
+#include "serialsettings.h"
+#include "serialthread.h"
+
+/**
+ * @brief The HeadlessSession class
+ * Captures a serial port without GUI: SerialThread receives and auto-logs
+ * the data, received data is dropped after that. Session finishes on
+ * SIGINT/SIGTERM, on timeout, on byte limit or on port error.
+ */
+class HeadlessSession : public QObject
+{
+    Q_OBJECT
+public:
+    explicit HeadlessSession(QObject *parent = 0);
+    ~HeadlessSession();
+
+    bool loadProfile(const QString &profileName);
+    void setPortName(const QString &portName);
+    void setLogFilePath(const QString &logFilePath);
+    void setCaptureEnabled(bool enable);
+    void setTimeout_ms(qint64 timeout_ms);
+    void setByteLimit(qint64 byteLimit);
+
+    void start();
+
+    static void installSignalHandlers();
+
+private slots:
+    void readData();
+    void serialMessage(QString message, bool error);
+    void serialPortStatusChanged(bool opened);
+    void handleError(QSerialPort::SerialPortError error);
+    void checkStop();
+
+private:
+    Q_DISABLE_COPY(HeadlessSession)
+
+    void finish(int exitCode, const QString &reason);
+
+    /** Stop conditions are checked in this interval. */
+    static const int checkInterval_ms = 200;
+
+    SerialSettings m_serialSettings;
+    SerialThread *m_serialThread;
+    QString m_logFilePath;          /**< Empty: auto-log settings are used. */
+    bool m_captureIsEnabled;
+    qint64 m_timeout_ms;            /**< 0: no timeout. */
+    qint64 m_byteLimit;             /**< 0: no limit. */
+    qint64 m_bytesReceived;
+    bool m_opened;
+    bool m_finished;
+    QTimer m_checkTimer;
+    QElapsedTimer m_elapsedTimer;
+    QTextStream m_err;
+};
+
+#endif // HEADLESSSESSION_H
@@ -0,0 +1,131 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <string.h>
+
+#ifdef __SSE2__
+#include <emmintrin.h>
+#endif
+
+#include "hexdump.h"
+
+typedef struct
+{
+    char hex[256][4];   /**< "XX " of each byte, padded to 4 bytes to be copied by one store. */
+    char ascii[256];    /**< Byte itself if printable, '.' otherwise. */
+} hexDumpTable_t;
+
+static hexDumpTable_t makeTable()
+{
+    static const char digits[] = "0123456789ABCDEF";
+    hexDumpTable_t table;
+
+    for (int i = 0; i < 256; i++)
+    {
+        table.hex[i][0] = digits[i >> 4];
+        table.hex[i][1] = digits[i & 0x0F];
+        table.hex[i][2] = ' ';
+        table.hex[i][3] = ' ';
+        table.ascii[i] = (i >= 0x20 && i <= 0x7F) ? static_cast<char>(i) : '.';
+    }
+    return table;
+}
+
+static const hexDumpTable_t table = makeTable();
+
+/**
+ * @brief HexDump::rowLength
+ * @return Size of a formatted row including new line.
+ */
+int HexDump::rowLength(int hexWrap)
+{
+    return hexWrap * 3 + 2 + hexWrap + 1;
+}
+
+/**
+ * @brief HexDump::appendRows
+ * Appends rows of data to buf. Buffer is grown once for all rows.
+ *
+ * @param hexWrap Bytes per row. Usual values: 8, 16.
+ */
+void HexDump::appendRows(QByteArray &buf, const char *data, int len, int hexWrap)
+{
+    int rows = (len + hexWrap - 1) / hexWrap;
+    int size = buf.size();
+    int length = rowLength(hexWrap);
+
+    if (len <= 0)
+    {
+        return;
+    }
+    buf.resize(size + rows * length);
+    char *out = buf.data() + size;
+    for (int i = 0; i < len; i += hexWrap)
+    {
+        formatRow(out, data + i, qMin(hexWrap, len - i), hexWrap);
+        out += length;
+    }
+}
+
+/**
+ * @brief HexDump::formatRow
+ * Writes one row of rowLength() bytes.
+ *
+ * @param len Number of bytes in row, rest of row is padded.
+ */
+void HexDump::formatRow(char *out, const char *data, int len, int hexWrap)
+{
+    formatHex(out, data, len);
+    out += len * 3;
+    /* Byte after the hexadecimal cells is overwritten by padding */
+    memset(out, ' ', static_cast<size_t>((hexWrap - len) * 3 + 2));
+    out += (hexWrap - len) * 3 + 2;
+    formatAscii(out, data, len);
+    out += len;
+    memset(out, ' ', static_cast<size_t>(hexWrap - len));
+    out += hexWrap - len;
+    *out = '\n';
+}
+
+/**
+ * @brief HexDump::formatHex
+ * Writes "XX " cells of bytes: len * 3 bytes. Table entries are copied by 4
+ * bytes, so one more byte of out is overwritten.
+ */
+void HexDump::formatHex(char *out, const char *data, int len)
+{
+    for (int i = 0; i < len; i++)
+    {
+        memcpy(out, table.hex[static_cast<quint8>(data[i])], 4);
+        out += 3;
+    }
+}
+
+/**
+ * @brief HexDump::formatAscii
+ * Writes ASCII cells of bytes: len bytes.
+ */
+void HexDump::formatAscii(char *out, const char *data, int len)
+{
+    int i = 0;
+
+#ifdef __SSE2__
+    const __m128i lastControl = _mm_set1_epi8(0x1F);
+    const __m128i dot = _mm_set1_epi8('.');
+    for (; i + 16 <= len; i += 16)
+    {
+        __m128i v = _mm_loadu_si128(reinterpret_cast<const __m128i *>(data + i));
+        /* Signed compare: 0x80..0xFF are negative, only 0x20..0x7F are printable */
+        __m128i printable = _mm_cmpgt_epi8(v, lastControl);
+        v = _mm_or_si128(_mm_and_si128(printable, v), _mm_andnot_si128(printable, dot));
+        _mm_storeu_si128(reinterpret_cast<__m128i *>(out + i), v);
+    }
+#endif
+    for (; i < len; i++)
+    {
+        out[i] = table.ascii[static_cast<quint8>(data[i])];
+    }
+}
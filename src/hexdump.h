@@ -0,0 +1,32 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef HEXDUMP_H
+#define HEXDUMP_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+/**
+ * @brief The HexDump class
+ * Formats rows of hexadecimal dump: "XX " for each byte, two spaces, then
+ * the bytes as ASCII with '.' for non-printable ones, and a new line. The
+ * last row is padded with spaces.
+ * Hexadecimal digits are copied from a table, printable characters are
+ * selected 16 at a time with SSE2 where available. Rows are written
+ * straight into the preallocated buffer.
+ */
+class HexDump
+{
+public:
+    static int rowLength(int hexWrap);
+    static void appendRows(QByteArray &buf, const char *data, int len, int hexWrap);
+    static void formatRow(char *out, const char *data, int len, int hexWrap);
+    static void formatHex(char *out, const char *data, int len);
+    static void formatAscii(char *out, const char *data, int len);
+};
+
+#endif // HEXDUMP_H
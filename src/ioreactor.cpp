@@ -0,0 +1,291 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+
+#include "ioreactor.h"
+
+IoReactor::IoReactor()
+    : QThread(NULL)
+    , m_epollFd(-1)
+    , m_tickFd(-1)
+    , m_stopFd(-1)
+    , m_running(false)
+    , m_dispatching(NULL)
+{
+    struct epoll_event event;
+
+    m_epollFd = epoll_create1(EPOLL_CLOEXEC);
+    m_tickFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    m_stopFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_epollFd < 0 || m_tickFd < 0 || m_stopFd < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot create descriptors:" << strerror(errno);
+        return;
+    }
+    memset(&event, 0, sizeof(event));
+    event.events = EPOLLIN;
+    event.data.fd = m_tickFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_tickFd, &event);
+    event.data.fd = m_stopFd;
+    epoll_ctl(m_epollFd, EPOLL_CTL_ADD, m_stopFd, &event);
+    m_running = true;
+    start(QThread::NormalPriority);
+}
+
+IoReactor::~IoReactor()
+{
+    quint64 one = 1;
+
+    m_running = false;
+    if (m_stopFd >= 0 && ::write(m_stopFd, &one, sizeof(one)) < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot stop thread:" << strerror(errno);
+    }
+    wait();
+    if (m_epollFd >= 0)
+    {
+        ::close(m_epollFd);
+    }
+    if (m_tickFd >= 0)
+    {
+        ::close(m_tickFd);
+    }
+    if (m_stopFd >= 0)
+    {
+        ::close(m_stopFd);
+    }
+}
+
+/**
+ * @brief IoReactor::instance
+ * @return The reactor, it is started at first use.
+ */
+IoReactor *IoReactor::instance()
+{
+    static IoReactor reactor;
+    return &reactor;
+}
+
+/**
+ * @brief IoReactor::addFd
+ * Registers a descriptor. Level triggered, so a handler does not need to
+ * read everything at once.
+ *
+ * @param fd Descriptor.
+ * @param events EPOLLIN, EPOLLOUT or both.
+ * @param handler Handler of the descriptor.
+ * @return true: registered.
+ */
+bool IoReactor::addFd(int fd, quint32 events, Handler *handler)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_ADD, fd, &event) < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot add descriptor:" << strerror(errno);
+        return false;
+    }
+    m_handlers.insert(fd, handler);
+    return true;
+}
+
+bool IoReactor::modifyFd(int fd, quint32 events)
+{
+    struct epoll_event event;
+
+    memset(&event, 0, sizeof(event));
+    event.events = events;
+    event.data.fd = fd;
+    if (epoll_ctl(m_epollFd, EPOLL_CTL_MOD, fd, &event) < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot modify descriptor:" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief IoReactor::removeFd
+ * Unregisters a descriptor. It shall be called before the descriptor is
+ * closed.
+ */
+void IoReactor::removeFd(int fd)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    if (m_handlers.remove(fd) && epoll_ctl(m_epollFd, EPOLL_CTL_DEL, fd, NULL) < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot remove descriptor:" << strerror(errno);
+    }
+}
+
+/**
+ * @brief IoReactor::setTickEnabled
+ * Enables periodic handleTick() calls of handler. Timer runs only while at
+ * least one handler needs it.
+ */
+void IoReactor::setTickEnabled(Handler *handler, bool enable)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    bool wasEnabled = !m_tickHandlers.isEmpty();
+
+    m_tickHandlers.removeAll(handler);
+    if (enable)
+    {
+        m_tickHandlers.append(handler);
+    }
+    if (wasEnabled != !m_tickHandlers.isEmpty())
+    {
+        armTick(!m_tickHandlers.isEmpty());
+    }
+}
+
+/**
+ * @brief IoReactor::removeHandler
+ * Unregisters all descriptors and ticks of handler. When it returns, handler
+ * is not called anymore and it is not running on reactor thread, so it can
+ * be deleted. It does not wait if the handler calls it on reactor thread.
+ */
+void IoReactor::removeHandler(Handler *handler)
+{
+    QList<int> fds;
+
+    m_mutex.lock();
+    fds = m_handlers.keys(handler);
+    m_mutex.unlock();
+    foreach (int fd, fds)
+    {
+        removeFd(fd);
+    }
+    setTickEnabled(handler, false);
+
+    if (!isReactorThread())
+    {
+        QMutexLocker mutexLocker(&m_mutex);
+        while (m_dispatching == handler)
+        {
+            m_dispatchFinished.wait(&m_mutex);
+        }
+    }
+}
+
+bool IoReactor::isReactorThread() const
+{
+    return QThread::currentThread() == this;
+}
+
+void IoReactor::armTick(bool enable)
+{
+    struct itimerspec spec;
+
+    memset(&spec, 0, sizeof(spec));
+    if (enable)
+    {
+        spec.it_interval.tv_nsec = tickInterval_ms * 1000000L;
+        spec.it_value.tv_nsec = tickInterval_ms * 1000000L;
+    }
+    if (timerfd_settime(m_tickFd, 0, &spec, NULL) < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot set timer:" << strerror(errno);
+    }
+}
+
+void IoReactor::dispatchTick()
+{
+    quint64 expirations;
+
+    if (::read(m_tickFd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot read timer:" << strerror(errno);
+    }
+    m_mutex.lock();
+    QList<Handler *> handlers = m_tickHandlers;
+    m_mutex.unlock();
+    foreach (Handler *handler, handlers)
+    {
+        /* Handlers may disable their tick or be removed meanwhile */
+        m_mutex.lock();
+        bool enabled = m_tickHandlers.contains(handler);
+        m_dispatching = enabled ? handler : NULL;
+        m_mutex.unlock();
+        if (enabled)
+        {
+            handler->handleTick();
+            finishDispatch();
+        }
+    }
+}
+
+/**
+ * @brief IoReactor::finishDispatch
+ * Called when handler returned, removeHandler() may be waiting for it.
+ */
+void IoReactor::finishDispatch()
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    m_dispatching = NULL;
+    m_dispatchFinished.wakeAll();
+}
+
+void IoReactor::run()
+{
+    const int maxEvents = 64;
+    struct epoll_event events[maxEvents];
+
+    /* Default timer slack (50 us) would spoil microsecond pacing */
+    prctl(PR_SET_TIMERSLACK, 1UL, 0UL, 0UL, 0UL);
+    while (m_running)
+    {
+        int n = epoll_wait(m_epollFd, events, maxEvents, -1);
+        if (n < 0)
+        {
+            if (errno != EINTR)
+            {
+                qCritical() << __PRETTY_FUNCTION__ << "epoll_wait failed:" << strerror(errno);
+            }
+            continue;
+        }
+
+        /* Mutex is held only for lookup, handlers may block or call back */
+        for (int i = 0; i < n && m_running; i++)
+        {
+            int fd = events[i].data.fd;
+            if (fd == m_stopFd)
+            {
+                break;
+            }
+            if (fd == m_tickFd)
+            {
+                dispatchTick();
+                continue;
+            }
+            /* Descriptor may have been removed by a previous handler */
+            m_mutex.lock();
+            Handler *handler = m_handlers.value(fd, NULL);
+            m_dispatching = handler;
+            m_mutex.unlock();
+            if (handler)
+            {
+                handler->handleEvent(fd, events[i].events);
+                finishDispatch();
+            }
+        }
+    }
+}
@@ -0,0 +1,78 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef IOREACTOR_H
+#define IOREACTOR_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QHash>
+#include <QList>
+
+#include <atomic>
+
+/**
+ * @brief The IoReactor class
+ * Single thread which serves the file descriptors of all sessions with
+ * epoll. An idle port costs nothing: the thread wakes up only when a
+ * descriptor is ready or when a handler asked for periodic ticks.
+ */
+class IoReactor : public QThread
+{
+    Q_OBJECT
+public:
+    /**
+     * @brief The Handler class
+     * Receives events of its descriptors. Methods are called on the reactor
+     * thread.
+     */
+    class Handler
+    {
+    public:
+        virtual ~Handler() {}
+        /** Descriptor is ready. @param events EPOLLIN, EPOLLOUT, etc. */
+        virtual void handleEvent(int fd, quint32 events) = 0;
+        /** Called in every tickInterval_ms if enabled by setTickEnabled(). */
+        virtual void handleTick() {}
+    };
+
+    /** Interval of ticks, used to poll signals which have no event. */
+    static const int tickInterval_ms = 100;
+
+    static IoReactor *instance();
+
+    bool addFd(int fd, quint32 events, Handler *handler);
+    bool modifyFd(int fd, quint32 events);
+    void removeFd(int fd);
+    void setTickEnabled(Handler *handler, bool enable);
+    void removeHandler(Handler *handler);
+    bool isReactorThread() const;
+
+protected:
+    void run();
+
+private:
+    IoReactor();
+    ~IoReactor();
+    Q_DISABLE_COPY(IoReactor)
+
+    void armTick(bool enable);
+    void dispatchTick();
+    void finishDispatch();
+
+    int m_epollFd;
+    int m_tickFd;                   /**< timerfd for ticks. */
+    int m_stopFd;                   /**< eventfd to stop the thread. */
+    std::atomic<bool> m_running;
+    QMutex m_mutex;                 /**< Protects m_handlers, m_tickHandlers and m_dispatching. Not held while handlers run. */
+    QWaitCondition m_dispatchFinished;  /**< Signalled when a handler returns. */
+    QHash<int, Handler *> m_handlers;   /**< Handler of each registered descriptor. */
+    QList<Handler *> m_tickHandlers;
+    Handler *m_dispatching;         /**< Handler running on reactor thread, NULL if none. */
+};
+
+#endif // IOREACTOR_H
@@ -0,0 +1,392 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QMutexLocker>
+#include <QElapsedTimer>
+#include <QDebug>
+
+#include <string.h>
+#include <errno.h>
+
+#include "common.h"
+#include "logwriter.h"
+
+#if WINDOWS
+#include <io.h>
+#else
+#include <unistd.h>
+#include <fcntl.h>
+#endif
+
+LogWriter::LogWriter(QObject *parent)
+    : QThread(parent)
+    , m_open(false)
+    , m_pendingBytes(0)
+    , m_closing(false)
+    , m_flushInterval_ms(1000)
+    , m_flushSize(64 * 1024)
+    , m_syncOnClose(false)
+    , m_timestampFormatString("HH:mm:ss.zzz ")
+    , m_timestampFormatChanged(false)
+    , m_logColumnIdx(0)
+    , m_timestampFormatter(m_timestampFormatString)
+{
+}
+
+LogWriter::~LogWriter()
+{
+    close();
+    wait();
+}
+
+/**
+ * @brief LogWriter::open
+ * Opens log file and starts writer thread.
+ *
+ * @param filePath Path of log file.
+ * @param overwrite true: truncate existing file, false: append to it.
+ * @return true: log file opened.
+ */
+bool LogWriter::open(const QString &filePath, bool overwrite)
+{
+    close();
+    /* Previous file is finished by writer thread */
+    wait();
+    m_file.setFileName(filePath);
+    QIODevice::OpenMode openMode = QIODevice::Unbuffered;
+    openMode |= overwrite ? QIODevice::WriteOnly : QIODevice::Append;
+    if (!m_file.open(openMode))
+    {
+        m_errorString = m_file.errorString();
+        qCritical() << __PRETTY_FUNCTION__ << "cannot open" << filePath << m_errorString;
+        return false;
+    }
+    m_errorString.clear();
+    m_open = true;
+    m_closing = false;
+    m_logColumnIdx = 0;
+    m_buffer.clear();
+    /* Keep capacity of buffer between flushes */
+    m_buffer.reserve(64 * 1024);
+    start();
+    return true;
+}
+
+/**
+ * @brief LogWriter::close
+ * Stops logging. Writer thread writes all pending data, synchronizes file to
+ * disk if it is enabled and closes log file; close() does not wait for it.
+ */
+void LogWriter::close()
+{
+    if (!m_open)
+    {
+        return;
+    }
+    m_open = false;
+    m_mutex.lock();
+    m_closing = true;
+    m_waitCondition.wakeOne();
+    m_mutex.unlock();
+}
+
+bool LogWriter::isOpen() const
+{
+    return m_open;
+}
+
+QString LogWriter::errorString() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    return m_errorString;
+}
+
+/**
+ * @brief LogWriter::write
+ * Queues data to log. Timestamp is inserted at start of each line. Data is
+ * copied, so caller can reuse its buffer.
+ *
+ * @param data Received or sent data.
+ * @param read true: data was received, false: data was sent.
+ * @param timestamp_ms Time of reception/sending in milliseconds since epoch.
+ */
+void LogWriter::write(const QByteArray &data, bool read, qint64 timestamp_ms)
+{
+    if (!m_open || data.isEmpty())
+    {
+        return;
+    }
+    chunk_t chunk;
+    chunk.data = QByteArray(data.constData(), data.size());
+    chunk.timestamp_ms = timestamp_ms;
+    chunk.read = read;
+    chunk.raw = false;
+
+    QMutexLocker mutexLocker(&m_mutex);
+    m_pending.append(chunk);
+    m_pendingBytes += chunk.data.size();
+    if (m_pendingBytes >= qMax(m_flushSize, static_cast<qint64>(1)))
+    {
+        m_waitCondition.wakeOne();
+    }
+}
+
+/**
+ * @brief LogWriter::writeText
+ * Queues text to log as is, without timestamp. Used for messages like start
+ * and stop of logging.
+ *
+ * @param text Text to write.
+ */
+void LogWriter::writeText(const QByteArray &text)
+{
+    if (!m_open || text.isEmpty())
+    {
+        return;
+    }
+    chunk_t chunk;
+    chunk.data = text;
+    chunk.timestamp_ms = 0;
+    chunk.read = true;
+    chunk.raw = true;
+
+    QMutexLocker mutexLocker(&m_mutex);
+    m_pending.append(chunk);
+    m_pendingBytes += chunk.data.size();
+    if (m_pendingBytes >= qMax(m_flushSize, static_cast<qint64>(1)))
+    {
+        m_waitCondition.wakeOne();
+    }
+}
+
+void LogWriter::setTimestampFormatString(const QString &format)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    m_timestampFormatString = format;
+    m_timestampFormatChanged = true;
+}
+
+/**
+ * @brief LogWriter::setLineEnding
+ * Timestamp is inserted after last character of line ending.
+ *
+ * @param lineEndingRx Line ending of received data.
+ * @param lineEndingTx Line ending of sent data.
+ */
+void LogWriter::setLineEnding(const QByteArray &lineEndingRx, const QByteArray &lineEndingTx)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    m_lineEndingRxBA = lineEndingRx;
+    m_lineEndingTxBA = lineEndingTx;
+}
+
+int LogWriter::flushInterval_ms() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    return m_flushInterval_ms;
+}
+
+/**
+ * @brief LogWriter::setFlushInterval_ms
+ * @param flushInterval_ms Buffered data is written to file at least this often.
+ * 0: buffered data is written only when flush size is reached or on close.
+ */
+void LogWriter::setFlushInterval_ms(int flushInterval_ms)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    m_flushInterval_ms = flushInterval_ms;
+    m_waitCondition.wakeOne();
+}
+
+qint64 LogWriter::flushSize() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    return m_flushSize;
+}
+
+/**
+ * @brief LogWriter::setFlushSize
+ * @param flushSize Buffered data is written to file when it reaches this size
+ * in bytes. 0: data is written as soon as it is queued.
+ */
+void LogWriter::setFlushSize(qint64 flushSize)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    m_flushSize = flushSize;
+    m_waitCondition.wakeOne();
+}
+
+bool LogWriter::syncOnClose() const
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    return m_syncOnClose;
+}
+
+/**
+ * @brief LogWriter::setSyncOnClose
+ * @param syncOnClose true: log file is synchronized to disk when it is closed.
+ */
+void LogWriter::setSyncOnClose(bool syncOnClose)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    m_syncOnClose = syncOnClose;
+}
+
+void LogWriter::run()
+{
+    QElapsedTimer flushTimer;
+    flushTimer.start();
+
+    m_mutex.lock();
+    for (;;)
+    {
+        if (!m_closing && m_pendingBytes < qMax(m_flushSize, static_cast<qint64>(1)))
+        {
+            /* Nothing urgent: wait for more data or for flush interval */
+            if (m_flushInterval_ms > 0 && (m_pendingBytes || !m_buffer.isEmpty()))
+            {
+                qint64 remaining_ms = m_flushInterval_ms - flushTimer.elapsed();
+                if (remaining_ms > 0)
+                {
+                    m_waitCondition.wait(&m_mutex, static_cast<unsigned long>(remaining_ms));
+                }
+            }
+            else
+            {
+                m_waitCondition.wait(&m_mutex);
+            }
+        }
+
+        QVector<chunk_t> pending;
+        pending.swap(m_pending);
+        m_pendingBytes = 0;
+        bool closing = m_closing;
+        bool syncOnClose = m_syncOnClose;
+        int flushInterval_ms = m_flushInterval_ms;
+        qint64 flushSize = m_flushSize;
+        m_mutex.unlock();
+
+        for (int i = 0; i < pending.size(); i++)
+        {
+            formatChunk(pending.at(i));
+        }
+        pending.clear();
+
+        if (!m_buffer.isEmpty()
+                && (closing
+                    || m_buffer.size() >= flushSize
+                    || (flushInterval_ms > 0 && flushTimer.elapsed() >= flushInterval_ms)))
+        {
+            flushBuffer();
+            flushTimer.restart();
+        }
+        if (closing)
+        {
+            if (syncOnClose)
+            {
+                syncFile();
+            }
+            m_file.close();
+            break;
+        }
+        m_mutex.lock();
+    }
+}
+
+/**
+ * @brief LogWriter::formatChunk
+ * Appends chunk to m_buffer and inserts timestamp at start of each line.
+ *
+ * @param chunk Chunk to format.
+ */
+void LogWriter::formatChunk(const chunk_t &chunk)
+{
+    if (chunk.raw)
+    {
+        m_buffer.append(chunk.data);
+        return;
+    }
+
+    m_mutex.lock();
+    const QByteArray &lineEnding = chunk.read ? m_lineEndingRxBA : m_lineEndingTxBA;
+    bool hasLineEnd = !lineEnding.isEmpty();
+    char lineEnd = hasLineEnd ? lineEnding.at(lineEnding.size() - 1) : '\0';
+    if (m_timestampFormatChanged)
+    {
+        m_timestampFormatter.setFormat(m_timestampFormatString);
+        m_timestampFormatChanged = false;
+    }
+    m_mutex.unlock();
+
+    const char *data = chunk.data.constData();
+    int len = chunk.data.size();
+    int pos = 0;
+    while (pos < len)
+    {
+        if (!m_logColumnIdx)
+        {
+            m_timestampFormatter.append(m_buffer, chunk.timestamp_ms);
+        }
+        const char *end = hasLineEnd
+                ? static_cast<const char *>(memchr(data + pos, lineEnd, static_cast<size_t>(len - pos)))
+                : NULL;
+        if (end)
+        {
+            int lineLen = static_cast<int>(end - (data + pos)) + 1;
+            m_buffer.append(data + pos, lineLen);
+            pos += lineLen;
+            m_logColumnIdx = 0;
+        }
+        else
+        {
+            m_buffer.append(data + pos, len - pos);
+            m_logColumnIdx += len - pos;
+            pos = len;
+        }
+    }
+}
+
+/**
+ * @brief LogWriter::flushBuffer
+ * Writes m_buffer to log file.
+ */
+void LogWriter::flushBuffer()
+{
+    qint64 written = m_file.write(m_buffer);
+    if (written != m_buffer.size())
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot write log:" << m_file.errorString();
+        QMutexLocker mutexLocker(&m_mutex);
+        m_errorString = m_file.errorString();
+    }
+    m_buffer.resize(0);
+}
+
+/**
+ * @brief LogWriter::syncFile
+ * Synchronizes log file data to disk. fdatasync() is Linux only, macOS
+ * needs F_FULLFSYNC to flush the drive's cache, other systems use fsync().
+ */
+void LogWriter::syncFile()
+{
+    int fd = m_file.handle();
+    if (fd < 0)
+    {
+        return;
+    }
+#if WINDOWS
+    if (_commit(fd) != 0)
+#elif LINUX
+    if (::fdatasync(fd) != 0)
+#elif defined(F_FULLFSYNC)
+    if (::fcntl(fd, F_FULLFSYNC) < 0 && ::fsync(fd) != 0)
+#else
+    if (::fsync(fd) != 0)
+#endif
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot synchronize log:" << strerror(errno);
+    }
+}
@@ -0,0 +1,93 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef LOGWRITER_H
+#define LOGWRITER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QWaitCondition>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+#include <QFile>
+
+#include "timestampformatter.h"
+
+/**
+ * @brief The LogWriter class
+ * Writes the auto-log on its own thread. Producer (SerialThread) only copies
+ * received/sent chunks into a queue, the writer thread inserts timestamps and
+ * writes the file in large blocks. The writer thread also finishes the file
+ * on close, so the producer never waits for the disk.
+ */
+class LogWriter : public QThread
+{
+    Q_OBJECT
+public:
+    explicit LogWriter(QObject *parent = 0);
+    ~LogWriter();
+
+    bool open(const QString &filePath, bool overwrite);
+    void close();
+    bool isOpen() const;
+    QString errorString() const;
+
+    void write(const QByteArray &data, bool read, qint64 timestamp_ms);
+    void writeText(const QByteArray &text);
+
+    void setTimestampFormatString(const QString &format);
+    void setLineEnding(const QByteArray &lineEndingRx, const QByteArray &lineEndingTx);
+
+    int flushInterval_ms() const;
+    void setFlushInterval_ms(int flushInterval_ms);
+
+    qint64 flushSize() const;
+    void setFlushSize(qint64 flushSize);
+
+    bool syncOnClose() const;
+    void setSyncOnClose(bool syncOnClose);
+
+protected:
+    void run();
+
+private:
+    Q_DISABLE_COPY(LogWriter)
+
+    typedef struct
+    {
+        QByteArray data;
+        qint64 timestamp_ms;
+        bool read;              /**< true: received, false: sent data. */
+        bool raw;               /**< true: write as is, without timestamps. */
+    } chunk_t;
+
+    void formatChunk(const chunk_t &chunk);
+    void flushBuffer();
+    void syncFile();
+
+    QFile m_file;                   /**< Used by writer thread while it runs. */
+    bool m_open;                    /**< Log is opened, used by producer only. */
+    mutable QMutex m_mutex;
+    QWaitCondition m_waitCondition;
+    QVector<chunk_t> m_pending;     /**< Chunks not processed by writer thread yet. Protected by m_mutex. */
+    qint64 m_pendingBytes;          /**< Size of m_pending in bytes. Protected by m_mutex. */
+    bool m_closing;                 /**< Protected by m_mutex. */
+    int m_flushInterval_ms;         /**< 0: no periodic flush. */
+    qint64 m_flushSize;             /**< 0: write each batch immediately. */
+    bool m_syncOnClose;
+    QString m_timestampFormatString;
+    bool m_timestampFormatChanged;  /**< Protected by m_mutex. */
+    QByteArray m_lineEndingRxBA;
+    QByteArray m_lineEndingTxBA;
+    QString m_errorString;
+    /* Used only by writer thread */
+    QByteArray m_buffer;            /**< Formatted data waiting to be written. */
+    int m_logColumnIdx;
+    TimestampFormatter m_timestampFormatter;
+};
+
+#endif // LOGWRITER_H
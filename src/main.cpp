@@ -37,14 +37,121 @@
 ****************************************************************************/
 
 #include <QApplication>
+#include <QCommandLineParser>
+#include <QTextStream>
+
+#include <string.h>
 
 #include "mainwindow.h"
+#include "headlesssession.h"
+#include "version.h"
+
+/**
+ * @brief isHeadless
+ * Checked before any application object is created: headless mode shall not
+ * create QApplication (no display connection, smaller memory footprint).
+ */
+static bool isHeadless(int argc, char *argv[])
+{
+    for (int i = 1; i < argc; i++)
+    {
+        if (strcmp(argv[i], "--headless") == 0)
+        {
+            return true;
+        }
+    }
+    return false;
+}
+
+/**
+ * @brief runHeadless
+ * Parses command line of headless mode and captures until stopped.
+ * Example: iserterm --headless --profile X --log out.log --timeout 3600
+ */
+static int runHeadless(QCoreApplication &app)
+{
+    QCommandLineParser parser;
+    QTextStream err(stderr);
+
+    parser.setApplicationDescription(QCoreApplication::translate("main", "RS-232 serial terminal, headless capture mode"));
+    parser.addHelpOption();
+    parser.addVersionOption();
+    QCommandLineOption headlessOption("headless", QCoreApplication::translate("main", "Capture without GUI."));
+    QCommandLineOption profileOption("profile", QCoreApplication::translate("main", "Serial settings profile to use, default: current settings."),
+                                     QCoreApplication::translate("main", "name"));
+    QCommandLineOption portOption("port", QCoreApplication::translate("main", "Port name, overrides the one in settings."),
+                                  QCoreApplication::translate("main", "port"));
+    QCommandLineOption logOption("log", QCoreApplication::translate("main", "Log file, default: auto-log settings."),
+                                 QCoreApplication::translate("main", "file"));
+    QCommandLineOption captureOption("capture", QCoreApplication::translate("main", "Write binary capture (.iscap) next to the log file."));
+    QCommandLineOption timeoutOption("timeout", QCoreApplication::translate("main", "Stop after given seconds."),
+                                     QCoreApplication::translate("main", "seconds"));
+    QCommandLineOption bytesOption("bytes", QCoreApplication::translate("main", "Stop after given number of received bytes."),
+                                   QCoreApplication::translate("main", "count"));
+    parser.addOption(headlessOption);
+    parser.addOption(profileOption);
+    parser.addOption(portOption);
+    parser.addOption(logOption);
+    parser.addOption(captureOption);
+    parser.addOption(timeoutOption);
+    parser.addOption(bytesOption);
+    parser.process(app);
+
+    HeadlessSession session;
+    if (parser.isSet(profileOption) && !session.loadProfile(parser.value(profileOption)))
+    {
+        err << QCoreApplication::translate("main", "Profile not found: %1").arg(parser.value(profileOption)) << "\n";
+        return 2;
+    }
+    if (parser.isSet(portOption))
+    {
+        session.setPortName(parser.value(portOption));
+    }
+    if (parser.isSet(logOption))
+    {
+        session.setLogFilePath(parser.value(logOption));
+    }
+    session.setCaptureEnabled(parser.isSet(captureOption));
+    if (parser.isSet(timeoutOption))
+    {
+        bool ok;
+        double timeout_s = parser.value(timeoutOption).toDouble(&ok);
+        if (!ok || timeout_s <= 0.0)
+        {
+            err << QCoreApplication::translate("main", "Invalid timeout: %1").arg(parser.value(timeoutOption)) << "\n";
+            return 2;
+        }
+        session.setTimeout_ms(static_cast<qint64>(timeout_s * 1000.0));
+    }
+    if (parser.isSet(bytesOption))
+    {
+        bool ok;
+        qint64 bytes = parser.value(bytesOption).toLongLong(&ok);
+        if (!ok || bytes <= 0)
+        {
+            err << QCoreApplication::translate("main", "Invalid byte count: %1").arg(parser.value(bytesOption)) << "\n";
+            return 2;
+        }
+        session.setByteLimit(bytes);
+    }
+
+    HeadlessSession::installSignalHandlers();
+    session.start();
+    return app.exec();
+}
 
 int main(int argc, char *argv[])
 {
     QCoreApplication::setOrganizationName("iserterm");
     QCoreApplication::setOrganizationDomain("ivanov.eu");
     QCoreApplication::setApplicationName("iserterm");
+    QCoreApplication::setApplicationVersion(VER_FILEVERSION_STR);
+
+    if (isHeadless(argc, argv))
+    {
+        QCoreApplication a(argc, argv);
+        return runHeadless(a);
+    }
 
     QApplication a(argc, argv);
     MainWindow w;
@@ -64,11 +64,21 @@
 #include <QComboBox>
 #include <QCompleter>
 #include <QInputDialog>
+#include <QTabWidget>
+#include <QGuiApplication>
+#include <QScreen>
 
 MainWindow::MainWindow(QWidget *parent)
     : QMainWindow(parent)
     , ui(new Ui::MainWindow)
-    , m_serialError(false)
+    , m_currentSession(NULL)
+    , m_progressSession(NULL)
+    , m_console(NULL)
+    , m_currentSerialSettings(NULL)
+    , m_serialThread(NULL)
+    , m_performanceLabel(NULL)
+    , m_performanceBytesReceived(0)
+    , m_performanceBytesSent(0)
 {
     QSettings settings;
 
@@ -76,7 +86,6 @@ MainWindow::MainWindow(QWidget *parent)
     settings.setDefaultFormat(QSettings::Format::NativeFormat);
     ui->setupUi(this);
 
-    m_currentSerialSettings.loadSettings();
     m_multivalidator = new MultiValidator (this);
 
     m_customTexts.reserve(CUSTOM_TEXT_NUM);
@@ -94,9 +103,13 @@ MainWindow::MainWindow(QWidget *parent)
     setWindowIcon (QIcon (":/images/iserterm.png"));
     setWindowTitle(VER_PRODUCTNAME_STR);
     resize(settings.value("window/width", 500).toInt(), settings.value("window/height", 300).toInt());
-    m_console = new Console;
-    setEnableConsole(false);
-    ui->consoleWidget->addWidget(m_console);
+    /* Tab bar is shown only if there are more sessions */
+    m_tabWidget = new QTabWidget(this);
+    m_tabWidget->setDocumentMode(true);
+    m_tabWidget->setTabsClosable(true);
+    m_tabWidget->setTabBarAutoHide(true);
+    ui->consoleWidget->addWidget(m_tabWidget);
+    setCurrentSession(createSession());
     ui->sendModeComboBox->addItem(tr("ASCII"), QVariant(Multistring::ASCII));
     ui->sendModeComboBox->addItem(tr("Hex"), QVariant(Multistring::Hexadecimal));
     ui->sendModeComboBox->addItem(tr("Dec"), QVariant(Multistring::Decimal));
@@ -142,21 +155,6 @@ MainWindow::MainWindow(QWidget *parent)
     ui->sendLineEdit->completer()->setCaseSensitivity(static_cast<Qt::CaseSensitivity>(settings.value("completion/caseSensitivity").toInt()));
     ui->sendLineEdit->view()->installEventFilter(evfilter);
     ui->eolCheckBox->setChecked(settings.value("console/eolCheckBox").toBool());
-    m_console->setAutoWrapColumn (settings.value("serial/autoWrapColumn", m_console->getAutoWrapColumn()).toInt ());
-    m_console->setLineEndingRx (settings.value("serial/lineEndingRx", m_console->getLineEndingRx ()).toString ());
-    m_console->setLineEndingTx (settings.value("serial/lineEndingTx", m_console->getLineEndingTx ()).toString ());
-    m_console->setDataSizeLimit (settings.value("serial/dataSizeLimit", m_console->getDataSizeLimit ()).toInt ());
-    m_console->setDisplaySize (settings.value("serial/displaySize", m_console->getDisplaySize ()).toInt ());
-    m_console->setHexWrap (settings.value("serial/hexWrap", m_console->getHexWrap ()).toInt ());
-    m_console->setTimestampFormatString(settings.value("console/timestampFormatString", m_console->getTimestampFormatString()).toString());
-
-    m_serialThread = new SerialThread(NULL, &m_currentSerialSettings);
-    m_serialThread->setDelayAfterBytes_ms (settings.value ("serial/delayAfterBytes_ms", m_serialThread->getDelayAfterBytes_ms ()).toInt());
-    m_serialThread->setDelayAfterChr_ms(settings.value ("serial/delayAfterNewline_ms", m_serialThread->getDelayAfterChr_ms()).toInt(),
-                                        m_console->getLineEndingTx().right(1).toLatin1());
-    m_serialThread->setLineEndingRx(m_console->getLineEndingRx());
-    m_serialThread->setLineEndingTx(m_console->getLineEndingTx());
-    m_serialThread->start (QThread::NormalPriority);
 //    m_serialSettingsDialog = new SettingsDialog;
 
     ui->actionLocal_echo->setChecked(settings.value("serial/localEchoEnabled", true).toBool());
@@ -176,6 +174,15 @@ MainWindow::MainWindow(QWidget *parent)
     m_abortButton = new QPushButton(tr("Abort"), this);
     m_abortButton->hide();
     ui->statusBar->addPermanentWidget(m_abortButton);
+    m_performanceLabel = new QLabel(this);
+    m_performanceLabel->hide();
+    ui->statusBar->addPermanentWidget(m_performanceLabel);
+    m_performanceTimer.setSingleShot(false);
+    m_performanceTimer.setInterval(1000);
+    MY_ASSERT(connect(&m_performanceTimer, SIGNAL(timeout()), this, SLOT(updatePerformance())));
+    bool showPerformance = settings.value("console/showPerformance", false).toBool();
+    ui->actionShow_performance->setChecked(showPerformance);
+    on_actionShow_performance_triggered(showPerformance);
 
     MY_ASSERT(connect(ui->sendLineEdit->lineEdit(), SIGNAL(returnPressed()), this, SLOT(onSendLineEdit_returnPressed())));
     MY_ASSERT(connect(ui->sendModeComboBox, SIGNAL(currentIndexChanged(int)), this, SLOT(onSendModeComboBox_currentIndexChanged())));
@@ -184,41 +191,20 @@ MainWindow::MainWindow(QWidget *parent)
     MY_ASSERT(connect(ui->actionDisconnect, SIGNAL(triggered()), this, SLOT(closeSerialPort())));
     MY_ASSERT(connect(ui->actionQuit, SIGNAL(triggered()), this, SLOT(close())));
 //    MY_ASSERT(connect(ui->actionConfigure, SIGNAL(triggered()), m_serialSettingsDialog, SLOT(show())));
-    MY_ASSERT(connect(ui->actionClear, SIGNAL(triggered()), m_console, SLOT(clear())));
     MY_ASSERT(connect(ui->actionAbout, SIGNAL(triggered()), this, SLOT(about())));
     MY_ASSERT(connect(ui->actionAboutQt, SIGNAL(triggered()), qApp, SLOT(aboutQt())));
+    MY_ASSERT(connect(m_tabWidget, SIGNAL(currentChanged(int)), this, SLOT(currentSessionChanged(int))));
+    MY_ASSERT(connect(m_tabWidget, SIGNAL(tabCloseRequested(int)), this, SLOT(closeSession(int))));
 
-    MY_ASSERT(connect(m_serialThread, SIGNAL(message(QString,bool)), this, SLOT(serialMessage(QString,bool))));
-    MY_ASSERT(connect(m_serialThread, SIGNAL(portStatusChanged(bool)), this, SLOT(serialPortStatusChanged(bool))));
-    MY_ASSERT(connect(m_serialThread, SIGNAL(error(QSerialPort::SerialPortError)), this,
-            SLOT(handleError(QSerialPort::SerialPortError))));
-#if USE_UPDATE_TIMER == 0
-    MY_ASSERT(connect(m_serialThread, SIGNAL(readyRead()), this, SLOT(readData())));
-#endif
-    MY_ASSERT(connect(m_serialThread, SIGNAL(progress(QString,int)), this, SLOT(serialProgress(QString,int))));
-    MY_ASSERT(connect(m_serialThread, SIGNAL(finish()), this, SLOT(serialFinish())));
-    MY_ASSERT(connect(m_serialThread, SIGNAL(pinoutSignalsChanged(QSerialPort::PinoutSignals)),
-                      this, SLOT(serialPinoutsChanged(QSerialPort::PinoutSignals))));
-
-    MY_ASSERT(connect(m_console, SIGNAL(getData(QByteArray)), this, SLOT(writeData(QByteArray))));
-
-    MY_ASSERT(connect(m_abortButton, SIGNAL(pressed()), m_serialThread, SLOT(abortSend())));
-
-#if USE_UPDATE_TIMER
-    /* Timer is used to prevent flooding of console with data */
-    m_updateTimer.setSingleShot(false);
-    m_updateTimer.setInterval(50); /* FIXME this could be configurable */
-    m_updateTimer.start();
-
-    MY_ASSERT(connect(&m_updateTimer, SIGNAL(timeout()), this, SLOT(readData())));
-#endif
+    MY_ASSERT(connect(m_abortButton, SIGNAL(pressed()), this, SLOT(abortSend())));
 }
 
 MainWindow::~MainWindow()
 {
     QSettings settings;
 
-    m_currentSerialSettings.saveSettings();
+    /* Settings of first session are used at next start */
+    m_sessions.first()->serialSettings->saveSettings();
 
     settings.setValue("window/width", size().width());
     settings.setValue("window/height", size().height());
@@ -229,12 +215,16 @@ MainWindow::~MainWindow()
     settings.setValue("console/sendLineEdit", ui->sendLineEdit->lineEdit()->text());
     settings.setValue("console/eolCheckBox", ui->eolCheckBox->isChecked());
     settings.setValue("console/showTimestamp", ui->actionShow_timestamp->isChecked());
+    settings.setValue("console/showPerformance", ui->actionShow_performance->isChecked());
     saveHistory(m_sendLine.getMode(), getCurrentHistory());
-    if (m_serialThread)
+    foreach (session_t *session, m_sessions)
     {
-        m_serialThread->stop(250);
+        session->serialThread->stop(250);
+        delete session->serialThread;
+        session->serialThread = NULL;
+        delete session;
     }
-    delete m_serialThread;
+    m_sessions.clear();
     m_serialThread = NULL;
 //    delete m_serialSettingsDialog;
 //    m_serialSettingsDialog = NULL;
@@ -348,7 +338,7 @@ void MainWindow::setVisibleCustomText(int idx, bool visible, const QString& text
 
 void MainWindow::openSerialPort()
 {
-    qDebug() << __FUNCTION__ << m_currentSerialSettings.toString();
+    qDebug() << __FUNCTION__ << m_currentSerialSettings->toString();
     // It is not necessary to set port name, baud rate in serial thread as m_currentSerialSettings
     // already contains the settings
     m_serialThread->open(QIODevice::ReadWrite);
@@ -362,7 +352,7 @@ void MainWindow::closeSerialPort(const QString &errorMsg)
 
     if (m_serialThread->isOpen())
     {
-        qDebug() << __FUNCTION__ << m_currentSerialSettings.toString();
+        qDebug() << __FUNCTION__ << m_currentSerialSettings->toString();
         m_serialThread->close();
     }
     else
@@ -372,33 +362,42 @@ void MainWindow::closeSerialPort(const QString &errorMsg)
 }
 
 void MainWindow::updateBackgroundColor()
+{
+    foreach (session_t *session, m_sessions)
+    {
+        updateBackgroundColor(session);
+    }
+}
+
+void MainWindow::updateBackgroundColor(session_t *session)
 {
     QSettings settings;
-    QPalette palette = m_console->palette();
+    Console *console = session->console;
+    QPalette palette = console->palette();
 
-    if (m_serialThread->isOpen())
+    if (session->serialThread->isOpen())
     {
         /* Port opened */
-        if (m_console->isUpdateEnabled())
+        if (console->isUpdateEnabled())
         {
             /* Normal mode */
-            QColor color = settings.value("console/bgcolor", m_console->m_bgcolordef).toString();
+            QColor color = settings.value("console/bgcolor", console->m_bgcolordef).toString();
             palette.setColor(QPalette::Base, color);
         }
         else
         {
             /* STOP button pressed */
-            QColor color = settings.value("console/stoppedbgcolor", m_console->m_stoppedbgcolordef).toString();
+            QColor color = settings.value("console/stoppedbgcolor", console->m_stoppedbgcolordef).toString();
             palette.setColor(QPalette::Base, color);
         }
     }
     else
     {
         /* Port closed */
-        QColor color = settings.value("console/inactbgcolor", m_console->m_inactbgcolordef).toString();
+        QColor color = settings.value("console/inactbgcolor", console->m_inactbgcolordef).toString();
         palette.setColor(QPalette::Base, color);
     }
-    m_console->setPalette(palette);
+    console->setPalette(palette);
 }
 
 void MainWindow::about()
@@ -434,22 +433,50 @@ void MainWindow::about()
 
 void MainWindow::writeData(const QByteArray &data)
 {
-    /* Send user input */
-    m_serialThread->write (data);
+    session_t *session = findSession(sender());
+
+    /* Send user input to port of the console */
+    if (session)
+    {
+        session->serialThread->write (data);
+    }
 }
 
 void MainWindow::readData()
 {
-    QByteArray data = m_serialThread->readAll();
-    if (data.length())
+    session_t *session = findSession(sender());
+
+    if (session)
     {
-        /* Receive serial data and show on console */
-        m_console->putData(data);
+        readSessionData(session);
+    }
+}
+
+void MainWindow::readSessionData(session_t *session)
+{
+    const char *data;
+    qint64 len;
+    arrivalTime_t arrivalTime;
+
+    /* Receive serial data and show on console without copying it.
+     * Timestamps are taken when data was read from the port. */
+    session->serialThread->acknowledgeReadyRead();
+    while ((len = session->serialThread->peekReadData(&data, &arrivalTime)) > 0)
+    {
+        session->console->putData(QByteArray::fromRawData(data, static_cast<int>(len)), arrivalTime.wallClock_ms,
+                                  arrivalTime.transmitted ? ConsoleDataStore::DIRECTION_tx : ConsoleDataStore::DIRECTION_rx);
+        session->serialThread->consumeReadData(len);
     }
 }
 
 void MainWindow::serialMessage(QString message, bool error)
 {
+    session_t *session = findSession(sender());
+
+    if (session && m_sessions.size() > 1)
+    {
+        message = QString("%1: %2").arg(session->serialSettings->m_serialSettings.name).arg(message);
+    }
     if (error)
     {
         QMessageBox::critical(this, tr("Error"), message);
@@ -464,58 +491,87 @@ void MainWindow::serialMessage(QString message, bool error)
 
 void MainWindow::serialPortStatusChanged(bool opened)
 {
-    setEnableConsole(opened);
+    session_t *session = findSession(sender());
+    SerialThread *serialThread;
+
+    if (!session)
+    {
+        return;
+    }
+    serialThread = session->serialThread;
+    session->console->setReadOnly(!opened);
+    if (session == m_currentSession)
+    {
+        setEnableConsole(opened);
+    }
     if (opened)
     {
         //console->setLocalEchoEnabled(p.localEchoEnabled);
-        m_console->setLocalEchoEnabled(ui->actionLocal_echo->isChecked());
+        session->console->setLocalEchoEnabled(ui->actionLocal_echo->isChecked());
         ui->statusBar->showMessage(tr("Connected to %1: %2, %3%4%5, %6")
-                                   .arg(m_serialThread->portName()).arg(m_serialThread->baudRate()).arg(m_serialThread->dataBits())
-                                   .arg(m_serialThread->parityStr()[0]).arg(m_serialThread->stopBits()).arg(m_serialThread->flowControlStr()));
-        QString title = QString("%1 - %2, %3, %4%5%6, %7").arg(VER_PRODUCTNAME_STR).arg(m_serialThread->portName())
-                .arg(m_serialThread->baudRate()).arg(m_serialThread->dataBits()).arg(m_serialThread->parityStr()[0]).arg(m_serialThread->stopBits())
-                .arg(m_serialThread->flowControlStr());
-        setWindowTitle(title);
+                                   .arg(serialThread->portName()).arg(serialThread->baudRate()).arg(serialThread->dataBits())
+                                   .arg(serialThread->parityStr()[0]).arg(serialThread->stopBits()).arg(serialThread->flowControlStr()));
     }
     else
     {
-        if (m_serialError)
+        if (session->serialError)
         {
-            QString errorMsg = m_serialThread->errorString();
-            ui->statusBar->showMessage(tr("Disconnected: %1").arg(errorMsg));
+            QString errorMsg = serialThread->errorString();
+            ui->statusBar->showMessage(tr("Disconnected %1: %2").arg(session->serialSettings->m_serialSettings.name).arg(errorMsg));
         }
         else
         {
-            ui->statusBar->showMessage(tr("Disconnected"));
+            ui->statusBar->showMessage(tr("Disconnected %1").arg(session->serialSettings->m_serialSettings.name));
         }
-        m_serialError = false;
-        setWindowTitle(VER_PRODUCTNAME_STR);
+        session->serialError = false;
     }
-    updateBackgroundColor();
+    updateSessionTitle(session);
+    updateWindowTitle();
+    updateBackgroundColor(session);
 }
 
 void MainWindow::handleError(QSerialPort::SerialPortError error)
 {
-    if (error != QSerialPort::NoError && error != QSerialPort::TimeoutError)
+    session_t *session = findSession(sender());
+
+    if (session && error != QSerialPort::NoError && error != QSerialPort::TimeoutError)
     {
-        m_serialError = true;
-        m_serialThread->close();
+        session->serialError = true;
+        session->serialThread->close();
+    }
+}
+
+/**
+ * @brief MainWindow::abortSend
+ * Stops sending or replay of the session which shows progress.
+ */
+void MainWindow::abortSend()
+{
+    if (m_progressSession)
+    {
+        m_progressSession->serialThread->abortSend();
     }
 }
 
 void MainWindow::on_actionLocal_echo_triggered(bool checked)
 {
-    m_console->setLocalEchoEnabled(checked);
+    foreach (session_t *session, m_sessions)
+    {
+        session->console->setLocalEchoEnabled(checked);
+    }
 }
 
 void MainWindow::on_actionSet_font_triggered()
 {
     bool ok;
-    QFont font = QFontDialog::getFont(&ok, m_console->document()->defaultFont());
+    QFont font = QFontDialog::getFont(&ok, m_console->font(), this, QString(), QFontDialog::MonospacedFonts);
 
     if (ok)
     {
-        m_console->document()->setDefaultFont(font);
+        foreach (session_t *session, m_sessions)
+        {
+            session->console->setFont(font);
+        }
         QSettings settings;
         settings.setValue("console/font", font.toString());
     }
@@ -578,8 +634,12 @@ void MainWindow::on_actionSet_foreground_color_triggered()
     {
         QSettings settings;
         settings.setValue("console/fgcolor", color.name(QColor::HexArgb));
-        palette.setColor(QPalette::Text, color);
-        m_console->setPalette(palette);
+        foreach (session_t *session, m_sessions)
+        {
+            palette = session->console->palette();
+            palette.setColor(QPalette::Text, color);
+            session->console->setPalette(palette);
+        }
     }
 }
 
@@ -606,7 +666,7 @@ void MainWindow::onSendLineEdit_returnPressed()
         m_serialThread->write(data);
         if (ui->actionLocal_echo->isChecked())
         {
-            m_console->putData(data);
+            m_console->putData(data, -1, ConsoleDataStore::DIRECTION_tx);
         }
     }
 
@@ -652,6 +712,8 @@ void MainWindow::on_actionConfigure_console_triggered()
     dialog->setHexWrap(m_console->getHexWrap ());
     dialog->setDelayAfterSendByte(m_serialThread->getDelayAfterBytes_ms());
     dialog->setDelayAfterSendNewLine(m_serialThread->getDelayAfterChr_ms());
+    dialog->setDelayAfterSendByte_us(m_serialThread->getDelayAfterBytes_us());
+    dialog->setDelayAfterSendNewLine_us(m_serialThread->getDelayAfterChr_us());
     dialog->setTimestampFormatString(m_console->getTimestampFormatString());
     dialog->setAutoLogFileName(m_serialThread->autoLogFileName());
     dialog->setAutoLogFilePath(m_serialThread->autoLogFilePath());
@@ -700,12 +762,21 @@ void MainWindow::on_actionConfigure_console_triggered()
         m_console->setTimestampFormatString(timestampFormatString);
         m_serialThread->setDelayAfterBytes_ms(delayAfterBytes_ms);
         m_serialThread->setDelayAfterChr_ms(delayAfterNewline_ms, lineEndingTx.right(1).toLatin1());
+        m_serialThread->setDelayAfterBytes_us(dialog->getDelayAfterSendByte_us());
+        m_serialThread->setDelayAfterChr_us(dialog->getDelayAfterSendNewLine_us());
         m_serialThread->setLineEndingRx(lineEndingRx);
         m_serialThread->setLineEndingTx(lineEndingTx);
         m_serialThread->enableAutoLog(dialog->isAutoLogEnabled());
         m_serialThread->setAutoLogFileName(dialog->getAutoLogFileName());
         m_serialThread->setAutoLogFilePath(dialog->getAutoLogFilePath());
         m_serialThread->setTimestampFormatString(dialog->getAutoLogTimestampFormatString());
+        /* Queue size is applied to new sessions only */
+        SerialThread::readQueuePolicy_t readQueuePolicy =
+                static_cast<SerialThread::readQueuePolicy_t>(settings.value("serial/readQueuePolicy", SerialThread::READ_QUEUE_block).toInt());
+        foreach (session_t *session, m_sessions)
+        {
+            session->serialThread->setReadQueuePolicy(readQueuePolicy);
+        }
         ui->sendLineEdit->completer()->setCompletionMode(dialog->getCompletionMode());
         ui->sendLineEdit->completer()->setCaseSensitivity(dialog->getCompletionCaseSensitivity());
     }
@@ -727,8 +798,106 @@ void MainWindow::on_actionShow_line_status_triggered(bool checked)
     ui->brkLabel->setHidden(!checked);
 }
 
+void MainWindow::on_actionShow_performance_triggered(bool checked)
+{
+    m_performanceLabel->setVisible(checked);
+    if (checked)
+    {
+        resetPerformance();
+        m_performanceLabel->setText(tr("Collecting statistics..."));
+        m_performanceTimer.start();
+    }
+    else
+    {
+        m_performanceTimer.stop();
+    }
+}
+
+static QString formatBytes(double bytes)
+{
+    if (bytes >= 1024.0 * 1024.0)
+    {
+        return QString("%1 MiB").arg(bytes / (1024.0 * 1024.0), 0, 'f', 1);
+    }
+    if (bytes >= 1024.0)
+    {
+        return QString("%1 KiB").arg(bytes / 1024.0, 0, 'f', 1);
+    }
+    return QString("%1 B").arg(bytes, 0, 'f', 0);
+}
+
+/**
+ * @brief MainWindow::resetPerformance
+ * Starts new sample period, called when the current session changes.
+ */
+void MainWindow::resetPerformance()
+{
+    if (m_serialThread)
+    {
+        m_performanceBytesReceived = m_serialThread->bytesReceived();
+        m_performanceBytesSent = m_serialThread->bytesSent();
+    }
+    if (m_console)
+    {
+        m_console->takePutDataStatistics();
+    }
+    m_performanceElapsedTimer.start();
+}
+
+/**
+ * @brief MainWindow::updatePerformance
+ * Shows throughput, pending data and console cost of the current session
+ * since the previous sample. Only counters are read, so it is cheap enough to
+ * run all the time.
+ */
+void MainWindow::updatePerformance()
+{
+    if (!m_serialThread || !m_console)
+    {
+        return;
+    }
+    qint64 elapsed_ms = m_performanceElapsedTimer.restart();
+    double elapsed_s = qMax<qint64>(elapsed_ms, 1) / 1000.0;
+    quint64 bytesReceived = m_serialThread->bytesReceived();
+    quint64 bytesSent = m_serialThread->bytesSent();
+    Console::putDataStatistics_t putDataStatistics = m_console->takePutDataStatistics();
+    double putDataAvg_us = putDataStatistics.calls
+            ? putDataStatistics.time_ns / 1000.0 / putDataStatistics.calls : 0.0;
+
+    QString text = tr("RX %1/s (%2) TX %3/s (%4) | putData %5/s avg %6 us max %7 us | buffer %8, %9 lines")
+                .arg(formatBytes((bytesReceived - m_performanceBytesReceived) / elapsed_s))
+                .arg(formatBytes(m_serialThread->bytesAvailable() + m_serialThread->readOverflowSize()))
+                .arg(formatBytes((bytesSent - m_performanceBytesSent) / elapsed_s))
+                .arg(formatBytes(m_serialThread->bytesToWrite()))
+                .arg(putDataStatistics.calls / elapsed_s, 0, 'f', 0)
+                .arg(putDataAvg_us, 0, 'f', 0)
+                .arg(putDataStatistics.maxTime_ns / 1000)
+                .arg(formatBytes(m_console->bufferMemory()))
+                .arg(m_console->lineCount());
+    if (m_serialThread->bytesDropped() || m_serialThread->bytesSpilled())
+    {
+        text += tr(" | RX dropped %1, spilled %2")
+                .arg(formatBytes(m_serialThread->bytesDropped()))
+                .arg(formatBytes(m_serialThread->bytesSpilled()));
+    }
+    qint64 roundTrip_us = m_serialThread->roundTripTime_us();
+    if (roundTrip_us >= 0)
+    {
+        text += tr(" | round trip %1 ms").arg(roundTrip_us / 1000.0, 0, 'f', 1);
+    }
+    m_performanceLabel->setText(text);
+    m_performanceBytesReceived = bytesReceived;
+    m_performanceBytesSent = bytesSent;
+}
+
 void MainWindow::serialProgress(QString message, int percent)
 {
+    session_t *session = findSession(sender());
+
+    if (session)
+    {
+        m_progressSession = session;
+    }
     if (message.length())
     {
         ui->statusBar->showMessage(message);
@@ -740,11 +909,33 @@ void MainWindow::serialProgress(QString message, int percent)
 
 void MainWindow::serialFinish()
 {
+    session_t *session = findSession(sender());
+
+    /* Progress of other session is still shown */
+    if (m_progressSession && session != m_progressSession)
+    {
+        return;
+    }
+    m_progressSession = NULL;
     m_progressBar->hide();
     m_abortButton->hide();
 }
 
 void MainWindow::serialPinoutsChanged(QSerialPort::PinoutSignals pinoutSignals)
+{
+    session_t *session = findSession(sender());
+
+    if (session)
+    {
+        session->pinoutSignals = pinoutSignals;
+    }
+    if (session == m_currentSession)
+    {
+        showPinoutSignals(pinoutSignals);
+    }
+}
+
+void MainWindow::showPinoutSignals(QSerialPort::PinoutSignals pinoutSignals)
 {
     ui->rxLabel->setEnabled(pinoutSignals.testFlag(QSerialPort::TransmittedDataSignal));
     ui->txLabel->setEnabled(pinoutSignals.testFlag(QSerialPort::ReceivedDataSignal));
@@ -770,18 +961,19 @@ void MainWindow::on_actionSend_file_triggered()
             settings.setValue("console/sendFileDir", dir);
             QFile file (fileName);
 
+            /* File is only checked here, it is read while it is sent */
             if (file.open(QFile::ReadOnly))
             {
-                QByteArray data = file.readAll();
-                if (data.length() > 0)
+                qint64 size = file.size();
+                file.close();
+                if (size > 0)
                 {
-                    m_serialThread->write(data);
+                    m_serialThread->writeFile(fileName);
                 }
                 else
                 {
-                    QMessageBox::critical(this, tr("Cannot read file"), file.errorString());
+                    QMessageBox::critical(this, tr("Cannot read file"), tr("File is empty."));
                 }
-                file.close();
             }
             else
             {
@@ -795,6 +987,38 @@ void MainWindow::on_actionSend_file_triggered()
     }
 }
 
+void MainWindow::on_actionReplay_session_triggered()
+{
+    if (m_serialThread->isOpen())
+    {
+        QMessageBox::warning(this, tr("Cannot replay session"), tr("Cannot replay session while serial port is opened."));
+        return;
+    }
+    QSettings settings;
+    QString dir = settings.value ("console/replayDir").toString();
+    QString fileName = QFileDialog::getOpenFileName(this, tr("Replay session"), dir,
+                                                    tr("Captures (*.iscap);;Log files (*.log *.txt);;All files (*.*)"));
+    if (fileName.length())
+    {
+        QFileInfo fileInfo (fileName);
+        settings.setValue("console/replayDir", fileInfo.absolutePath());
+
+        QStringList speeds;
+        speeds << tr("Original speed") << tr("2x") << tr("10x") << tr("100x") << tr("As fast as possible");
+        bool ok;
+        int speedIdx = settings.value("console/replaySpeed", 0).toInt();
+        QString speedStr = QInputDialog::getItem(this, tr("Replay session"), tr("Speed:"), speeds,
+                                                 qBound(0, speedIdx, speeds.size() - 1), false, &ok);
+        if (ok)
+        {
+            const double speedFactors[] = { 1.0, 2.0, 10.0, 100.0, 0.0 };
+            speedIdx = speeds.indexOf(speedStr);
+            settings.setValue("console/replaySpeed", speedIdx);
+            m_serialThread->replay(fileName, speedFactors[qMax(speedIdx, 0)]);
+        }
+    }
+}
+
 void MainWindow::on_actionSave_file_triggered()
 {
     QSettings settings;
@@ -849,7 +1073,7 @@ void MainWindow::on_actionSend_custom_text_1_triggered()
         m_serialThread->write(text.toLocal8Bit(), m_console->getLineEndingTx());
         if (ui->actionLocal_echo->isChecked())
         {
-            m_console->putData(text.toLocal8Bit());
+            m_console->putData(text.toLocal8Bit(), -1, ConsoleDataStore::DIRECTION_tx);
         }
     }
 }
@@ -864,7 +1088,7 @@ void MainWindow::on_actionSend_custom_text_2_triggered()
         m_serialThread->write(text.toLocal8Bit(), m_console->getLineEndingTx());
         if (ui->actionLocal_echo->isChecked())
         {
-            m_console->putData(text.toLocal8Bit());
+            m_console->putData(text.toLocal8Bit(), -1, ConsoleDataStore::DIRECTION_tx);
         }
     }
 }
@@ -879,7 +1103,7 @@ void MainWindow::on_actionSend_custom_text_3_triggered()
         m_serialThread->write(text.toLocal8Bit(), m_console->getLineEndingTx());
         if (ui->actionLocal_echo->isChecked())
         {
-            m_console->putData(text.toLocal8Bit());
+            m_console->putData(text.toLocal8Bit(), -1, ConsoleDataStore::DIRECTION_tx);
         }
     }
 }
@@ -894,7 +1118,7 @@ void MainWindow::on_actionSend_custom_text_4_triggered()
         m_serialThread->write(text.toLocal8Bit(), m_console->getLineEndingTx());
         if (ui->actionLocal_echo->isChecked())
         {
-            m_console->putData(text.toLocal8Bit());
+            m_console->putData(text.toLocal8Bit(), -1, ConsoleDataStore::DIRECTION_tx);
         }
     }
 }
@@ -909,7 +1133,7 @@ void MainWindow::on_actionSend_custom_text_5_triggered()
         m_serialThread->write(text.toLocal8Bit(), m_console->getLineEndingTx());
         if (ui->actionLocal_echo->isChecked())
         {
-            m_console->putData(text.toLocal8Bit());
+            m_console->putData(text.toLocal8Bit(), -1, ConsoleDataStore::DIRECTION_tx);
         }
     }
 }
@@ -924,7 +1148,7 @@ void MainWindow::on_actionSend_custom_text_6_triggered()
         m_serialThread->write(text.toLocal8Bit(), m_console->getLineEndingTx());
         if (ui->actionLocal_echo->isChecked())
         {
-            m_console->putData(text.toLocal8Bit());
+            m_console->putData(text.toLocal8Bit(), -1, ConsoleDataStore::DIRECTION_tx);
         }
     }
 }
@@ -998,15 +1222,26 @@ void MainWindow::saveHistory(Multistring::mode_t mode, const QStringList &histor
 
 void MainWindow::on_actionConfigure_triggered()
 {
-    SettingsDialog * serialSettingsDialog = new SettingsDialog(0, &m_currentSerialSettings);
+    QString portName = m_currentSerialSettings->m_serialSettings.name;
+    SettingsDialog * serialSettingsDialog = new SettingsDialog(0, m_currentSerialSettings);
     int result = serialSettingsDialog->exec();
     qDebug() << __PRETTY_FUNCTION__ << result;
 
+    updateSessionTitle(m_currentSession);
+
     if ((result == SettingsDialog::Accepted) && (m_serialThread->isOpen()))
     {
-        // Reopen port
-        m_serialThread->close();
-        openSerialPort();
+        if (m_currentSerialSettings->m_serialSettings.name == portName)
+        {
+            // Same port: change parameters without reopening it
+            m_serialThread->reconfigure();
+        }
+        else
+        {
+            // Reopen port
+            m_serialThread->close();
+            openSerialPort();
+        }
     }
 
     delete serialSettingsDialog;
@@ -1014,7 +1249,10 @@ void MainWindow::on_actionConfigure_triggered()
 
 void MainWindow::on_actionShow_timestamp_triggered(bool checked)
 {
-    m_console->setDisplayTimestampEnabled(checked);
+    foreach (session_t *session, m_sessions)
+    {
+        session->console->setDisplayTimestampEnabled(checked);
+    }
 }
 
 void MainWindow::on_actionSet_timestamp_color_triggered()
@@ -1027,8 +1265,12 @@ void MainWindow::on_actionSet_timestamp_color_triggered()
     {
         QSettings settings;
         settings.setValue("console/timestampcolor", color.name(QColor::HexArgb));
-        palette.setColor(QPalette::Dark, color);
-        m_console->setPalette(palette);
+        foreach (session_t *session, m_sessions)
+        {
+            palette = session->console->palette();
+            palette.setColor(QPalette::Dark, color);
+            session->console->setPalette(palette);
+        }
     }
 }
 
@@ -1044,78 +1286,11 @@ void MainWindow::find(QString searchStr, bool caseSens, bool wholeWords, bool re
         regEx = settings.value("find/regEx", false).toBool();
     }
 
-    QTextDocument * document = m_console->document();
-    QTextCursor highlightCursor(document);
-#if 0
-    QTextCursor cursor(document);
-    cursor.beginEditBlock();
-#endif
-
-    if (m_console->textCursor().hasSelection())
-    {
-        highlightCursor = m_console->textCursor();
-    }
-
-    QTextDocument::FindFlags flags;
-    if (wholeWords)
-    {
-        flags |= QTextDocument::FindWholeWords;
-    }
-    if (caseSens)
-    {
-        flags |= QTextDocument::FindCaseSensitively;
-    }
-
-    if (regEx)
-    {
-        QRegExp searchRegEx(searchStr);
-        searchRegEx.setPatternSyntax(QRegExp::RegExp);
-        if (caseSens)
-        {
-            searchRegEx.setCaseSensitivity(Qt::CaseSensitive);
-        }
-        else
-        {
-            searchRegEx.setCaseSensitivity(Qt::CaseInsensitive);
-        }
-        highlightCursor = document->find(searchRegEx, highlightCursor, flags);
-    }
-    else
-    {
-        highlightCursor = document->find(searchStr, highlightCursor, flags);
-    }
-
-    if (!highlightCursor.isNull())
-    {
-//        highlightCursor.movePosition(QTextCursor::NextCharacter,
-//                                     QTextCursor::KeepAnchor,
-//                                     searchStr.length());
-        highlightCursor.select(QTextCursor::WordUnderCursor);
-        qDebug() << "selected: " << highlightCursor.selectedText();
-        m_console->setTextCursor(highlightCursor);
-    }
-    else
+    if (!m_console->find(searchStr, caseSens, wholeWords, regEx))
     {
         QMessageBox::information(this, tr("Text not found"),
                                  "The text cannot be found.");
     }
-
-#if 0
-    while (!highlightCursor.isNull() && !highlightCursor.atEnd())
-    {
-        highlightCursor = document->find(searchString, highlightCursor, flags);
-
-        if (!highlightCursor.isNull())
-        {
-            highlightCursor.movePosition(QTextCursor::WordRight,
-                                         QTextCursor::KeepAnchor);
-            highlightCursor.mergeCharFormat(colorFormat);
-            found = true;
-        }
-    }
-
-    cursor.endEditBlock();
-#endif
 }
 
 void MainWindow::on_actionFind_triggered()
@@ -1162,7 +1337,8 @@ void MainWindow::on_actionSelectProfile_triggered()
         /* Change back '/' to 0x7F for reading the settings */
         profileName.replace(SEP_CHAR, REPL_CHAR);
 
-        m_currentSerialSettings.loadSettings(profileName);
+        m_currentSerialSettings->loadSettings(profileName);
+        updateSessionTitle(m_currentSession);
         if (m_serialThread->isOpen())
         {
             /* Post has already opened, re-open with the new settings */
@@ -1171,3 +1347,193 @@ void MainWindow::on_actionSelectProfile_triggered()
         }
     }
 }
+
+void MainWindow::on_actionClear_triggered()
+{
+    m_console->clear();
+}
+
+/**
+ * @brief MainWindow::createSession
+ * Creates a tab with its own console, port settings and serial thread. All
+ * ports are served by one I/O thread, so sessions are cheap.
+ *
+ * @return The new session.
+ */
+MainWindow::session_t *MainWindow::createSession()
+{
+    QSettings settings;
+    session_t *session = new session_t;
+    Console *console = new Console;
+    SerialThread *serialThread;
+
+    session->serialSettings = new SerialSettings(this);
+    session->serialSettings->loadSettings();
+    session->serialError = false;
+    session->pinoutSignals = QSerialPort::NoSignal;
+
+    console->setReadOnly(true);
+    console->setLocalEchoEnabled(ui->actionLocal_echo->isChecked());
+    console->setDisplayTimestampEnabled(ui->actionShow_timestamp->isChecked());
+    console->setAutoWrapColumn (settings.value("serial/autoWrapColumn", console->getAutoWrapColumn()).toInt ());
+    console->setLineEndingRx (settings.value("serial/lineEndingRx", console->getLineEndingRx ()).toString ());
+    console->setLineEndingTx (settings.value("serial/lineEndingTx", console->getLineEndingTx ()).toString ());
+    console->setDataSizeLimit (settings.value("serial/dataSizeLimit", console->getDataSizeLimit ()).toInt ());
+    console->setDisplaySize (settings.value("serial/displaySize", console->getDisplaySize ()).toInt ());
+    console->setHexWrap (settings.value("serial/hexWrap", console->getHexWrap ()).toInt ());
+    console->setTimestampFormatString(settings.value("console/timestampFormatString", console->getTimestampFormatString()).toString());
+    session->console = console;
+
+    serialThread = new SerialThread(NULL, session->serialSettings);
+    serialThread->setDelayAfterBytes_ms (settings.value ("serial/delayAfterBytes_ms", serialThread->getDelayAfterBytes_ms ()).toInt());
+    serialThread->setDelayAfterChr_ms(settings.value ("serial/delayAfterNewline_ms", serialThread->getDelayAfterChr_ms()).toInt(),
+                                      console->getLineEndingTx().right(1).toLatin1());
+    serialThread->setDelayAfterBytes_us (settings.value ("serial/delayAfterBytes_us", serialThread->getDelayAfterBytes_us ()).toInt());
+    serialThread->setDelayAfterChr_us (settings.value ("serial/delayAfterNewline_us", serialThread->getDelayAfterChr_us ()).toInt());
+    serialThread->setLineEndingRx(console->getLineEndingRx());
+    serialThread->setLineEndingTx(console->getLineEndingTx());
+    session->serialThread = serialThread;
+
+    MY_ASSERT(connect(serialThread, SIGNAL(message(QString,bool)), this, SLOT(serialMessage(QString,bool))));
+    MY_ASSERT(connect(serialThread, SIGNAL(portStatusChanged(bool)), this, SLOT(serialPortStatusChanged(bool))));
+    MY_ASSERT(connect(serialThread, SIGNAL(error(QSerialPort::SerialPortError)), this,
+            SLOT(handleError(QSerialPort::SerialPortError))));
+    /* Received data is delivered at most once per display frame */
+    QScreen *screen = QGuiApplication::primaryScreen();
+    if (screen && screen->refreshRate() >= 1.0)
+    {
+        serialThread->setReadyReadInterval_us(static_cast<qint64>(1000000.0 / screen->refreshRate()));
+    }
+    MY_ASSERT(connect(serialThread, SIGNAL(readyRead()), this, SLOT(readData())));
+    MY_ASSERT(connect(serialThread, SIGNAL(progress(QString,int)), this, SLOT(serialProgress(QString,int))));
+    MY_ASSERT(connect(serialThread, SIGNAL(finish()), this, SLOT(serialFinish())));
+    MY_ASSERT(connect(serialThread, SIGNAL(pinoutSignalsChanged(QSerialPort::PinoutSignals)),
+                      this, SLOT(serialPinoutsChanged(QSerialPort::PinoutSignals))));
+    MY_ASSERT(connect(console, SIGNAL(getData(QByteArray)), this, SLOT(writeData(QByteArray))));
+    serialThread->startIo(QThread::NormalPriority);
+
+    /* Session shall be known when tab widget reports the new tab */
+    m_sessions.append(session);
+    m_tabWidget->addTab(console, session->serialSettings->m_serialSettings.name);
+    updateBackgroundColor(session);
+
+    return session;
+}
+
+/**
+ * @brief MainWindow::findSession
+ * @param object Serial thread or console of a session.
+ * @return Session of the object, NULL if object does not belong to a session.
+ */
+MainWindow::session_t *MainWindow::findSession(QObject *object)
+{
+    foreach (session_t *session, m_sessions)
+    {
+        if (object == session->serialThread || object == session->console)
+        {
+            return session;
+        }
+    }
+    return NULL;
+}
+
+/**
+ * @brief MainWindow::setCurrentSession
+ * Menus, send line and status labels work on the current session.
+ */
+void MainWindow::setCurrentSession(session_t *session)
+{
+    bool opened;
+
+    if (!session)
+    {
+        return;
+    }
+    m_currentSession = session;
+    m_console = session->console;
+    m_serialThread = session->serialThread;
+    m_currentSerialSettings = session->serialSettings;
+
+    opened = m_serialThread->isOpen();
+    setEnableConsole(opened);
+    if (opened)
+    {
+        showPinoutSignals(session->pinoutSignals);
+    }
+    ui->actionStop_update->setChecked(!m_console->isUpdateEnabled());
+    ui->actionHexadecimal_view->setChecked(m_console->isDisplayHexValuesEnabled());
+    updateWindowTitle();
+    resetPerformance();
+}
+
+void MainWindow::updateSessionTitle(session_t *session)
+{
+    int index = m_tabWidget->indexOf(session->console);
+
+    if (index >= 0)
+    {
+        m_tabWidget->setTabText(index, session->serialSettings->m_serialSettings.name);
+        m_tabWidget->setTabToolTip(index, session->serialSettings->toString());
+    }
+}
+
+void MainWindow::updateWindowTitle()
+{
+    if (m_serialThread->isOpen())
+    {
+        QString title = QString("%1 - %2, %3, %4%5%6, %7").arg(VER_PRODUCTNAME_STR).arg(m_serialThread->portName())
+                .arg(m_serialThread->baudRate()).arg(m_serialThread->dataBits()).arg(m_serialThread->parityStr()[0]).arg(m_serialThread->stopBits())
+                .arg(m_serialThread->flowControlStr());
+        setWindowTitle(title);
+    }
+    else
+    {
+        setWindowTitle(VER_PRODUCTNAME_STR);
+    }
+}
+
+void MainWindow::currentSessionChanged(int index)
+{
+    setCurrentSession(findSession(m_tabWidget->widget(index)));
+}
+
+/**
+ * @brief MainWindow::closeSession
+ * Closes port and tab of a session. The last session cannot be closed.
+ *
+ * @param index Index of tab.
+ */
+void MainWindow::closeSession(int index)
+{
+    session_t *session = findSession(m_tabWidget->widget(index));
+
+    if (!session || m_sessions.size() <= 1)
+    {
+        return;
+    }
+    if (session == m_progressSession)
+    {
+        m_progressSession = NULL;
+        m_progressBar->hide();
+        m_abortButton->hide();
+    }
+    session->serialThread->stop(250);
+    delete session->serialThread;
+    /* Tab widget selects another session */
+    m_sessions.removeOne(session);
+    m_tabWidget->removeTab(index);
+    delete session->console;
+    delete session->serialSettings;
+    delete session;
+}
+
+void MainWindow::on_actionNew_session_triggered()
+{
+    session_t *session = createSession();
+    m_tabWidget->setCurrentWidget(session->console);
+}
+
+void MainWindow::on_actionClose_session_triggered()
+{
+    closeSession(m_tabWidget->currentIndex());
+}
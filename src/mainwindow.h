@@ -44,7 +44,10 @@
 #include <QPushButton>
 #include <QtSerialPort/QSerialPort>
 #include <QProgressBar>
+#include <QLabel>
 #include <QTimer>
+#include <QElapsedTimer>
+#include <QList>
 
 #include "multistring.h"
 #include "multivalidator.h"
@@ -52,12 +55,6 @@
 #include "settingsdialog.h"
 #include "common.h"
 
-#if WINDOWS
-#define USE_UPDATE_TIMER    1
-#else
-#define USE_UPDATE_TIMER    0
-#endif
-
 QT_BEGIN_NAMESPACE
 
 namespace Ui {
@@ -69,6 +66,7 @@ QT_END_NAMESPACE
 class Console;
 class SettingsDialog;
 class SerialThread;
+class QTabWidget;
 
 class MainWindow : public QMainWindow
 {
@@ -98,6 +96,9 @@ private slots:
     void serialMessage(QString message, bool error);
     void serialPortStatusChanged(bool opened);
     void handleError(QSerialPort::SerialPortError error);
+    void abortSend();
+    void currentSessionChanged(int index);
+    void closeSession(int index);
 
     void on_actionLocal_echo_triggered(bool checked);
     void on_actionSet_font_triggered();
@@ -117,6 +118,7 @@ private slots:
 
     void on_actionSend_file_triggered();
     void on_actionSave_file_triggered();
+    void on_actionReplay_session_triggered();
     void on_actionToggle_DTR_triggered();
     void on_actionToggle_RTS_triggered();
     void on_actionSend_custom_text_1_triggered();
@@ -145,22 +147,54 @@ private slots:
 
     void on_actionSelectProfile_triggered();
 
+    void on_actionClear_triggered();
+    void on_actionNew_session_triggered();
+    void on_actionClose_session_triggered();
+    void on_actionShow_performance_triggered(bool checked);
+    void updatePerformance();
+
 private:
+    /** Port of a tab with its own console and settings. */
+    typedef struct
+    {
+        Console *console;
+        SerialSettings *serialSettings;
+        SerialThread *serialThread;
+        bool serialError;
+        QSerialPort::PinoutSignals pinoutSignals;
+    } session_t;
+
+    session_t *createSession();
+    session_t *findSession(QObject *object);
+    void setCurrentSession(session_t *session);
+    void readSessionData(session_t *session);
+    void updateSessionTitle(session_t *session);
+    void updateWindowTitle();
+    void updateBackgroundColor(session_t *session);
+    void showPinoutSignals(QSerialPort::PinoutSignals pinoutSignals);
+    void resetPerformance();
+
     Ui::MainWindow *ui;
+    QTabWidget *m_tabWidget;
+    QList<session_t *> m_sessions;
+    session_t *m_currentSession;
+    session_t *m_progressSession;   /**< Session which shows progress, abort button stops it. */
+    /* Members of current session */
     Console *m_console;
-    SerialSettings m_currentSerialSettings;
+    SerialSettings *m_currentSerialSettings;
     SerialThread *m_serialThread;
-    bool m_serialError;
     QProgressBar *m_progressBar;
     QPushButton *m_abortButton;
+    QLabel *m_performanceLabel;         /**< Live throughput and console cost of current session */
+    QTimer m_performanceTimer;
+    QElapsedTimer m_performanceElapsedTimer;    /**< Time since previous sample */
+    quint64 m_performanceBytesReceived; /**< Counters of previous sample */
+    quint64 m_performanceBytesSent;
     QVector<QString> m_customTexts;
     QVector<bool> m_customTextsEnabled;
     Multistring m_sendLine;
     MultiValidator * m_multivalidator;
     QStringList m_sendLineHistories[4]; /**< History for following modes: ASCII, hexadecimal, decimal, binary */
-#if USE_UPDATE_TIMER
-    QTimer      m_updateTimer;          /**< Console update timer */
-#endif
 };
 
 #endif // MAINWINDOW_H
@@ -0,0 +1,283 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QMutexLocker>
+#include <QDebug>
+
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#include <signal.h>
+#include <unistd.h>
+#include <errno.h>
+#include <string.h>
+#include <time.h>
+
+#include "modemlinewatcher.h"
+
+/**
+ * @brief interruptHandler
+ * Does nothing, the signal is only used to interrupt TIOCMIWAIT.
+ */
+static void interruptHandler(int signum)
+{
+    Q_UNUSED(signum);
+}
+
+static bool installInterruptHandler()
+{
+    struct sigaction action;
+
+    memset(&action, 0, sizeof(action));
+    action.sa_handler = interruptHandler;
+    sigemptyset(&action.sa_mask);
+    /* No SA_RESTART, so TIOCMIWAIT returns with EINTR */
+    if (sigaction(SIGRTMIN, &action, NULL) < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot install signal handler:" << strerror(errno);
+        return false;
+    }
+    return true;
+}
+
+ModemLineWatcher::ModemLineWatcher(QObject *parent)
+    : QThread(parent)
+    , m_portFd(-1)
+    , m_notifyFd(-1)
+    , m_running(false)
+    , m_threadStarted(false)
+{
+    memset(m_counters, 0, sizeof(m_counters));
+}
+
+ModemLineWatcher::~ModemLineWatcher()
+{
+    stopWatching();
+}
+
+/**
+ * @brief ModemLineWatcher::startWatching
+ * Starts the watcher thread if the port supports line change interrupts.
+ *
+ * @param portFd Descriptor of opened port.
+ * @param notifyFd eventfd to write when an event is queued.
+ * @return false: port does not count line changes, it shall be polled.
+ */
+bool ModemLineWatcher::startWatching(int portFd, int notifyFd)
+{
+    static const bool handlerInstalled = installInterruptHandler();
+
+    stopWatching();
+    if (!handlerInstalled || portFd < 0)
+    {
+        return false;
+    }
+    m_portFd = portFd;
+    if (!readCounters(m_counters))
+    {
+        /* Pseudo-terminal or driver without TIOCGICOUNT */
+        m_portFd = -1;
+        return false;
+    }
+    m_notifyFd = notifyFd;
+    m_running = true;
+    m_threadStarted = false;
+    start(QThread::HighPriority);
+    return true;
+}
+
+/**
+ * @brief ModemLineWatcher::stopWatching
+ * Stops the watcher thread. It shall be called before the port is closed.
+ * Queued events are dropped.
+ */
+void ModemLineWatcher::stopWatching()
+{
+    if (m_portFd < 0)
+    {
+        return;
+    }
+    m_running = false;
+    /* Signal may arrive just before TIOCMIWAIT is entered, so it is repeated */
+    while (!wait(1))
+    {
+        if (m_threadStarted)
+        {
+            pthread_kill(m_thread, SIGRTMIN);
+        }
+    }
+    m_portFd = -1;
+    QMutexLocker mutexLocker(&m_mutex);
+    m_events.clear();
+}
+
+bool ModemLineWatcher::isWatching() const
+{
+    return m_portFd >= 0 && m_running;
+}
+
+/**
+ * @brief ModemLineWatcher::takeEvent
+ * Removes the oldest queued event.
+ *
+ * @return false: no event.
+ */
+bool ModemLineWatcher::takeEvent(ModemLineWatcher::lineEvent_t *event)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    if (m_events.isEmpty())
+    {
+        return false;
+    }
+    *event = m_events.takeFirst();
+    return true;
+}
+
+void ModemLineWatcher::run()
+{
+    const int mask = TIOCM_CTS | TIOCM_DSR | TIOCM_CD | TIOCM_RNG;
+
+    m_thread = pthread_self();
+    m_threadStarted = true;
+    while (m_running)
+    {
+        if (ioctl(m_portFd, TIOCMIWAIT, mask) < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (m_running)
+            {
+                qCritical() << __PRETTY_FUNCTION__ << "TIOCMIWAIT failed:" << strerror(errno);
+            }
+            break;
+        }
+
+        lineEvent_t event;
+        quint32 counters[4];
+        struct timespec ts;
+        clock_gettime(CLOCK_MONOTONIC, &ts);
+        event.monotonic_ns = static_cast<qint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+        if (!readCounters(counters))
+        {
+            break;
+        }
+        event.pinoutSignals = readPinoutSignals();
+        /* Counters wrap around, unsigned difference is still correct */
+        event.ctsEdges = counters[0] - m_counters[0];
+        event.dsrEdges = counters[1] - m_counters[1];
+        event.dcdEdges = counters[2] - m_counters[2];
+        event.riEdges = counters[3] - m_counters[3];
+        memcpy(m_counters, counters, sizeof(m_counters));
+        queueEvent(event);
+    }
+    if (m_running)
+    {
+        /* Port failed, owner shall poll lines */
+        m_running = false;
+        notify();
+    }
+}
+
+/**
+ * @brief ModemLineWatcher::readCounters
+ * Reads edge counters of driver.
+ *
+ * @param counters CTS, DSR, DCD and RI edges since port was opened.
+ * @return false: not supported by driver.
+ */
+bool ModemLineWatcher::readCounters(quint32 counters[4])
+{
+    struct serial_icounter_struct icount;
+
+    if (ioctl(m_portFd, TIOCGICOUNT, &icount) < 0)
+    {
+        return false;
+    }
+    counters[0] = static_cast<quint32>(icount.cts);
+    counters[1] = static_cast<quint32>(icount.dsr);
+    counters[2] = static_cast<quint32>(icount.dcd);
+    counters[3] = static_cast<quint32>(icount.rng);
+    return true;
+}
+
+QSerialPort::PinoutSignals ModemLineWatcher::readPinoutSignals()
+{
+    QSerialPort::PinoutSignals pinoutSignals = QSerialPort::NoSignal;
+    int bits = 0;
+
+    if (ioctl(m_portFd, TIOCMGET, &bits) < 0)
+    {
+        return pinoutSignals;
+    }
+    if (bits & TIOCM_DTR)
+    {
+        pinoutSignals |= QSerialPort::DataTerminalReadySignal;
+    }
+    if (bits & TIOCM_RTS)
+    {
+        pinoutSignals |= QSerialPort::RequestToSendSignal;
+    }
+    if (bits & TIOCM_CTS)
+    {
+        pinoutSignals |= QSerialPort::ClearToSendSignal;
+    }
+    if (bits & TIOCM_DSR)
+    {
+        pinoutSignals |= QSerialPort::DataSetReadySignal;
+    }
+    if (bits & TIOCM_CD)
+    {
+        pinoutSignals |= QSerialPort::DataCarrierDetectSignal;
+    }
+    if (bits & TIOCM_RNG)
+    {
+        pinoutSignals |= QSerialPort::RingIndicatorSignal;
+    }
+    return pinoutSignals;
+}
+
+/**
+ * @brief ModemLineWatcher::queueEvent
+ * Queues event and notifies the owner. If the owner is far behind, the
+ * event is merged into the last one.
+ */
+void ModemLineWatcher::queueEvent(const ModemLineWatcher::lineEvent_t &event)
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    bool wasEmpty = m_events.isEmpty();
+
+    if (m_events.size() >= maxQueuedEvents)
+    {
+        lineEvent_t &last = m_events.last();
+        last.monotonic_ns = event.monotonic_ns;
+        last.pinoutSignals = event.pinoutSignals;
+        last.ctsEdges += event.ctsEdges;
+        last.dsrEdges += event.dsrEdges;
+        last.dcdEdges += event.dcdEdges;
+        last.riEdges += event.riEdges;
+    }
+    else
+    {
+        m_events.append(event);
+    }
+    mutexLocker.unlock();
+    if (wasEmpty)
+    {
+        notify();
+    }
+}
+
+void ModemLineWatcher::notify()
+{
+    quint64 one = 1;
+
+    if (m_notifyFd >= 0 && ::write(m_notifyFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot notify owner:" << strerror(errno);
+    }
+}
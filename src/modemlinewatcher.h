@@ -0,0 +1,75 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef MODEMLINEWATCHER_H
+#define MODEMLINEWATCHER_H
+
+#include <QThread>
+#include <QMutex>
+#include <QList>
+#include <QSerialPort>
+
+#include <atomic>
+
+#include <pthread.h>
+
+/**
+ * @brief The ModemLineWatcher class
+ * Waits for changes of modem input lines (CTS, DSR, DCD, RI) in TIOCMIWAIT
+ * on its own thread, so lines are not polled. Edges are counted by the
+ * driver (TIOCGICOUNT), so pulses shorter than the wake up latency are not
+ * lost either. Events are queued and the owner is notified by writing its
+ * eventfd, also when watching stops because the port failed. Works on real
+ * serial ports only, pseudo-terminals do not support these ioctls.
+ */
+class ModemLineWatcher : public QThread
+{
+    Q_OBJECT
+public:
+    /** Change of modem lines. */
+    typedef struct
+    {
+        qint64 monotonic_ns;    /**< CLOCK_MONOTONIC time when change was noticed. */
+        QSerialPort::PinoutSignals pinoutSignals;   /**< State after the change. */
+        quint32 ctsEdges;       /**< Number of edges since previous event. */
+        quint32 dsrEdges;
+        quint32 dcdEdges;
+        quint32 riEdges;
+    } lineEvent_t;
+
+    explicit ModemLineWatcher(QObject *parent = 0);
+    ~ModemLineWatcher();
+
+    bool startWatching(int portFd, int notifyFd);
+    void stopWatching();
+    bool isWatching() const;
+    bool takeEvent(lineEvent_t *event);
+
+protected:
+    void run();
+
+private:
+    Q_DISABLE_COPY(ModemLineWatcher)
+
+    /** Above this many queued events new changes are merged into the last one. */
+    static const int maxQueuedEvents = 256;
+
+    bool readCounters(quint32 counters[4]);
+    QSerialPort::PinoutSignals readPinoutSignals();
+    void queueEvent(const lineEvent_t &event);
+    void notify();
+
+    int m_portFd;               /**< Port being watched, -1 if not watching. */
+    int m_notifyFd;             /**< eventfd of owner, written when an event is queued. */
+    std::atomic<bool> m_running;
+    std::atomic<bool> m_threadStarted;  /**< m_thread is valid. */
+    pthread_t m_thread;         /**< Used to interrupt TIOCMIWAIT with a signal. */
+    quint32 m_counters[4];      /**< Edge counters of driver at last event: CTS, DSR, DCD, RI. */
+    QMutex m_mutex;             /**< Protects m_events. */
+    QList<lineEvent_t> m_events;
+};
+
+#endif // MODEMLINEWATCHER_H
@@ -0,0 +1,111 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include "common.h"
+#include "portbackend.h"
+#include "serialportbackend.h"
+#if LINUX
+#include "ptyportbackend.h"
+#include "simulatedportbackend.h"
+#endif
+
+PortBackend::PortBackend(QObject *parent)
+    : QObject(parent)
+{
+}
+
+PortBackend::~PortBackend()
+{
+}
+
+/**
+ * @brief PortBackend::create
+ * Creates backend according to port name:
+ *  - "pty": pseudo-terminal,
+ *  - "sim:...": simulated device, see SimulatedPortBackend,
+ *  - otherwise: serial port.
+ *
+ * @param portName Name of port.
+ * @param parent Parent of backend.
+ * @return New backend, port name is already set.
+ */
+PortBackend *PortBackend::create(const QString &portName, QObject *parent)
+{
+    PortBackend *backend;
+
+#if LINUX
+    if (portName == "pty")
+    {
+        backend = new PtyPortBackend(parent);
+    }
+    else if (portName.startsWith("sim:"))
+    {
+        backend = new SimulatedPortBackend(parent);
+    }
+    else
+#endif
+    {
+        backend = new SerialPortBackend(parent);
+    }
+    backend->setPortName(portName);
+    return backend;
+}
+
+/**
+ * @brief PortBackend::virtualPortNames
+ * @return Virtual ports offered besides serial ports of the system.
+ */
+QStringList PortBackend::virtualPortNames()
+{
+    QStringList names;
+#if LINUX
+    names << "pty" << "sim:echo" << "sim:gen:11520" << "sim:gen:0";
+#endif
+    return names;
+}
+
+QString PortBackend::virtualPortDescription(const QString &portName)
+{
+#if LINUX
+    if (portName == "pty")
+    {
+        return tr("Pseudo-terminal");
+    }
+    if (portName.startsWith("sim:"))
+    {
+        return SimulatedPortBackend::description(portName);
+    }
+#else
+    Q_UNUSED(portName);
+#endif
+    return QString();
+}
+
+QString PortBackend::description() const
+{
+    return portName();
+}
+
+/**
+ * @brief PortBackend::setLowLatency
+ * Reduces buffering latency of the device. Virtual ports have no latency.
+ *
+ * @return false: not supported.
+ */
+bool PortBackend::setLowLatency(bool enable)
+{
+    Q_UNUSED(enable);
+    return false;
+}
+
+/**
+ * @brief PortBackend::latencyTimer_ms
+ * @return Latency timer of USB adapter, -1 if unknown.
+ */
+int PortBackend::latencyTimer_ms() const
+{
+    return -1;
+}
@@ -0,0 +1,76 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef PORTBACKEND_H
+#define PORTBACKEND_H
+
+#include <QObject>
+#include <QByteArray>
+#include <QString>
+#include <QStringList>
+#include <QSerialPort>
+
+/**
+ * @brief The PortBackend class
+ * Device used by SerialThread. Its interface follows QSerialPort, so a real
+ * serial port, a pseudo-terminal or a simulated device can be used the same
+ * way. Backend is selected by the port name, see create().
+ */
+class PortBackend : public QObject
+{
+    Q_OBJECT
+public:
+    explicit PortBackend(QObject *parent = 0);
+    virtual ~PortBackend();
+
+    static PortBackend *create(const QString &portName, QObject *parent = 0);
+    static QStringList virtualPortNames();
+    static QString virtualPortDescription(const QString &portName);
+
+    virtual bool open(QIODevice::OpenMode mode) = 0;
+    virtual void close() = 0;
+    virtual bool isOpen() const = 0;
+    virtual bool isWritable() const = 0;
+    /** File descriptor which can be polled and read/written directly, -1 if there is no such. */
+    virtual int handle() const = 0;
+
+    virtual QString portName() const = 0;
+    virtual void setPortName(const QString &name) = 0;
+    virtual QString description() const;
+    virtual QString errorString() const = 0;
+
+    virtual qint64 bytesAvailable() const = 0;
+    virtual qint64 bytesToWrite() const = 0;
+    virtual QByteArray read(qint64 maxLen) = 0;
+    virtual qint64 write(const char *data, qint64 len) = 0;
+    virtual bool waitForReadyRead(int msecs) = 0;
+    virtual bool waitForBytesWritten(int msecs) = 0;
+
+    virtual bool setBaudRate(qint32 baudRate, QSerialPort::Directions directions = QSerialPort::AllDirections) = 0;
+    virtual qint32 baudRate(QSerialPort::Directions directions = QSerialPort::AllDirections) const = 0;
+    virtual bool setDataBits(QSerialPort::DataBits dataBits) = 0;
+    virtual QSerialPort::DataBits dataBits() const = 0;
+    virtual bool setParity(QSerialPort::Parity parity) = 0;
+    virtual QSerialPort::Parity parity() const = 0;
+    virtual bool setStopBits(QSerialPort::StopBits stopBits) = 0;
+    virtual QSerialPort::StopBits stopBits() const = 0;
+    virtual bool setFlowControl(QSerialPort::FlowControl flowControl) = 0;
+    virtual QSerialPort::FlowControl flowControl() const = 0;
+
+    virtual bool setDataTerminalReady(bool set) = 0;
+    virtual bool isDataTerminalReady() = 0;
+    virtual bool setRequestToSend(bool set) = 0;
+    virtual bool isRequestToSend() = 0;
+    virtual QSerialPort::PinoutSignals pinoutSignals() = 0;
+
+    virtual bool setLowLatency(bool enable);
+    virtual int latencyTimer_ms() const;
+
+signals:
+    void error(QSerialPort::SerialPortError);
+};
+
+#endif // PORTBACKEND_H
@@ -0,0 +1,81 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <pty.h>
+#include <termios.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+
+#include "ptyportbackend.h"
+
+PtyPortBackend::PtyPortBackend(QObject *parent)
+    : FdPortBackend(parent)
+    , m_slaveFd(-1)
+{
+}
+
+PtyPortBackend::~PtyPortBackend()
+{
+    closeDevice();
+}
+
+/**
+ * @brief PtyPortBackend::description
+ * @return Name of slave device which can be opened by other programs.
+ */
+QString PtyPortBackend::description() const
+{
+    if (m_slaveName.isEmpty())
+    {
+        return tr("Pseudo-terminal");
+    }
+    return tr("Pseudo-terminal %1").arg(m_slaveName);
+}
+
+/**
+ * @brief PtyPortBackend::slaveName
+ * @return Slave device (/dev/pts/N), empty if not opened.
+ */
+QString PtyPortBackend::slaveName() const
+{
+    return m_slaveName;
+}
+
+int PtyPortBackend::openDevice()
+{
+    int masterFd = -1;
+    char slaveName[128];
+    struct termios tio;
+
+    if (openpty(&masterFd, &m_slaveFd, slaveName, NULL, NULL) < 0)
+    {
+        setErrorString(tr("Cannot create pseudo-terminal: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        m_slaveFd = -1;
+        return -1;
+    }
+    /* Transparent 8-bit channel without echo and line editing */
+    if (tcgetattr(m_slaveFd, &tio) == 0)
+    {
+        cfmakeraw(&tio);
+        tcsetattr(m_slaveFd, TCSANOW, &tio);
+    }
+    fcntl(masterFd, F_SETFD, FD_CLOEXEC);
+    fcntl(m_slaveFd, F_SETFD, FD_CLOEXEC);
+    m_slaveName = QString::fromLocal8Bit(slaveName);
+    return masterFd;
+}
+
+void PtyPortBackend::closeDevice()
+{
+    if (m_slaveFd >= 0)
+    {
+        ::close(m_slaveFd);
+        m_slaveFd = -1;
+    }
+    m_slaveName.clear();
+}
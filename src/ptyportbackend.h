@@ -0,0 +1,38 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef PTYPORTBACKEND_H
+#define PTYPORTBACKEND_H
+
+#include "fdportbackend.h"
+
+/**
+ * @brief The PtyPortBackend class
+ * Pseudo-terminal: iSerTerm holds the master side, another program can open
+ * the slave device (/dev/pts/N) as if it was a serial port.
+ */
+class PtyPortBackend : public FdPortBackend
+{
+    Q_OBJECT
+public:
+    explicit PtyPortBackend(QObject *parent = 0);
+    ~PtyPortBackend();
+
+    QString description() const;
+    QString slaveName() const;
+
+protected:
+    int openDevice();
+    void closeDevice();
+
+private:
+    Q_DISABLE_COPY(PtyPortBackend)
+
+    int m_slaveFd;          /**< Kept open, so reading master does not fail with EIO when no one uses the slave. */
+    QString m_slaveName;
+};
+
+#endif // PTYPORTBACKEND_H
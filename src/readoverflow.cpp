@@ -0,0 +1,230 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QDir>
+
+#include "readoverflow.h"
+
+ReadOverflow::ReadOverflow()
+    : m_store(STORE_MEMORY)
+    , m_memoryLimit(4 * 1024 * 1024)
+    , m_chunkOffset(0)
+    , m_size(0)
+    , m_file(QDir::tempPath() + "/iserterm-spill-XXXXXX")
+    , m_fileReadPos(0)
+    , m_fileWritePos(0)
+    , m_dropped(0)
+{
+}
+
+ReadOverflow::~ReadOverflow()
+{
+}
+
+ReadOverflow::store_t ReadOverflow::store() const
+{
+    return m_store;
+}
+
+/**
+ * @brief ReadOverflow::setStore
+ * Selects where data is kept. Pending data is dropped if store changes.
+ *
+ * @param store Memory or spill file.
+ * @param memoryLimit Size limit of memory store in bytes.
+ */
+void ReadOverflow::setStore(ReadOverflow::store_t store, qint64 memoryLimit)
+{
+    if (store != m_store)
+    {
+        m_dropped += m_size;
+        clear();
+        m_store = store;
+    }
+    m_memoryLimit = qMax<qint64>(memoryLimit, 1);
+}
+
+bool ReadOverflow::isEmpty() const
+{
+    return m_size == 0;
+}
+
+qint64 ReadOverflow::size() const
+{
+    return m_size;
+}
+
+/**
+ * @brief ReadOverflow::append
+ * Stores a received chunk. Memory store drops the oldest data above its
+ * limit, file store drops the chunk only if the file cannot be written.
+ */
+void ReadOverflow::append(const char *data, qint64 len, qint64 monotonic_ns, qint64 wallClock_ms)
+{
+    if (len <= 0)
+    {
+        return;
+    }
+    if (m_store == STORE_MEMORY)
+    {
+        chunk_t chunk;
+        chunk.data = QByteArray(data, static_cast<int>(len));
+        chunk.monotonic_ns = monotonic_ns;
+        chunk.wallClock_ms = wallClock_ms;
+        m_chunks.append(chunk);
+        m_size += len;
+        if (m_size > m_memoryLimit)
+        {
+            drop(m_size - m_memoryLimit);
+        }
+        return;
+    }
+
+    fileRecord_t record;
+    record.monotonic_ns = monotonic_ns;
+    record.wallClock_ms = wallClock_ms;
+    record.len = len;
+    if ((!m_file.isOpen() && !m_file.open())
+            || !m_file.seek(m_fileWritePos)
+            || m_file.write(reinterpret_cast<const char *>(&record), sizeof(record)) != sizeof(record)
+            || m_file.write(data, len) != len)
+    {
+        m_errorString = m_file.errorString();
+        if (m_file.isOpen())
+        {
+            /* Remove partially written record */
+            m_file.resize(m_fileWritePos);
+        }
+        m_dropped += len;
+        return;
+    }
+    m_fileWritePos += static_cast<qint64>(sizeof(record)) + len;
+    m_size += len;
+}
+
+/**
+ * @brief ReadOverflow::peek
+ * Gets the oldest data without removing it. The data is valid until
+ * consume() or append() is called.
+ *
+ * @return Length of data, 0 if empty.
+ */
+qint64 ReadOverflow::peek(const char **data, qint64 *monotonic_ns, qint64 *wallClock_ms)
+{
+    if (m_chunks.isEmpty() && !readFileChunk())
+    {
+        return 0;
+    }
+    const chunk_t &chunk = m_chunks.first();
+    *data = chunk.data.constData() + m_chunkOffset;
+    *monotonic_ns = chunk.monotonic_ns;
+    *wallClock_ms = chunk.wallClock_ms;
+    return chunk.data.size() - m_chunkOffset;
+}
+
+void ReadOverflow::consume(qint64 len)
+{
+    while (len > 0 && !m_chunks.isEmpty())
+    {
+        qint64 remaining = m_chunks.first().data.size() - m_chunkOffset;
+        if (len < remaining)
+        {
+            m_chunkOffset += len;
+            m_size -= len;
+            return;
+        }
+        m_chunks.removeFirst();
+        m_chunkOffset = 0;
+        m_size -= remaining;
+        len -= remaining;
+    }
+}
+
+void ReadOverflow::clear()
+{
+    m_chunks.clear();
+    m_chunkOffset = 0;
+    m_size = 0;
+    resetFile();
+}
+
+/**
+ * @brief ReadOverflow::takeDroppedBytes
+ * @return Number of bytes dropped since last call.
+ */
+qint64 ReadOverflow::takeDroppedBytes()
+{
+    qint64 dropped = m_dropped;
+    m_dropped = 0;
+    return dropped;
+}
+
+QString ReadOverflow::errorString() const
+{
+    return m_errorString;
+}
+
+/**
+ * @brief ReadOverflow::drop
+ * Removes the oldest data of memory store.
+ */
+void ReadOverflow::drop(qint64 len)
+{
+    qint64 size = m_size;
+    consume(len);
+    m_dropped += size - m_size;
+}
+
+/**
+ * @brief ReadOverflow::readFileChunk
+ * Reads the oldest chunk of spill file to memory. File is truncated when
+ * all chunks are read.
+ *
+ * @return false: no more data.
+ */
+bool ReadOverflow::readFileChunk()
+{
+    fileRecord_t record;
+    chunk_t chunk;
+
+    if (m_store != STORE_FILE || m_fileReadPos >= m_fileWritePos)
+    {
+        return false;
+    }
+    if (!m_file.seek(m_fileReadPos)
+            || m_file.read(reinterpret_cast<char *>(&record), sizeof(record)) != sizeof(record)
+            || record.len <= 0
+            || (chunk.data = m_file.read(record.len)).size() != record.len)
+    {
+        /* Rest of file is lost */
+        m_errorString = m_file.errorString();
+        m_dropped += m_size;
+        m_size = 0;
+        resetFile();
+        return false;
+    }
+    chunk.monotonic_ns = record.monotonic_ns;
+    chunk.wallClock_ms = record.wallClock_ms;
+    m_chunks.append(chunk);
+    m_chunkOffset = 0;
+    m_fileReadPos += static_cast<qint64>(sizeof(record)) + record.len;
+    if (m_fileReadPos >= m_fileWritePos)
+    {
+        /* Chunk in memory is older than anything appended later */
+        resetFile();
+    }
+    return true;
+}
+
+void ReadOverflow::resetFile()
+{
+    if (m_file.isOpen())
+    {
+        m_file.resize(0);
+    }
+    m_fileReadPos = 0;
+    m_fileWritePos = 0;
+}
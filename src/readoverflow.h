@@ -0,0 +1,82 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef READOVERFLOW_H
+#define READOVERFLOW_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QList>
+#include <QString>
+#include <QTemporaryFile>
+
+/**
+ * @brief The ReadOverflow class
+ * Received data which did not fit into the receive buffer, in arrival order.
+ * It is kept in memory up to a limit, dropping the oldest data above it, or
+ * it is spilled to a temporary file without limit. Only one thread may use
+ * it.
+ */
+class ReadOverflow
+{
+public:
+    typedef enum
+    {
+        STORE_MEMORY,
+        STORE_FILE
+    } store_t;
+
+    ReadOverflow();
+    ~ReadOverflow();
+
+    store_t store() const;
+    void setStore(store_t store, qint64 memoryLimit);
+    bool isEmpty() const;
+    qint64 size() const;
+
+    void append(const char *data, qint64 len, qint64 monotonic_ns, qint64 wallClock_ms);
+    qint64 peek(const char **data, qint64 *monotonic_ns, qint64 *wallClock_ms);
+    void consume(qint64 len);
+    void clear();
+
+    qint64 takeDroppedBytes();
+    QString errorString() const;
+
+private:
+    Q_DISABLE_COPY(ReadOverflow)
+
+    typedef struct
+    {
+        QByteArray data;
+        qint64 monotonic_ns;
+        qint64 wallClock_ms;
+    } chunk_t;
+
+    /** Header of a chunk in the spill file, followed by data. */
+    typedef struct
+    {
+        qint64 monotonic_ns;
+        qint64 wallClock_ms;
+        qint64 len;
+    } fileRecord_t;
+
+    void drop(qint64 len);
+    bool readFileChunk();
+    void resetFile();
+
+    store_t m_store;
+    qint64 m_memoryLimit;       /**< Memory store drops the oldest data above this size. */
+    QList<chunk_t> m_chunks;    /**< Oldest first. File store holds only the chunk being consumed here. */
+    qint64 m_chunkOffset;       /**< Consumed bytes of first chunk. */
+    qint64 m_size;              /**< Bytes not consumed yet, including the spill file. */
+    QTemporaryFile m_file;
+    qint64 m_fileReadPos;
+    qint64 m_fileWritePos;
+    qint64 m_dropped;           /**< Dropped since last takeDroppedBytes(). */
+    QString m_errorString;
+};
+
+#endif // READOVERFLOW_H
@@ -0,0 +1,238 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QCoreApplication>
+#include <QDateTime>
+#include <QtEndian>
+#include <QDebug>
+
+#include <string.h>
+
+#include "replaysource.h"
+#include "timestampformatter.h"
+
+/** Milliseconds of a day, to handle midnight in auto-log */
+static const qint64 day_ms = 24 * 60 * 60 * 1000;
+
+/**
+ * @brief logMessagePrefix
+ * Auto-log starts and ends with messages written by SerialThread.
+ *
+ * @param text Message of SerialThread.
+ * @return Text of message before its first argument.
+ */
+static QByteArray logMessagePrefix(const char *text)
+{
+    QString message = QCoreApplication::translate("SerialThread", text);
+    return message.left(message.indexOf("%1")).toLocal8Bit();
+}
+
+ReplaySource::ReplaySource(const QString &fileName)
+    : m_file(fileName)
+    , m_format(FORMAT_raw)
+    , m_baudRate(115200)
+    , m_rawChunkSize(16)
+    , m_rawBytes(0)
+    , m_timestampLength(0)
+    , m_startTime_ms(-1)
+    , m_lastTime_ms(-1)
+    , m_dayOffset_ms(0)
+    , m_startTime_ns(0)
+    , m_startWallClock_ms(-1)
+{
+}
+
+ReplaySource::~ReplaySource()
+{
+    close();
+}
+
+/**
+ * @brief ReplaySource::open
+ * Opens recorded session and detects its format.
+ *
+ * @param baudRate Used to calculate timing of raw byte dump.
+ * @param timestampFormat Format of timestamps in auto-log.
+ * @return true: file opened.
+ */
+bool ReplaySource::open(qint32 baudRate, const QString &timestampFormat)
+{
+    if (!m_file.open(QIODevice::ReadOnly))
+    {
+        m_errorString = m_file.errorString();
+        return false;
+    }
+    m_baudRate = qMax(baudRate, 1);
+    /* About 10 ms of data at 10 bits per byte */
+    m_rawChunkSize = qMax(16, m_baudRate / 10 / 100);
+    m_rawBytes = 0;
+    m_timestampFormat = timestampFormat;
+    m_timestampLength = TimestampFormatter(timestampFormat).toByteArray(QDateTime::currentMSecsSinceEpoch()).size();
+    m_startTime_ms = -1;
+    m_lastTime_ms = -1;
+    m_dayOffset_ms = 0;
+
+    char header[captureHeaderSize];
+    qint64 headerLen = m_file.peek(header, captureHeaderSize);
+    if (headerLen == captureHeaderSize && memcmp(header, captureMagic, sizeof(captureMagic)) == 0)
+    {
+        quint32 headerSize = qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(header) + 12);
+        m_startWallClock_ms = qFromLittleEndian<qint64>(reinterpret_cast<const uchar *>(header) + 16);
+        m_startTime_ns = qFromLittleEndian<qint64>(reinterpret_cast<const uchar *>(header) + 24);
+        m_format = FORMAT_capture;
+        m_file.seek(headerSize);
+    }
+    else if (headerLen > 0 && QByteArray(header, static_cast<int>(headerLen)).startsWith(logMessagePrefix("Start logging on %1, serial port %2")))
+    {
+        m_format = FORMAT_autoLog;
+    }
+    else
+    {
+        m_format = FORMAT_raw;
+    }
+    qDebug() << __PRETTY_FUNCTION__ << m_file.fileName() << "format" << m_format;
+    return true;
+}
+
+void ReplaySource::close()
+{
+    m_file.close();
+}
+
+ReplaySource::format_t ReplaySource::format() const
+{
+    return m_format;
+}
+
+QString ReplaySource::errorString() const
+{
+    return m_errorString;
+}
+
+qint64 ReplaySource::size() const
+{
+    return m_file.size();
+}
+
+qint64 ReplaySource::position() const
+{
+    return m_file.pos();
+}
+
+/**
+ * @brief ReplaySource::next
+ * Reads next piece of recorded session.
+ *
+ * @param chunk Data, its direction and time.
+ * @return false: end of file or error.
+ */
+bool ReplaySource::next(replayChunk_t *chunk)
+{
+    switch (m_format)
+    {
+        case FORMAT_capture:
+            return nextCapture(chunk);
+        case FORMAT_autoLog:
+            return nextAutoLog(chunk);
+        case FORMAT_raw:
+        default:
+            return nextRaw(chunk);
+    }
+}
+
+bool ReplaySource::nextRaw(replayChunk_t *chunk)
+{
+    chunk->data = m_file.read(m_rawChunkSize);
+    if (chunk->data.isEmpty())
+    {
+        return false;
+    }
+    chunk->type = CAPTURE_rx;
+    /* 10 bits per byte on the wire */
+    chunk->time_ns = static_cast<qint64>(m_rawBytes * 10.0 * 1e9 / m_baudRate);
+    chunk->wallClock_ms = -1;
+    m_rawBytes += chunk->data.size();
+    return true;
+}
+
+/**
+ * @brief ReplaySource::nextAutoLog
+ * Reads next line of auto-log and removes its timestamp. Sent and received
+ * data cannot be distinguished in auto-log, all of them are replayed as
+ * received data.
+ */
+bool ReplaySource::nextAutoLog(replayChunk_t *chunk)
+{
+    static const QByteArray startPrefix = logMessagePrefix("Start logging on %1, serial port %2");
+    static const QByteArray stopPrefix = logMessagePrefix("Stop logging on %1, serial port %2");
+
+    for (;;)
+    {
+        QByteArray line = m_file.readLine();
+        if (line.isEmpty())
+        {
+            return false;
+        }
+        if (line.startsWith(startPrefix) || line.startsWith(stopPrefix))
+        {
+            continue;
+        }
+
+        chunk->type = CAPTURE_rx;
+        chunk->time_ns = -1;
+        chunk->wallClock_ms = -1;
+        chunk->data = line;
+        if (m_timestampLength > 0 && line.size() >= m_timestampLength)
+        {
+            QDateTime timestamp = QDateTime::fromString(QString::fromLocal8Bit(line.constData(), m_timestampLength), m_timestampFormat);
+            if (timestamp.isValid())
+            {
+                qint64 time_ms = timestamp.toMSecsSinceEpoch() + m_dayOffset_ms;
+                if (m_lastTime_ms >= 0 && time_ms < m_lastTime_ms - day_ms / 2)
+                {
+                    /* Timestamp has no date and midnight passed */
+                    m_dayOffset_ms += day_ms;
+                    time_ms += day_ms;
+                }
+                if (m_startTime_ms < 0)
+                {
+                    m_startTime_ms = time_ms;
+                }
+                m_lastTime_ms = time_ms;
+                chunk->time_ns = (time_ms - m_startTime_ms) * 1000000;
+                chunk->wallClock_ms = time_ms;
+                chunk->data = line.mid(m_timestampLength);
+            }
+        }
+        return true;
+    }
+}
+
+bool ReplaySource::nextCapture(replayChunk_t *chunk)
+{
+    uchar header[captureRecordHeaderSize];
+    if (m_file.read(reinterpret_cast<char *>(header), captureRecordHeaderSize) != captureRecordHeaderSize)
+    {
+        return false;
+    }
+    quint32 len = qFromLittleEndian<quint32>(header);
+    if (len > static_cast<quint32>(m_file.size()))
+    {
+        m_errorString = QCoreApplication::translate("ReplaySource", "Invalid record in capture");
+        return false;
+    }
+    chunk->type = static_cast<captureRecordType_t>(header[4]);
+    chunk->time_ns = qFromLittleEndian<qint64>(header + 8) - m_startTime_ns;
+    chunk->wallClock_ms = m_startWallClock_ms + chunk->time_ns / 1000000;
+    chunk->data = m_file.read(len);
+    if (static_cast<quint32>(chunk->data.size()) != len)
+    {
+        /* Truncated record: capture was not closed properly */
+        m_errorString = QCoreApplication::translate("ReplaySource", "Truncated record at end of capture");
+        return false;
+    }
+    return true;
+}
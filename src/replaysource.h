@@ -0,0 +1,78 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef REPLAYSOURCE_H
+#define REPLAYSOURCE_H
+
+#include <QByteArray>
+#include <QString>
+#include <QFile>
+
+#include "captureformat.h"
+
+/**
+ * @brief A piece of recorded session.
+ */
+typedef struct
+{
+    QByteArray data;
+    captureRecordType_t type;
+    qint64 time_ns;             /**< Time from start of recording, -1: unknown. */
+    qint64 wallClock_ms;        /**< Recorded milliseconds since epoch, -1: unknown. */
+} replayChunk_t;
+
+/**
+ * @brief The ReplaySource class
+ * Reads a recorded session for replay. Supported formats:
+ * - binary capture (*.iscap), with original timing, direction and line events,
+ * - auto-log, timing is parsed from timestamps at start of lines,
+ * - raw byte dump, timing is calculated from baud rate.
+ */
+class ReplaySource
+{
+public:
+    typedef enum
+    {
+        FORMAT_raw,
+        FORMAT_autoLog,
+        FORMAT_capture
+    } format_t;
+
+    explicit ReplaySource(const QString &fileName);
+    ~ReplaySource();
+
+    bool open(qint32 baudRate, const QString &timestampFormat);
+    void close();
+    format_t format() const;
+    QString errorString() const;
+    qint64 size() const;
+    qint64 position() const;
+
+    bool next(replayChunk_t *chunk);
+
+private:
+    Q_DISABLE_COPY(ReplaySource)
+
+    bool nextRaw(replayChunk_t *chunk);
+    bool nextAutoLog(replayChunk_t *chunk);
+    bool nextCapture(replayChunk_t *chunk);
+
+    QFile m_file;
+    format_t m_format;
+    QString m_errorString;
+    qint32 m_baudRate;
+    int m_rawChunkSize;             /**< Raw dump is replayed in chunks of this size. */
+    qint64 m_rawBytes;              /**< Bytes of raw dump read so far. */
+    QString m_timestampFormat;      /**< Timestamp format of auto-log. */
+    int m_timestampLength;          /**< Length of timestamps in auto-log. */
+    qint64 m_startTime_ms;          /**< Time of first timestamp in auto-log. */
+    qint64 m_lastTime_ms;           /**< Last timestamp of auto-log, to detect midnight. */
+    qint64 m_dayOffset_ms;          /**< Added to timestamps of auto-log after midnight. */
+    qint64 m_startTime_ns;          /**< Monotonic time of start of capture. */
+    qint64 m_startWallClock_ms;     /**< Wall clock time of start of capture. */
+};
+
+#endif // REPLAYSOURCE_H
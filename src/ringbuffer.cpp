@@ -0,0 +1,222 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <string.h>
+
+#include "ringbuffer.h"
+
+/**
+ * @brief RingBuffer::RingBuffer
+ * @param capacity Size of buffer in bytes. It is rounded up to power of two.
+ */
+RingBuffer::RingBuffer(qint64 capacity)
+    : m_buffer(NULL)
+    , m_head(0)
+    , m_tail(0)
+{
+    setCapacity(capacity);
+}
+
+RingBuffer::~RingBuffer()
+{
+    delete[] m_buffer;
+    m_buffer = NULL;
+}
+
+qint64 RingBuffer::capacity() const
+{
+    return static_cast<qint64>(m_mask + 1u);
+}
+
+/**
+ * @brief RingBuffer::setCapacity
+ * Reallocates the buffer, its content is dropped. Shall not be called while
+ * the producer or the consumer uses the buffer.
+ *
+ * @param capacity Size of buffer in bytes. It is rounded up to power of two.
+ */
+void RingBuffer::setCapacity(qint64 capacity)
+{
+    quint64 size = 4096u;
+    while (size < static_cast<quint64>(capacity))
+    {
+        size <<= 1;
+    }
+    if (!m_buffer || size != m_mask + 1u)
+    {
+        delete[] m_buffer;
+        m_buffer = new char[size];
+        m_mask = size - 1u;
+    }
+    m_head.store(0);
+    m_tail.store(0);
+}
+
+/**
+ * @brief RingBuffer::size
+ * @return Fill level: number of bytes which can be read.
+ */
+qint64 RingBuffer::size() const
+{
+    return static_cast<qint64>(m_head.load(std::memory_order_acquire) - m_tail.load(std::memory_order_acquire));
+}
+
+qint64 RingBuffer::freeSpace() const
+{
+    return capacity() - size();
+}
+
+bool RingBuffer::isEmpty() const
+{
+    return size() == 0;
+}
+
+/**
+ * @brief RingBuffer::writeOffset
+ * @return Total number of bytes written: position of next byte in the stream.
+ */
+quint64 RingBuffer::writeOffset() const
+{
+    return m_head.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief RingBuffer::readOffset
+ * @return Total number of bytes read: position of next byte to read in the stream.
+ */
+quint64 RingBuffer::readOffset() const
+{
+    return m_tail.load(std::memory_order_acquire);
+}
+
+/**
+ * @brief RingBuffer::writeRegion
+ * Gets contiguous free space. Data shall be copied there and commit() shall
+ * be called. Only the producer thread may call it.
+ *
+ * @param data Pointer to the free space.
+ * @return Length of the free space in bytes, 0 if buffer is full.
+ */
+qint64 RingBuffer::writeRegion(char **data)
+{
+    quint64 head = m_head.load(std::memory_order_relaxed);
+    quint64 tail = m_tail.load(std::memory_order_acquire);
+    quint64 offset = head & m_mask;
+    quint64 freeSpace = (m_mask + 1u) - (head - tail);
+    quint64 contiguous = (m_mask + 1u) - offset;
+
+    *data = m_buffer + offset;
+    return static_cast<qint64>(qMin(freeSpace, contiguous));
+}
+
+/**
+ * @brief RingBuffer::commit
+ * Makes data stored by writeRegion() visible for the consumer.
+ *
+ * @param len Number of bytes stored.
+ */
+void RingBuffer::commit(qint64 len)
+{
+    Q_ASSERT(len >= 0 && len <= freeSpace());
+    m_head.store(m_head.load(std::memory_order_relaxed) + static_cast<quint64>(len), std::memory_order_release);
+}
+
+/**
+ * @brief RingBuffer::write
+ * Copies data into the buffer.
+ *
+ * @return Number of bytes stored. Less than len if buffer became full.
+ */
+qint64 RingBuffer::write(const char *data, qint64 len)
+{
+    qint64 written = 0;
+
+    while (written < len)
+    {
+        char *region;
+        qint64 regionLen = writeRegion(&region);
+        if (regionLen == 0)
+        {
+            break;
+        }
+        regionLen = qMin(regionLen, len - written);
+        memcpy(region, data + written, static_cast<size_t>(regionLen));
+        commit(regionLen);
+        written += regionLen;
+    }
+
+    return written;
+}
+
+/**
+ * @brief RingBuffer::readRegion
+ * Gets contiguous data without copying it. Only the consumer thread may
+ * call it. The data is valid until consume() is called.
+ *
+ * @param data Pointer to the data.
+ * @return Length of the data in bytes, 0 if buffer is empty.
+ */
+qint64 RingBuffer::readRegion(const char **data) const
+{
+    quint64 tail = m_tail.load(std::memory_order_relaxed);
+    quint64 head = m_head.load(std::memory_order_acquire);
+    quint64 offset = tail & m_mask;
+    quint64 available = head - tail;
+    quint64 contiguous = (m_mask + 1u) - offset;
+
+    *data = m_buffer + offset;
+    return static_cast<qint64>(qMin(available, contiguous));
+}
+
+/**
+ * @brief RingBuffer::consume
+ * Releases data which was got by readRegion().
+ *
+ * @param len Number of bytes processed.
+ */
+void RingBuffer::consume(qint64 len)
+{
+    Q_ASSERT(len >= 0 && len <= size());
+    m_tail.store(m_tail.load(std::memory_order_relaxed) + static_cast<quint64>(len), std::memory_order_release);
+}
+
+qint64 RingBuffer::read(char *data, qint64 maxLen)
+{
+    qint64 readLen = 0;
+
+    while (readLen < maxLen)
+    {
+        const char *region;
+        qint64 regionLen = readRegion(&region);
+        if (regionLen == 0)
+        {
+            break;
+        }
+        regionLen = qMin(regionLen, maxLen - readLen);
+        memcpy(data + readLen, region, static_cast<size_t>(regionLen));
+        consume(regionLen);
+        readLen += regionLen;
+    }
+
+    return readLen;
+}
+
+QByteArray RingBuffer::readAll()
+{
+    QByteArray data;
+    data.resize(static_cast<int>(size()));
+    data.resize(static_cast<int>(read(data.data(), data.size())));
+    return data;
+}
+
+/**
+ * @brief RingBuffer::clear
+ * Drops all data. Only the consumer thread may call it.
+ */
+void RingBuffer::clear()
+{
+    m_tail.store(m_head.load(std::memory_order_acquire), std::memory_order_release);
+}
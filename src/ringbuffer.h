@@ -0,0 +1,59 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef RINGBUFFER_H
+#define RINGBUFFER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+
+#include <atomic>
+
+/**
+ * @brief The RingBuffer class
+ * Fixed-capacity byte ring for exactly one producer and one consumer thread.
+ * Neither side takes a lock. The consumer can process data in place by
+ * using readRegion() and consume(), the producer can receive data in place
+ * by using writeRegion() and commit().
+ */
+class RingBuffer
+{
+public:
+    explicit RingBuffer(qint64 capacity = 4 * 1024 * 1024);
+    ~RingBuffer();
+
+    qint64 capacity() const;
+    void setCapacity(qint64 capacity);
+    qint64 size() const;
+    qint64 freeSpace() const;
+    bool isEmpty() const;
+    quint64 writeOffset() const;
+    quint64 readOffset() const;
+
+    /* Producer side */
+    qint64 writeRegion(char **data);
+    void commit(qint64 len);
+    qint64 write(const char *data, qint64 len);
+
+    /* Consumer side */
+    qint64 readRegion(const char **data) const;
+    void consume(qint64 len);
+    qint64 read(char *data, qint64 maxLen);
+    QByteArray readAll();
+    void clear();
+
+private:
+    Q_DISABLE_COPY(RingBuffer)
+
+    char *m_buffer;
+    quint64 m_mask;             /**< Capacity - 1, capacity is power of two. */
+    /** Total number of bytes written. Only the producer modifies it. */
+    alignas(64) std::atomic<quint64> m_head;
+    /** Total number of bytes read. Only the consumer modifies it. */
+    alignas(64) std::atomic<quint64> m_tail;
+};
+
+#endif // RINGBUFFER_H
@@ -0,0 +1,142 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QCoreApplication>
+#include <QDebug>
+
+#include "sendjob.h"
+
+/** Size of file window which is read at once, a read shall not block I/O thread for long */
+static const qint64 windowSize = 64 * 1024;
+
+SendJob::SendJob(const QByteArray &data)
+    : m_data(data)
+    , m_fileSize(0)
+    , m_isFile(false)
+    , m_windowOffset(0)
+{
+}
+
+SendJob::SendJob(const QString &fileName)
+    : m_file(fileName)
+    , m_fileSize(0)
+    , m_isFile(true)
+    , m_windowOffset(0)
+{
+}
+
+SendJob::~SendJob()
+{
+    close();
+}
+
+bool SendJob::isFile() const
+{
+    return m_isFile;
+}
+
+QString SendJob::fileName() const
+{
+    return m_file.fileName();
+}
+
+/**
+ * @brief SendJob::append
+ * Appends data to a buffer job. It shall not be called for file jobs.
+ */
+void SendJob::append(const QByteArray &data)
+{
+    Q_ASSERT(!m_isFile);
+    m_data.append(data);
+}
+
+/**
+ * @brief SendJob::open
+ * Opens file of job. Buffer jobs are always open.
+ *
+ * @return true: data can be read.
+ */
+bool SendJob::open()
+{
+    if (!m_isFile)
+    {
+        return true;
+    }
+    m_errorString.clear();
+    if (!m_file.open(QFile::ReadOnly))
+    {
+        return false;
+    }
+    m_fileSize = m_file.size();
+    return true;
+}
+
+void SendJob::close()
+{
+    m_window.clear();
+    if (m_file.isOpen())
+    {
+        m_file.close();
+    }
+}
+
+QString SendJob::errorString() const
+{
+    return m_errorString.isEmpty() ? m_file.errorString() : m_errorString;
+}
+
+qint64 SendJob::size() const
+{
+    return m_isFile ? m_fileSize : m_data.length();
+}
+
+/**
+ * @brief SendJob::chunk
+ * Gets contiguous data starting at offset. The data is valid until the next
+ * call. If the file became shorter while it is sent, the data still in the
+ * file is returned, then it is reported as error.
+ *
+ * @param offset Offset in the job.
+ * @param data Pointer to the data.
+ * @return Length of data in bytes, 0 at the end, -1 on read error.
+ */
+qint64 SendJob::chunk(qint64 offset, const char **data)
+{
+    if (offset >= size())
+    {
+        return 0;
+    }
+    if (!m_isFile)
+    {
+        *data = m_data.constData() + offset;
+        return m_data.length() - offset;
+    }
+
+    if (m_window.isEmpty() || offset < m_windowOffset || offset >= m_windowOffset + m_window.size())
+    {
+        /* Move window */
+        qint64 length = qMin(windowSize, m_fileSize - offset);
+        qint64 readLength;
+
+        m_windowOffset = offset;
+        m_window.resize(static_cast<int>(length));
+        readLength = m_file.seek(offset) ? m_file.read(m_window.data(), length) : -1;
+        if (readLength <= 0)
+        {
+            if (readLength == 0)
+            {
+                m_errorString = QCoreApplication::translate("SendJob", "File became shorter while it was sent");
+            }
+            qCritical() << __PRETTY_FUNCTION__ << "cannot read" << m_file.fileName() << errorString();
+            m_window.clear();
+            return -1;
+        }
+        m_window.resize(static_cast<int>(readLength));
+    }
+
+    *data = m_window.constData() + (offset - m_windowOffset);
+    return m_windowOffset + m_window.size() - offset;
+}
@@ -0,0 +1,50 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef SENDJOB_H
+#define SENDJOB_H
+
+#include <QByteArray>
+#include <QString>
+#include <QFile>
+
+/**
+ * @brief The SendJob class
+ * Data to be sent by SerialThread: either a buffer or a file. File is not
+ * loaded into memory, it is read in fixed size windows, so memory usage
+ * does not depend on the size of the file. File is not memory-mapped:
+ * truncating a mapped file while it is sent would raise SIGBUS.
+ */
+class SendJob
+{
+public:
+    explicit SendJob(const QByteArray &data);
+    explicit SendJob(const QString &fileName);
+    ~SendJob();
+
+    bool isFile() const;
+    QString fileName() const;
+    void append(const QByteArray &data);
+
+    bool open();
+    void close();
+    QString errorString() const;
+    qint64 size() const;
+    qint64 chunk(qint64 offset, const char **data);
+
+private:
+    Q_DISABLE_COPY(SendJob)
+
+    QByteArray m_data;          /**< Data to send if job is not a file. */
+    QFile m_file;
+    qint64 m_fileSize;          /**< Size when file was opened, it is sent at most. */
+    bool m_isFile;
+    QByteArray m_window;        /**< Window of the file read at m_windowOffset. */
+    qint64 m_windowOffset;      /**< Offset of window in the file. */
+    QString m_errorString;      /**< Error found by SendJob, empty: error of m_file. */
+};
+
+#endif // SENDJOB_H
@@ -0,0 +1,323 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QFile>
+#include <QFileInfo>
+#include <QDebug>
+
+#include "common.h"
+#include "serialportbackend.h"
+
+#if LINUX
+#include <sys/ioctl.h>
+#include <linux/serial.h>
+#include <errno.h>
+#include <string.h>
+#endif
+
+SerialPortBackend::SerialPortBackend(QObject *parent)
+    : PortBackend(parent)
+    , m_savedSerialFlags(-1)
+    , m_savedLatencyTimer_ms(-1)
+{
+    m_serialPort = new QSerialPort(this);
+    MY_ASSERT(connect(m_serialPort, SIGNAL(error(QSerialPort::SerialPortError)), this,
+                      SIGNAL(error(QSerialPort::SerialPortError))));
+}
+
+SerialPortBackend::~SerialPortBackend()
+{
+}
+
+bool SerialPortBackend::open(QIODevice::OpenMode mode)
+{
+    return m_serialPort->open(mode);
+}
+
+void SerialPortBackend::close()
+{
+    restoreLatency();
+    m_serialPort->close();
+}
+
+bool SerialPortBackend::isOpen() const
+{
+    return m_serialPort->isOpen();
+}
+
+bool SerialPortBackend::isWritable() const
+{
+    return m_serialPort->isWritable();
+}
+
+int SerialPortBackend::handle() const
+{
+#if WINDOWS
+    /* Windows handle cannot be polled */
+    return -1;
+#else
+    return m_serialPort->handle();
+#endif
+}
+
+QString SerialPortBackend::portName() const
+{
+    return m_serialPort->portName();
+}
+
+void SerialPortBackend::setPortName(const QString &name)
+{
+    m_serialPort->setPortName(name);
+}
+
+QString SerialPortBackend::errorString() const
+{
+    return m_serialPort->errorString();
+}
+
+qint64 SerialPortBackend::bytesAvailable() const
+{
+    return m_serialPort->bytesAvailable();
+}
+
+qint64 SerialPortBackend::bytesToWrite() const
+{
+    return m_serialPort->bytesToWrite();
+}
+
+QByteArray SerialPortBackend::read(qint64 maxLen)
+{
+    return m_serialPort->read(maxLen);
+}
+
+qint64 SerialPortBackend::write(const char *data, qint64 len)
+{
+    return m_serialPort->write(data, len);
+}
+
+bool SerialPortBackend::waitForReadyRead(int msecs)
+{
+    return m_serialPort->waitForReadyRead(msecs);
+}
+
+bool SerialPortBackend::waitForBytesWritten(int msecs)
+{
+    return m_serialPort->waitForBytesWritten(msecs);
+}
+
+bool SerialPortBackend::setBaudRate(qint32 baudRate, QSerialPort::Directions directions)
+{
+    return m_serialPort->setBaudRate(baudRate, directions);
+}
+
+qint32 SerialPortBackend::baudRate(QSerialPort::Directions directions) const
+{
+    return m_serialPort->baudRate(directions);
+}
+
+bool SerialPortBackend::setDataBits(QSerialPort::DataBits dataBits)
+{
+    return m_serialPort->setDataBits(dataBits);
+}
+
+QSerialPort::DataBits SerialPortBackend::dataBits() const
+{
+    return m_serialPort->dataBits();
+}
+
+bool SerialPortBackend::setParity(QSerialPort::Parity parity)
+{
+    return m_serialPort->setParity(parity);
+}
+
+QSerialPort::Parity SerialPortBackend::parity() const
+{
+    return m_serialPort->parity();
+}
+
+bool SerialPortBackend::setStopBits(QSerialPort::StopBits stopBits)
+{
+    return m_serialPort->setStopBits(stopBits);
+}
+
+QSerialPort::StopBits SerialPortBackend::stopBits() const
+{
+    return m_serialPort->stopBits();
+}
+
+bool SerialPortBackend::setFlowControl(QSerialPort::FlowControl flowControl)
+{
+    return m_serialPort->setFlowControl(flowControl);
+}
+
+QSerialPort::FlowControl SerialPortBackend::flowControl() const
+{
+    return m_serialPort->flowControl();
+}
+
+bool SerialPortBackend::setDataTerminalReady(bool set)
+{
+    return m_serialPort->setDataTerminalReady(set);
+}
+
+bool SerialPortBackend::isDataTerminalReady()
+{
+    return m_serialPort->isDataTerminalReady();
+}
+
+bool SerialPortBackend::setRequestToSend(bool set)
+{
+    return m_serialPort->setRequestToSend(set);
+}
+
+bool SerialPortBackend::isRequestToSend()
+{
+    return m_serialPort->isRequestToSend();
+}
+
+QSerialPort::PinoutSignals SerialPortBackend::pinoutSignals()
+{
+    return m_serialPort->pinoutSignals();
+}
+
+/**
+ * @brief SerialPortBackend::setLowLatency
+ * Sets ASYNC_LOW_LATENCY flag of tty, so the driver pushes received data
+ * to the tty layer at once, and sets latency timer of USB adapter (e.g.
+ * FTDI, default 16 ms) to 1 ms if its sysfs file is writable. Original
+ * values are restored when port is closed or low latency is disabled.
+ * Port shall be opened.
+ *
+ * @return false: none of them could be set.
+ */
+bool SerialPortBackend::setLowLatency(bool enable)
+{
+#if !LINUX
+    /* Windows: latency timer of FTDI driver is set in device manager */
+    Q_UNUSED(enable);
+    return false;
+#else
+    struct serial_struct serial;
+    int fd = handle();
+    bool isSet = false;
+
+    if (!enable)
+    {
+        restoreLatency();
+        return true;
+    }
+    if (fd >= 0 && ioctl(fd, TIOCGSERIAL, &serial) == 0)
+    {
+        int flags = serial.flags;
+        serial.flags |= ASYNC_LOW_LATENCY;
+        if (ioctl(fd, TIOCSSERIAL, &serial) == 0)
+        {
+            if (m_savedSerialFlags < 0)
+            {
+                m_savedSerialFlags = flags;
+            }
+            isSet = true;
+        }
+        else
+        {
+            qDebug() << __PRETTY_FUNCTION__ << "cannot set low latency flag:" << strerror(errno);
+        }
+    }
+    QString path = latencyTimerPath();
+    if (!path.isEmpty() && QFileInfo(path).isWritable())
+    {
+        int latencyTimer = latencyTimer_ms();
+        QFile file(path);
+        if (file.open(QIODevice::WriteOnly) && file.write("1") == 1 && file.flush())
+        {
+            if (m_savedLatencyTimer_ms < 0)
+            {
+                m_savedLatencyTimer_ms = latencyTimer;
+            }
+            isSet = true;
+        }
+        else
+        {
+            qDebug() << __PRETTY_FUNCTION__ << "cannot set latency timer:" << file.errorString();
+        }
+    }
+    return isSet;
+#endif
+}
+
+/**
+ * @brief SerialPortBackend::latencyTimer_ms
+ * @return Latency timer of USB adapter from sysfs, -1 if it has none.
+ */
+int SerialPortBackend::latencyTimer_ms() const
+{
+    QFile file(latencyTimerPath());
+    bool ok = false;
+    int latencyTimer = -1;
+
+    if (!file.fileName().isEmpty() && file.open(QIODevice::ReadOnly))
+    {
+        latencyTimer = file.readAll().trimmed().toInt(&ok);
+    }
+    return ok ? latencyTimer : -1;
+}
+
+/**
+ * @brief SerialPortBackend::latencyTimerPath
+ * @return Path of latency_timer in sysfs, empty if device has no such.
+ */
+QString SerialPortBackend::latencyTimerPath() const
+{
+#if !LINUX
+    return QString();
+#else
+    QString path = m_serialPort->portName();
+
+    if (!path.contains('/'))
+    {
+        path = "/dev/" + path;
+    }
+    /* Resolve /dev/serial/by-id/... links */
+    path = QFileInfo(path).canonicalFilePath();
+    if (path.isEmpty())
+    {
+        return QString();
+    }
+    path = "/sys/class/tty/" + QFileInfo(path).fileName() + "/device/latency_timer";
+    return QFile::exists(path) ? path : QString();
+#endif
+}
+
+/**
+ * @brief SerialPortBackend::restoreLatency
+ * Restores values changed by setLowLatency().
+ */
+void SerialPortBackend::restoreLatency()
+{
+#if LINUX
+    struct serial_struct serial;
+    int fd = handle();
+
+    if (m_savedSerialFlags >= 0 && fd >= 0 && ioctl(fd, TIOCGSERIAL, &serial) == 0)
+    {
+        serial.flags = (serial.flags & ~ASYNC_LOW_LATENCY) | (m_savedSerialFlags & ASYNC_LOW_LATENCY);
+        if (ioctl(fd, TIOCSSERIAL, &serial) < 0)
+        {
+            qDebug() << __PRETTY_FUNCTION__ << "cannot restore low latency flag:" << strerror(errno);
+        }
+    }
+    if (m_savedLatencyTimer_ms >= 0)
+    {
+        QFile file(latencyTimerPath());
+        if (!file.open(QIODevice::WriteOnly) || file.write(QByteArray::number(m_savedLatencyTimer_ms)) <= 0 || !file.flush())
+        {
+            qDebug() << __PRETTY_FUNCTION__ << "cannot restore latency timer:" << file.errorString();
+        }
+    }
+#endif
+    m_savedSerialFlags = -1;
+    m_savedLatencyTimer_ms = -1;
+}
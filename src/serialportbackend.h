@@ -0,0 +1,71 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef SERIALPORTBACKEND_H
+#define SERIALPORTBACKEND_H
+
+#include <QSerialPort>
+
+#include "portbackend.h"
+
+/**
+ * @brief The SerialPortBackend class
+ * Real serial port, implemented by QSerialPort.
+ */
+class SerialPortBackend : public PortBackend
+{
+    Q_OBJECT
+public:
+    explicit SerialPortBackend(QObject *parent = 0);
+    ~SerialPortBackend();
+
+    bool open(QIODevice::OpenMode mode);
+    void close();
+    bool isOpen() const;
+    bool isWritable() const;
+    int handle() const;
+
+    QString portName() const;
+    void setPortName(const QString &name);
+    QString errorString() const;
+
+    qint64 bytesAvailable() const;
+    qint64 bytesToWrite() const;
+    QByteArray read(qint64 maxLen);
+    qint64 write(const char *data, qint64 len);
+    bool waitForReadyRead(int msecs);
+    bool waitForBytesWritten(int msecs);
+
+    bool setBaudRate(qint32 baudRate, QSerialPort::Directions directions = QSerialPort::AllDirections);
+    qint32 baudRate(QSerialPort::Directions directions = QSerialPort::AllDirections) const;
+    bool setDataBits(QSerialPort::DataBits dataBits);
+    QSerialPort::DataBits dataBits() const;
+    bool setParity(QSerialPort::Parity parity);
+    QSerialPort::Parity parity() const;
+    bool setStopBits(QSerialPort::StopBits stopBits);
+    QSerialPort::StopBits stopBits() const;
+    bool setFlowControl(QSerialPort::FlowControl flowControl);
+    QSerialPort::FlowControl flowControl() const;
+
+    bool setDataTerminalReady(bool set);
+    bool isDataTerminalReady();
+    bool setRequestToSend(bool set);
+    bool isRequestToSend();
+    QSerialPort::PinoutSignals pinoutSignals();
+
+    bool setLowLatency(bool enable);
+    int latencyTimer_ms() const;
+
+private:
+    QString latencyTimerPath() const;
+    void restoreLatency();
+
+    QSerialPort *m_serialPort;
+    int m_savedSerialFlags;     /**< tty flags before setLowLatency(), -1: not changed. */
+    int m_savedLatencyTimer_ms; /**< Latency timer before setLowLatency(), -1: not changed. */
+};
+
+#endif // SERIALPORTBACKEND_H
@@ -33,6 +33,7 @@ SerialSettings::SerialSettings(QObject *parent) :
     m_serialSettings.stringStopBits = "1";
     m_serialSettings.flowControl = QSerialPort::NoFlowControl;
     m_serialSettings.stringFlowControl = "No handshake";
+    m_serialSettings.lowLatency = false;
 }
 
 SerialSettings::~SerialSettings()
@@ -59,6 +60,7 @@ QString SerialSettings::toVerboseString() const
     str += "Parity bits: " + m_serialSettings.stringParity + NATIVE_LINEENDNG;
     str += "Stop bits: " + m_serialSettings.stringStopBits + NATIVE_LINEENDNG;
     str += "Flow control: " + m_serialSettings.stringFlowControl + NATIVE_LINEENDNG;
+    str += QString("Low latency: ") + (m_serialSettings.lowLatency ? "yes" : "no") + NATIVE_LINEENDNG;
 
     return str;
 }
@@ -72,6 +74,10 @@ QString SerialSettings::toString() const
     str += m_serialSettings.stringParity[0];
     str += m_serialSettings.stringStopBits;
     str += ", " + m_serialSettings.stringFlowControl;
+    if (m_serialSettings.lowLatency)
+    {
+        str += ", low latency";
+    }
 
     return str;
 }
@@ -96,6 +102,7 @@ void SerialSettings::loadSettings(SerialSettings::serialSettings_t *serialSettin
     serialSettings->stringStopBits = settings.value (path + "stringStopBits", m_serialSettings.stringStopBits).toString();
     serialSettings->flowControl = static_cast<QSerialPort::FlowControl> (settings.value (path + "flowControl", m_serialSettings.flowControl).toInt());
     serialSettings->stringFlowControl = settings.value (path + "stringFlowControl", m_serialSettings.stringFlowControl).toString();
+    serialSettings->lowLatency = settings.value (path + "lowLatency", m_serialSettings.lowLatency).toBool();
     qDebug() << __FUNCTION__ << toString();
 }
 
@@ -121,6 +128,7 @@ void SerialSettings::saveSettings(SerialSettings::serialSettings_t *serialSettin
     settings.setValue (path + "stringStopBits", serialSettings->stringStopBits);
     settings.setValue (path + "flowControl", serialSettings->flowControl);
     settings.setValue (path + "stringFlowControl", serialSettings->stringFlowControl);
+    settings.setValue (path + "lowLatency", serialSettings->lowLatency);
     qDebug() << __FUNCTION__ << toString();
 }
 
@@ -133,6 +141,7 @@ QDataStream &operator<<(QDataStream &out, const SerialSettings::serialSettings_t
     out << "Parity bits: " << s.stringParity;
     out << "Stop bits: " << s.stringStopBits;
     out << "Flow control: " << s.stringFlowControl;
+    out << "Low latency: " << s.lowLatency;
     return out;
 }
 
@@ -29,6 +29,7 @@ public:
         QString stringStopBits;
         QSerialPort::FlowControl flowControl;
         QString stringFlowControl;
+        bool lowLatency;        /**< Reduce latency of USB adapters, e.g. FTDI latency timer. */
     } serialSettings_t;
 
     explicit SerialSettings(QObject *parent = 0);
@@ -13,98 +13,533 @@
 #include <QDateTime>
 #include <QSettings>
 #include <QDir>
+#include <QFileInfo>
+#include <QtEndian>
+
+#include <string.h>
 
 #include "common.h"
 #include "qglobal.h"
 #include "serialsettings.h"
 #include "serialthread.h"
 
+#if ALT_MODE == 0
+#include <unistd.h>
+#include <errno.h>
+#include <time.h>
+#include <sys/epoll.h>
+#include <sys/eventfd.h>
+#include <sys/timerfd.h>
+#include <sys/prctl.h>
+#endif
+
 Q_DECLARE_METATYPE(QSerialPort::SerialPortError)
 Q_DECLARE_METATYPE(QSerialPort::PinoutSignals)
 
+/** Default minimum time between readyRead() signals: one frame at 60 Hz. */
+static const qint64 readyReadIntervalDefault_us = 16667;
+/** Port is read in chunks of this size while receive buffer is full. */
+static const int readOverflowChunkSize = 64 * 1024;
+
 SerialThread::SerialThread(QObject *parent, SerialSettings * serialSettings)
     : QThread(parent)
-    , m_command(CMD_undefined)
     , m_serialPort(NULL)
     , m_writeDataLength(0)
     , m_writeDataSent(0)
+    , m_writePending(0)
+    , m_readStalled(false)
+    , m_abortSend(false)
+    , m_bytesReceived(0)
+    , m_bytesSent(0)
+    , m_readyReadPending(false)
+    , m_readyReadInterval_us(readyReadIntervalDefault_us)
+    , m_readyReadDeferred(false)
+    , m_readyReadTime_ns(-1)
+    , m_readQueuePolicy(READ_QUEUE_block)
+    , m_readOverflowSize(0)
+    , m_readDiscardOffset(0)
+    , m_bytesDropped(0)
+    , m_bytesSpilled(0)
+    , m_lastWrite_ns(-1)
+    , m_roundTrip_ns(-1)
+    , m_running(false)
+    , m_portOpen(false)
+#if ALT_MODE == 0
+    , m_wakeupFd(-1)
+    , m_timerFd(-1)
+    , m_timerDeadline_ns(0)
+    , m_attached(false)
+    , m_portFd(-1)
+    , m_portEvents(0)
+#endif
     , m_delayAfterBytes_ms(1)
+    , m_delayAfterBytes_us(0)
     , m_delayAfterChr_ms(1)
+    , m_delayAfterChr_us(0)
     , m_serialSettings(serialSettings)
-    , m_autoLogIsEnabled(false)
-    , m_autoLogOverwriteIsEnabled(false)
+    , m_autoLogKept(false)
     , m_timestampFormatString("HH:mm:ss.zzz ")
+    , m_timestampFormatter(m_timestampFormatString)
 {
     qRegisterMetaType<QSerialPort::SerialPortError>("QSerialPort::SerialPortError");
     qRegisterMetaType<QSerialPort::PinoutSignals>("QSerialPort::PinoutSignals");
+    /* Defaults of QSerialPort */
+    m_portState.baudRate = QSerialPort::Baud9600;
+    m_portState.dataBits = QSerialPort::Data8;
+    m_portState.parity = QSerialPort::NoParity;
+    m_portState.stopBits = QSerialPort::OneStop;
+    m_portState.flowControl = QSerialPort::NoFlowControl;
+    m_portState.dataTerminalReady = false;
+    m_portState.requestToSend = false;
+    m_portState.pinoutSignals = QSerialPort::NoSignal;
+#if ALT_MODE == 0
+    m_wakeupFd = eventfd(0, EFD_NONBLOCK | EFD_CLOEXEC);
+    if (m_wakeupFd < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot create eventfd:" << strerror(errno);
+    }
+    m_timerFd = timerfd_create(CLOCK_MONOTONIC, TFD_NONBLOCK | TFD_CLOEXEC);
+    if (m_timerFd < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot create timerfd:" << strerror(errno);
+    }
+    m_send.job = NULL;
+    m_send.offset = 0;
+    m_send.spanRemaining = 0;
+    m_send.spanDelay_us = 0;
+    m_send.deadline_ns = 0;
+    m_send.resume_ns = 0;
+    m_send.length = 0;
+    m_send.active = false;
+    m_send.blocked = false;
+    m_send.showProgress = false;
+    m_send.progressSent = false;
+    m_replay.source = NULL;
+    m_replay.speed = 1.0;
+    m_replay.chunkPending = false;
+    m_replay.chunkOffset = 0;
+    m_replay.firstTime_ns = -1;
+    m_replay.time_ns = 0;
+    m_replay.start_ns = 0;
+    m_replay.fed_ns = 0;
+    m_replay.bytes = 0;
+    m_replay.draining = false;
+#else
+    m_monotonicTimer.start();
+#endif
     loadSettings();
+    m_autoLogIo = m_autoLog;
+    /* Size cannot be changed while the consumer may read the buffer */
+    m_readBuffer.setCapacity(QSettings().value("serial/readQueueSize_kB", m_readBuffer.capacity() / 1024).toLongLong() * 1024);
 }
 
 SerialThread::~SerialThread()
 {
+#if ALT_MODE == 0
+    if (m_attached)
+    {
+        stop(1000);
+    }
+    m_running = false;
+#else
     m_running = false;
     if (isRunning())
     {
         stop(10);
     }
+#endif
     delete m_serialPort;
     m_serialPort = NULL;
+    qDeleteAll(m_writeJobs);
+    m_writeJobs.clear();
+#if ALT_MODE == 0
+    if (m_wakeupFd >= 0)
+    {
+        ::close(m_wakeupFd);
+        m_wakeupFd = -1;
+    }
+    if (m_timerFd >= 0)
+    {
+        ::close(m_timerFd);
+        m_timerFd = -1;
+    }
+#endif
+}
+
+#if ALT_MODE == 0
+/**
+ * @brief SerialThread::startIo
+ * Registers the session in IoReactor, port is served by the reactor thread.
+ *
+ * @param priority Not used, reactor thread has its own priority.
+ */
+void SerialThread::startIo(QThread::Priority priority)
+{
+    Q_UNUSED(priority);
+    Q_ASSERT(m_serialPort == NULL);
+    IoReactor *reactor = IoReactor::instance();
+
+    m_running = true;
+    recreatePort(m_serialSettings->m_serialSettings.name);
+    m_attached = reactor->addFd(m_wakeupFd, EPOLLIN, this);
+    if (!m_attached || !reactor->addFd(m_timerFd, EPOLLIN, this))
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot register in reactor";
+    }
+}
+
+/**
+ * @brief SerialThread::handleEvent
+ * Called on reactor thread when a descriptor of the session is ready.
+ *
+ * @param fd Descriptor: wakeup, timer or port.
+ * @param events Ready events.
+ */
+void SerialThread::handleEvent(int fd, quint32 events)
+{
+    if (fd == m_portFd)
+    {
+        if (events & (EPOLLIN | EPOLLHUP | EPOLLERR))
+        {
+            readPort(fd);
+        }
+        if ((events & EPOLLOUT) && m_portFd >= 0)
+        {
+            m_send.blocked = false;
+            pumpSend();
+        }
+    }
+    else if (fd == m_timerFd)
+    {
+        quint64 expirations;
+        if (::read(m_timerFd, &expirations, sizeof(expirations)) < 0 && errno != EAGAIN)
+        {
+            qCritical() << __PRETTY_FUNCTION__ << "cannot read timer:" << strerror(errno);
+        }
+        m_timerDeadline_ns = 0;
+        flushReadyRead();
+        pumpSend();
+        pumpReplay();
+    }
+    else if (fd == m_wakeupFd)
+    {
+        /* Command arrived or consumer made space in receive buffer */
+        clearWakeup();
+        m_mutex.lock();
+        processCommands();
+        m_mutex.unlock();
+        if (!m_attached)
+        {
+            /* Stopped, caller of stop() may delete the session after release */
+            m_stopped.release();
+            return;
+        }
+        processLineEvents();
+        drainReadOverflow();
+        pumpSend();
+        pumpReplay();
+    }
+    updatePortEvents();
+}
+
+/**
+ * @brief SerialThread::handleTick
+ * Pinout signals of pseudo-terminals and simulated ports have no event,
+ * they are checked periodically while port is opened. Capture is flushed
+ * here too.
+ */
+void SerialThread::handleTick()
+{
+    QMutexLocker mutexLocker(&m_mutex);
+
+    if (m_serialPort->isOpen())
+    {
+        if (!m_lineWatcher.isWatching())
+        {
+            /* Check if CTS, RTS, etc. signals changed */
+            updatePinoutSignals(m_serialPort->pinoutSignals(), monotonicTime_ns());
+        }
+        m_captureWriter.flushIfDue(monotonicTime_ns());
+    }
+}
+
+/**
+ * @brief SerialThread::processLineEvents
+ * Reports modem line changes queued by m_lineWatcher. A pulse which ended
+ * before it was noticed is only seen in edge counters; it is reported as
+ * two changes with the same timestamp, so capture and display get it too.
+ */
+void SerialThread::processLineEvents()
+{
+    QMutexLocker mutexLocker(&m_mutex);
+    ModemLineWatcher::lineEvent_t event;
+
+    while (m_lineWatcher.takeEvent(&event))
+    {
+        const struct
+        {
+            QSerialPort::PinoutSignal pinoutSignal;
+            quint32 edges;
+        } lines[] =
+        {
+            { QSerialPort::ClearToSendSignal, event.ctsEdges },
+            { QSerialPort::DataSetReadySignal, event.dsrEdges },
+            { QSerialPort::DataCarrierDetectSignal, event.dcdEdges },
+            { QSerialPort::RingIndicatorSignal, event.riEdges }
+        };
+        for (size_t i = 0; i < sizeof(lines) / sizeof(lines[0]); i++)
+        {
+            quint32 changed = ((m_pinoutSignals ^ event.pinoutSignals) & lines[i].pinoutSignal) ? 1 : 0;
+            if (lines[i].edges >= changed + 2)
+            {
+                QSerialPort::PinoutSignals pinoutSignals = m_pinoutSignals;
+                updatePinoutSignals(pinoutSignals ^ lines[i].pinoutSignal, event.monotonic_ns);
+                updatePinoutSignals(pinoutSignals, event.monotonic_ns);
+            }
+        }
+        updatePinoutSignals(event.pinoutSignals, event.monotonic_ns);
+    }
+    if (m_portFd >= 0 && !m_lineWatcher.isWatching())
+    {
+        /* Watcher stopped on error, lines are polled */
+        IoReactor::instance()->setTickEnabled(this, true);
+    }
+}
+
+/**
+ * @brief SerialThread::updatePortEvents
+ * Registers port in reactor according to what the session waits for. Port
+ * is not polled while receive buffer is full, consumeReadData() wakes up the
+ * session when it makes space.
+ */
+void SerialThread::updatePortEvents()
+{
+    quint32 events = 0;
+
+    if (m_portFd < 0)
+    {
+        return;
+    }
+    if (readQueuePolicy() != READ_QUEUE_block
+            || (m_readOverflow.isEmpty() && !isReadBufferFull()))
+    {
+        /* Other policies read port even if buffer is full */
+        events |= EPOLLIN;
+    }
+    if (m_send.blocked)
+    {
+        events |= EPOLLOUT;
+    }
+    if (events == m_portEvents)
+    {
+        return;
+    }
+    /* Not registered at all if nothing is waited, otherwise hang up would
+     * be reported continuously */
+    if (events == 0)
+    {
+        IoReactor::instance()->removeFd(m_portFd);
+    }
+    else if (m_portEvents == 0)
+    {
+        IoReactor::instance()->addFd(m_portFd, events, this);
+    }
+    else
+    {
+        IoReactor::instance()->modifyFd(m_portFd, events);
+    }
+    m_portEvents = events;
+}
+
+/**
+ * @brief SerialThread::readPort
+ * Reads all available bytes from the port's file descriptor.
+ *
+ * @param portFd File descriptor of the opened port.
+ */
+void SerialThread::readPort(int portFd)
+{
+    qint64 received = 0;
+    bool portError = false;
+
+    drainReadOverflow();
+    if (m_serialPort->bytesAvailable())
+    {
+        /* Keep order: data may remain in QSerialPort's buffer */
+        readPortBuffer();
+    }
+
+    for (;;)
+    {
+        char *region;
+        /* Keep order: older data may wait in overflow */
+        qint64 regionLen = m_readOverflow.isEmpty() ? m_readBuffer.writeRegion(&region) : 0;
+        bool overflow = (regionLen == 0);
+        if (overflow)
+        {
+            if (readQueuePolicy() == READ_QUEUE_block)
+            {
+                /* Receive buffer is full, updatePortEvents() stops reading
+                 * until consumeReadData() makes space. */
+                break;
+            }
+            if (m_readOverflowChunk.isEmpty())
+            {
+                m_readOverflowChunk.resize(readOverflowChunkSize);
+            }
+            region = m_readOverflowChunk.data();
+            regionLen = m_readOverflowChunk.size();
+        }
+        ssize_t len = ::read(portFd, region, static_cast<size_t>(regionLen));
+        if (len > 0)
+        {
+            qint64 now_ms = QDateTime::currentMSecsSinceEpoch();
+            qint64 now_ns = monotonicTime_ns();
+            measureRoundTrip(now_ns);
+            writeLog(QByteArray::fromRawData(region, static_cast<int>(len)), true, now_ms, now_ns);
+            if (overflow)
+            {
+                overflowReadData(region, len, now_ns, now_ms);
+            }
+            else
+            {
+                m_arrivalTimes.stamp(m_readBuffer.writeOffset(), now_ns, now_ms);
+                m_readBuffer.commit(len);
+            }
+            m_bytesReceived.fetch_add(static_cast<quint64>(len), std::memory_order_relaxed);
+            received += len;
+            if (len < regionLen)
+            {
+                break;
+            }
+        }
+        else if (len < 0 && errno == EINTR)
+        {
+            continue;
+        }
+        else
+        {
+            /* 0: end of file (e.g. USB adapter unplugged) */
+            portError = (len == 0 || (errno != EAGAIN && errno != EWOULDBLOCK));
+            break;
+        }
+    }
+
+    /* Consumer may have made space while data went to overflow */
+    drainReadOverflow();
+    if (received)
+    {
+        notifyReadyRead();
+    }
+    if (portError)
+    {
+        /* Port is not usable anymore, close it to not to spin on EPOLLHUP */
+        qCritical() << __PRETTY_FUNCTION__ << "read failed:" << strerror(errno);
+        emit error(QSerialPort::ResourceError);
+        m_mutex.lock();
+        stopLogging();
+        closePort();
+        publishPortState();
+        m_mutex.unlock();
+        emit portStatusChanged(false);
+    }
+}
+
+/**
+ * @brief SerialThread::isReadBufferFull
+ * Checks if receive buffer is full. If it is full, the consumer will wake up
+ * the thread when it makes space.
+ *
+ * @return true: no space in receive buffer.
+ */
+bool SerialThread::isReadBufferFull()
+{
+    if (m_readBuffer.freeSpace() > 0)
+    {
+        return false;
+    }
+    m_readStalled = true;
+    /* Check again, consumer may have made space meanwhile */
+    if (m_readBuffer.freeSpace() > 0)
+    {
+        m_readStalled = false;
+        return false;
+    }
+    return true;
+}
+
+/**
+ * @brief SerialThread::clearWakeup
+ * Clears event counter of m_wakeupFd.
+ */
+void SerialThread::clearWakeup()
+{
+    quint64 counter;
+    while (::read(m_wakeupFd, &counter, sizeof(counter)) > 0)
+    {
+    }
+}
+
+/**
+ * @brief SerialThread::wakeup
+ * Wakes up the I/O loop to process a new command.
+ */
+void SerialThread::wakeup()
+{
+    quint64 one = 1;
+    if (::write(m_wakeupFd, &one, sizeof(one)) < 0 && errno != EAGAIN)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot wake up thread:" << strerror(errno);
+    }
+}
+#else
+void SerialThread::startIo(QThread::Priority priority)
+{
+    start(priority);
 }
 
 void SerialThread::run()
 {
     Q_ASSERT(m_serialPort == NULL);
     m_running = true;
-    recreatePort();
+    recreatePort(m_serialSettings->m_serialSettings.name);
 
     while (m_running)
     {
         m_mutex.lock();
-        /* Unlocks mutex and waits for event! */
-#if ALT_MODE
-        if (m_running && m_command != CMD_undefined)
-#else
-        if (m_running && m_commandEvent.wait(&m_mutex, 10))
-#endif
+        if (m_running)
         {
-            /* Mutex locked and command received */
-            processCommand();
+            processCommands();
         }
         if (m_running)
         {
+            drainReadOverflow();
             if (m_serialPort->isOpen())
             {
                 if (m_serialPort->waitForReadyRead(10))
                 {
-                    QByteArray byteArray = m_serialPort->readAll();
-                    writeLog(byteArray, true);
-                    m_readData.append(byteArray);
-                    emit readyRead();
+                    readPortBuffer();
                 }
                 /* Check if CTS, RTS, etc. signals changed */
-                QSerialPort::PinoutSignals pinoutSignals = m_serialPort->pinoutSignals();
-                if (pinoutSignals != m_pinoutSignals)
-                {
-                    emit pinoutSignalsChanged(pinoutSignals);
-                    m_pinoutSignals = pinoutSignals;
-                }
+                updatePinoutSignals(m_serialPort->pinoutSignals(), monotonicTime_ns());
+                m_captureWriter.flushIfDue(monotonicTime_ns());
             }
             else
             {
                 msleep(10);
             }
+            flushReadyRead();
         }
-#if ALT_MODE
         else
         {
           msleep(10);
         }
-#endif
         m_mutex.unlock();
     }
     delete m_serialPort;
     m_serialPort = NULL;
 }
+#endif
 
 /**
  * @brief SerialThread::stop
@@ -114,11 +549,26 @@ void SerialThread::run()
  */
 void SerialThread::stop(int timeout)
 {
-    m_running = false;
-    m_command = CMD_stop;
 #if ALT_MODE == 0
-    m_commandEvent.wakeAll();
-#endif
+    if (!m_attached)
+    {
+        return;
+    }
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_stop;
+    m_running = false;
+    pushCommand(command);
+    /* Reactor closes port and unregisters session */
+    if (!m_stopped.tryAcquire(1, timeout > 0 ? timeout : -1))
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "session is not stopped by reactor";
+    }
+    /* Wait until reactor leaves handleEvent() */
+    IoReactor::instance()->removeHandler(this);
+    m_attached = false;
+#else
+    /* Run loop exits, commands still queued are dropped */
+    m_running = false;
     if (timeout > 0)
     {
         if (!wait(timeout))
@@ -128,18 +578,103 @@ void SerialThread::stop(int timeout)
             wait();
         }
     }
+#endif
+}
+
+/**
+ * @brief SerialThread::closePort
+ * Closes the port. On Linux the port is removed from reactor and unsent
+ * data is dropped. Mutex shall be locked.
+ */
+void SerialThread::closePort()
+{
+#if ALT_MODE == 0
+    if (m_portFd >= 0)
+    {
+        if (m_portEvents)
+        {
+            IoReactor::instance()->removeFd(m_portFd);
+        }
+        IoReactor::instance()->setTickEnabled(this, false);
+        /* Watcher uses the descriptor */
+        m_lineWatcher.stopWatching();
+        m_portFd = -1;
+        m_portEvents = 0;
+    }
+    if (m_send.active || m_send.job)
+    {
+        finishSend();
+    }
+#endif
+    m_serialPort->close();
+}
+
+/**
+ * @brief SerialThread::publishPortState
+ * Copies state of the port for getters, so other threads do not wait while
+ * the I/O thread uses the port. Called by I/O thread before the change is
+ * reported.
+ */
+void SerialThread::publishPortState()
+{
+    portState_t state;
+    bool open = m_serialPort->isOpen();
+
+    /* Line getters of a closed port would set NotOpenError */
+    state.errorString = m_serialPort->errorString();
+    state.portName = m_serialPort->portName();
+    state.baudRate = m_serialPort->baudRate();
+    state.dataBits = m_serialPort->dataBits();
+    state.parity = m_serialPort->parity();
+    state.stopBits = m_serialPort->stopBits();
+    state.flowControl = m_serialPort->flowControl();
+    state.dataTerminalReady = open && m_serialPort->isDataTerminalReady();
+    state.requestToSend = open && m_serialPort->isRequestToSend();
+    state.pinoutSignals = open ? m_pinoutSignals : QSerialPort::NoSignal;
+    {
+        QMutexLocker mutexLocker(&m_portStateMutex);
+        m_portState = state;
+    }
+    m_portOpen = open;
+}
+
+/**
+ * @brief SerialThread::portError
+ * Publishes error string of the port before error() is forwarded. It is
+ * called on the thread which uses the port.
+ */
+void SerialThread::portError(QSerialPort::SerialPortError serialPortError)
+{
+    {
+        QMutexLocker mutexLocker(&m_portStateMutex);
+        m_portState.errorString = m_serialPort->errorString();
+    }
+    emit error(serialPortError);
 }
 
+/**
+ * @brief SerialThread::loadSettings
+ * Loads settings of the thread calling open(). I/O thread gets a copy of
+ * auto-log settings when port is opened.
+ */
 void SerialThread::loadSettings()
 {
     QSettings settings;
-    m_autoLogIsEnabled = settings.value("serial/autoLog", false).toBool();
-    m_autoLogOverwriteIsEnabled = settings.value("serial/autoLogOverwrite", false).toBool();
-    m_autoLogFileName = settings.value("serial/autoLogFileName", "yy-MM-dd_hhmmss.log").toString();
-    m_autoLogFilePath = settings.value("serial/autoLogFilePath", "").toString();
+    if (!m_autoLogKept)
+    {
+        m_autoLog.enabled = settings.value("serial/autoLog", false).toBool();
+        m_autoLog.overwrite = settings.value("serial/autoLogOverwrite", false).toBool();
+        m_autoLog.fileName = settings.value("serial/autoLogFileName", "yy-MM-dd_hhmmss.log").toString();
+        m_autoLog.filePath = settings.value("serial/autoLogFilePath", "").toString();
+        m_autoLog.capture = settings.value("serial/autoLogCapture", false).toBool();
+    }
+    m_autoLog.flushInterval_ms = settings.value("serial/autoLogFlushInterval_ms", 1000).toInt();
+    m_autoLog.flushSize = settings.value("serial/autoLogFlushSize_kB", 64).toLongLong() * 1024;
+    m_autoLog.syncOnClose = settings.value("serial/autoLogSyncOnClose", false).toBool();
+    setReadQueuePolicy(static_cast<readQueuePolicy_t>(settings.value("serial/readQueuePolicy", READ_QUEUE_block).toInt()));
 }
 
-QSerialPort *SerialThread::getSerialPort()
+PortBackend *SerialThread::getSerialPort()
 {
     Q_ASSERT(m_serialPort);
     return m_serialPort;
@@ -153,23 +688,65 @@ QSerialPort *SerialThread::getSerialPort()
  */
 qint64 SerialThread::write(QByteArray data, const QString& lineEnding)
 {
-    QMutexLocker mutexLocker(&m_mutex);
 //    qDebug() << __PRETTY_FUNCTION__ << "adding" << data.length () << "bytes";
     if (lineEnding.length())
     {
         data.replace(QString(NATIVE_LINEENDNG).toLocal8Bit(), lineEnding.toLocal8Bit());
     }
-    m_writeData.append(data);
-    m_command = CMD_write;
-    m_commandParam = 0;
-#if ALT_MODE == 0
-    m_commandEvent.wakeAll();
-#endif
-    int length = data.length();
-    m_writeDataLength += length;
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_write;
+    command->data = data;
+    command->length = data.length();
+    m_writePending += command->length;
+    pushCommand(command);
+    return data.length();
+}
+
+/**
+ * @brief SerialThread::writeFile
+ * Add file to queue. File is read in chunks while it is sent, so it is not
+ * loaded into memory.
+ *
+ * @param fileName Path of file to send.
+ * @return Size of file in bytes, -1 if file cannot be read.
+ */
+qint64 SerialThread::writeFile(const QString &fileName)
+{
+    QFileInfo fileInfo(fileName);
+    if (!fileInfo.isReadable())
+    {
+        return -1;
+    }
+    qint64 length = fileInfo.size();
+
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_write;
+    command->fileName = fileName;
+    command->length = length;
+    m_writePending += length;
+    pushCommand(command);
     return length;
 }
 
+/**
+ * @brief SerialThread::replay
+ * Replays a recorded session (binary capture, auto-log or raw byte dump)
+ * as received data. Port shall be closed.
+ *
+ * @param fileName Recorded session.
+ * @param speed 1.0: original speed, 2.0: double speed, etc. 0: as fast as
+ * possible.
+ */
+void SerialThread::replay(const QString &fileName, double speed)
+{
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_replay;
+    command->fileName = fileName;
+    command->speed = speed;
+    command->serialSettings = m_serialSettings->m_serialSettings;
+    pushCommand(command);
+}
+
 qint64 SerialThread::write(const char *data, qint64 len)
 {
     QByteArray data_array;
@@ -206,24 +783,54 @@ void SerialThread::setDelayAfterChr_ms(int delayAfterChr_ms, QByteArray chr)
     m_delayChr = chr;
 }
 
-void SerialThread::setLineEndingRx(const QString &lineEndingRx)
+/**
+ * @brief SerialThread::getDelayAfterBytes_us
+ * @return Sub-millisecond part of delay after bytes (0..999 us). It is added to
+ * getDelayAfterBytes_ms().
+ */
+int SerialThread::getDelayAfterBytes_us() const
 {
-    m_lineEndingRx = lineEndingRx;
-    m_lineEndingRxBA = m_lineEndingRx.toLocal8Bit();
+    return m_delayAfterBytes_us;
 }
 
-QString SerialThread::lineEndingRx() const
+void SerialThread::setDelayAfterBytes_us(int delayAfterBytes_us)
 {
-    return m_lineEndingRx;
+    m_delayAfterBytes_us = delayAfterBytes_us;
 }
 
-void SerialThread::setLineEndingTx(const QString &lineEndingTx)
+/**
+ * @brief SerialThread::getDelayAfterChr_us
+ * @return Sub-millisecond part of delay after delay character (0..999 us). It is
+ * added to getDelayAfterChr_ms().
+ */
+int SerialThread::getDelayAfterChr_us() const
 {
-    m_lineEndingTx = lineEndingTx;
-    m_lineEndingTxBA = m_lineEndingTx.toLocal8Bit();
+    return m_delayAfterChr_us;
 }
 
-QString SerialThread::lineEndingTx() const
+void SerialThread::setDelayAfterChr_us(int delayAfterChr_us)
+{
+    m_delayAfterChr_us = delayAfterChr_us;
+}
+
+void SerialThread::setLineEndingRx(const QString &lineEndingRx)
+{
+    m_lineEndingRx = lineEndingRx;
+    m_lineEndingRxBA = m_lineEndingRx.toLocal8Bit();
+}
+
+QString SerialThread::lineEndingRx() const
+{
+    return m_lineEndingRx;
+}
+
+void SerialThread::setLineEndingTx(const QString &lineEndingTx)
+{
+    m_lineEndingTx = lineEndingTx;
+    m_lineEndingTxBA = m_lineEndingTx.toLocal8Bit();
+}
+
+QString SerialThread::lineEndingTx() const
 {
     return m_lineEndingTx;
 }
@@ -236,36 +843,56 @@ void SerialThread::setPortName(const QString &name)
 
 QString SerialThread::portName()
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->portName();
+    QMutexLocker mutexLocker(&m_portStateMutex);
+    return m_portState.portName;
 }
 
 void SerialThread::setPort(const QSerialPortInfo &info)
 {
     QMutexLocker mutexLocker(&m_mutex);
-    m_serialPort->setPort(info);
+    m_serialPort->setPortName(info.portName());
 }
 
+/**
+ * @brief SerialThread::open
+ * Opens port with current settings. Port is opened by I/O thread, result
+ * is reported by portStatusChanged() or message().
+ *
+ * @return Always true.
+ */
 bool SerialThread::open(QIODevice::OpenMode mode) //Q_DECL_OVERRIDE
 {
-    QMutexLocker mutexLocker(&m_mutex);
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_open;
+    command->openMode = mode;
+    /* Settings are changed by this thread only, I/O thread gets a copy */
+    command->serialSettings = m_serialSettings->m_serialSettings;
+    /* Auto-log settings may have been changed */
     loadSettings();
-    m_command = CMD_open;
-    m_commandParam = mode;
-#if ALT_MODE == 0
-    m_commandEvent.wakeAll();
-#endif
+    command->autoLog = m_autoLog;
+    pushCommand(command);
     return true;
 }
 
 void SerialThread::close() //Q_DECL_OVERRIDE
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    m_command = CMD_close;
-    m_commandParam = 0;
-#if ALT_MODE == 0
-    m_commandEvent.wakeAll();
-#endif
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_close;
+    pushCommand(command);
+}
+
+/**
+ * @brief SerialThread::reconfigure
+ * Applies current settings (baud rate, data bits, parity, stop bits and flow
+ * control) to the opened port without reopening it. Port name is not
+ * changed.
+ */
+void SerialThread::reconfigure()
+{
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_reconfigure;
+    command->serialSettings = m_serialSettings->m_serialSettings;
+    pushCommand(command);
 }
 
 bool SerialThread::setBaudRate(qint32 baudRate, QSerialPort::Directions directions)
@@ -295,8 +922,10 @@ bool SerialThread::setBaudRate(qint32 baudRate, QSerialPort::Directions directio
 
 qint32 SerialThread::baudRate(QSerialPort::Directions directions)
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->baudRate(directions);
+    /* Input and output baud rates are the same */
+    Q_UNUSED(directions);
+    QMutexLocker mutexLocker(&m_portStateMutex);
+    return m_portState.baudRate;
 }
 
 bool SerialThread::setDataBits(QSerialPort::DataBits dataBits)
@@ -309,8 +938,8 @@ bool SerialThread::setDataBits(QSerialPort::DataBits dataBits)
 
 QSerialPort::DataBits SerialThread::dataBits()
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->dataBits();
+    QMutexLocker mutexLocker(&m_portStateMutex);
+    return m_portState.dataBits;
 }
 
 bool SerialThread::setParity(QSerialPort::Parity parity)
@@ -323,15 +952,15 @@ bool SerialThread::setParity(QSerialPort::Parity parity)
 
 QSerialPort::Parity SerialThread::parity()
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->parity();
+    QMutexLocker mutexLocker(&m_portStateMutex);
+    return m_portState.parity;
 }
 
 QString SerialThread::parityStr()
 {
     QString str;
 
-    switch (m_serialPort->parity())
+    switch (parity())
     {
         case QSerialPort::NoParity:
             str = tr("None");
@@ -366,8 +995,8 @@ bool SerialThread::setStopBits(QSerialPort::StopBits stopBits)
 
 QSerialPort::StopBits SerialThread::stopBits()
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->stopBits();
+    QMutexLocker mutexLocker(&m_portStateMutex);
+    return m_portState.stopBits;
 }
 
 bool SerialThread::setFlowControl(QSerialPort::FlowControl flowControl)
@@ -380,15 +1009,15 @@ bool SerialThread::setFlowControl(QSerialPort::FlowControl flowControl)
 
 QSerialPort::FlowControl SerialThread::flowControl()
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->flowControl();
+    QMutexLocker mutexLocker(&m_portStateMutex);
+    return m_portState.flowControl;
 }
 
 QString SerialThread::flowControlStr()
 {
     QString str;
 
-    switch (m_serialPort->flowControl())
+    switch (flowControl())
     {
         case QSerialPort::NoFlowControl:
             str = tr("No handshake");
@@ -407,379 +1036,1812 @@ QString SerialThread::flowControlStr()
     return str;
 }
 
+/**
+ * @brief SerialThread::setDataTerminalReady
+ * Sets DTR line after the data written before is sent.
+ *
+ * @return Always true, error is reported by error() signal.
+ */
 bool SerialThread::setDataTerminalReady(bool set)
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->setDataTerminalReady(set);
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_setLines;
+    command->line = QSerialPort::DataTerminalReadySignal;
+    command->set = set;
+    pushCommand(command);
+    return true;
 }
 
 bool SerialThread::isDataTerminalReady()
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->isDataTerminalReady();
+    QMutexLocker mutexLocker(&m_portStateMutex);
+    return m_portState.dataTerminalReady;
 }
 
+/**
+ * @brief SerialThread::setRequestToSend
+ * Sets RTS line after the data written before is sent.
+ *
+ * @return Always true, error is reported by error() signal.
+ */
 bool SerialThread::setRequestToSend(bool set)
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->setRequestToSend(set);
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_setLines;
+    command->line = QSerialPort::RequestToSendSignal;
+    command->set = set;
+    pushCommand(command);
+    return true;
 }
 
 bool SerialThread::isRequestToSend()
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->isRequestToSend();
+    QMutexLocker mutexLocker(&m_portStateMutex);
+    return m_portState.requestToSend;
 }
 
 QSerialPort::PinoutSignals SerialThread::pinoutSignals()
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->pinoutSignals();
+    QMutexLocker mutexLocker(&m_portStateMutex);
+    return m_portState.pinoutSignals;
 }
 
 QString SerialThread::errorString()
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->errorString();
+    QMutexLocker mutexLocker(&m_portStateMutex);
+    return m_portState.errorString;
 }
 
 bool SerialThread::isOpen()
 {
-    QMutexLocker mutexLocker(&m_mutex);
-    return m_serialPort->isOpen();
+    return m_portOpen;
 }
 
-QByteArray SerialThread::readAll(int timeout)
+/**
+ * @brief SerialThread::readAll
+ * Copies and removes all received data.
+ */
+QByteArray SerialThread::readAll()
 {
-    QByteArray data;
-    if (timeout == 0)
-    {
-        QMutexLocker mutexLocker(&m_mutex);
-        data = m_readData;
-        m_readData.clear();
-    }
-    else
+    discardReadData();
+    QByteArray data = m_readBuffer.readAll();
+    releaseReadBuffer();
+    return data;
+}
+
+/**
+ * @brief SerialThread::peekReadData
+ * Gets received data without copying it. The data is valid until
+ * consumeReadData() is called. Call it repeatedly to get all data, because
+ * the data can be split at the end of the receive buffer.
+ * If arrivalTime is requested, data is also split where arrival time changes.
+ *
+ * @param data Pointer to received data.
+ * @param arrivalTime If not NULL: time when data was read from the port.
+ * @return Length of data in bytes, 0 if no data received.
+ */
+qint64 SerialThread::peekReadData(const char **data, arrivalTime_t *arrivalTime)
+{
+    discardReadData();
+    qint64 len = m_readBuffer.readRegion(data);
+    if (arrivalTime && len > 0)
     {
-        if (m_mutex.tryLock(timeout))
+        quint64 offset = m_readBuffer.readOffset();
+        quint64 chunkEnd;
+        if (!m_arrivalTimes.lookup(offset, arrivalTime, &chunkEnd))
         {
-            data = m_readData;
-            m_readData.clear();
-            m_mutex.unlock();
+            arrivalTime->offset = offset;
+            arrivalTime->monotonic_ns = monotonicTime_ns();
+            arrivalTime->wallClock_ms = QDateTime::currentMSecsSinceEpoch();
+            arrivalTime->transmitted = false;
         }
-        else
+        if (chunkEnd - offset < static_cast<quint64>(len))
         {
-          qDebug() << __FUNCTION__ << "timeout";
+            len = static_cast<qint64>(chunkEnd - offset);
         }
     }
-    return data;
+    return len;
 }
 
-void SerialThread::recreatePort()
+/**
+ * @brief SerialThread::consumeReadData
+ * Removes data which was got by peekReadData().
+ *
+ * @param len Number of bytes processed.
+ */
+void SerialThread::consumeReadData(qint64 len)
 {
-  /* On MingW32/Win7 serial port's handle cannot be reused.
-   * "The handle is invalid" error occurs.
-   */
-  delete m_serialPort;
-  m_serialPort = new QSerialPort;
-  Q_ASSERT(m_serialPort);
+    m_readBuffer.consume(len);
+    releaseReadBuffer();
+}
 
-  if (!m_serialPort)
-  {
-    qCritical() << __PRETTY_FUNCTION__ << "not enough memory";
-    m_running = false;
-  }
-  else
-  {
-    MY_ASSERT(connect(m_serialPort, SIGNAL(error(QSerialPort::SerialPortError)), this,
-                      SIGNAL(error(QSerialPort::SerialPortError))));
-  }
+/**
+ * @brief SerialThread::bytesAvailable
+ * @return Fill level of the receive buffer.
+ */
+qint64 SerialThread::bytesAvailable() const
+{
+    return m_readBuffer.size();
 }
 
-void SerialThread::enableAutoLog(bool enable)
+qint64 SerialThread::readBufferSize() const
 {
-    m_autoLogIsEnabled = enable;
-    qDebug() << __PRETTY_FUNCTION__ << enable;
+    return m_readBuffer.capacity();
 }
 
-bool SerialThread::isAutoLogEnabled()
+/**
+ * @brief SerialThread::bytesToWrite
+ * @return Queued data which is not sent yet.
+ */
+qint64 SerialThread::bytesToWrite()
 {
-    return m_autoLogIsEnabled;
+    /* Counters are atomic, sum may be slightly off while data is sent */
+    return m_writePending + m_writeDataLength - m_writeDataSent;
 }
 
-void SerialThread::startLogging()
+/**
+ * @brief SerialThread::bytesReceived
+ * @return Number of bytes received since thread was created. Can be called
+ * from any thread.
+ */
+quint64 SerialThread::bytesReceived() const
 {
-    if (m_autoLogIsEnabled)
-    {
-        QString fileName;
-        QDateTime now = QDateTime::currentDateTime();
-        fileName = now.toString(m_autoLogFileName);
-        qDebug() << "log file name" << fileName;
-        QString filePath = QDir::cleanPath(m_autoLogFilePath + QDir::separator() + fileName);
-        m_logFile.setFileName(filePath);
-        qDebug() << "log file path" << filePath;
+    return m_bytesReceived.load(std::memory_order_relaxed);
+}
 
-        QIODevice::OpenModeFlag openModeFlag;
-        if (m_autoLogOverwriteIsEnabled)
-        {
-            openModeFlag = QIODevice::WriteOnly;
-            qDebug() << __FUNCTION__ << "overwrite";
-        }
-        else
-        {
-            openModeFlag = QIODevice::Append;
-            qDebug() << __FUNCTION__ << "append";
-        }
+/**
+ * @brief SerialThread::bytesSent
+ * @return Number of bytes sent since thread was created. Can be called from
+ * any thread.
+ */
+quint64 SerialThread::bytesSent() const
+{
+    return m_bytesSent.load(std::memory_order_relaxed);
+}
 
-        if (m_logFile.open(openModeFlag))
-        {
-            QString str;
-            str = tr("Start logging on %1, serial port %2").arg(getTimestamp().trimmed()).arg(m_serialSettings->toString()) + m_lineEndingRx;
-            m_logFile.write(str.toLocal8Bit());
-        }
+/**
+ * @brief SerialThread::acknowledgeReadyRead
+ * Consumer shall call it on readyRead() before it reads data. Until then new
+ * data does not emit readyRead() again, so at most one signal is queued.
+ */
+void SerialThread::acknowledgeReadyRead()
+{
+    m_readyReadPending.store(false);
+    /* Pairs with fence in notifyReadyRead(): either consumer sees the new
+     * data or I/O thread sees the flag cleared */
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+}
+
+qint64 SerialThread::readyReadInterval_us() const
+{
+    return m_readyReadInterval_us;
+}
+
+/**
+ * @brief SerialThread::setReadyReadInterval_us
+ * @param interval_us Minimum time between readyRead() signals, usually one
+ * display frame. 0: signal is emitted whenever consumer is ready.
+ */
+void SerialThread::setReadyReadInterval_us(qint64 interval_us)
+{
+    m_readyReadInterval_us = qMax<qint64>(interval_us, 0);
+}
+
+/**
+ * @brief SerialThread::notifyReadyRead
+ * Emits readyRead() after data was put to the receive buffer. Nothing is
+ * emitted while previous signal is not acknowledged. If the link was quiet
+ * for an interval the signal is emitted immediately, otherwise it is
+ * deferred to the end of the interval and flushReadyRead() emits it.
+ *
+ * @param force Emit without waiting for the interval.
+ */
+void SerialThread::notifyReadyRead(bool force)
+{
+    std::atomic_thread_fence(std::memory_order_seq_cst);
+    if (m_readyReadPending.load())
+    {
+        /* Consumer will read everything put to buffer so far */
+        return;
     }
-    else
+    qint64 now_ns = monotonicTime_ns();
+    qint64 due_ns = m_readyReadTime_ns + m_readyReadInterval_us * 1000;
+    if (force || m_readyReadTime_ns < 0 || now_ns >= due_ns)
     {
-        qDebug() << __FUNCTION__ << "auto log disabled";
+        m_readyReadDeferred = false;
+        m_readyReadTime_ns = now_ns;
+        m_readyReadPending.store(true);
+        emit readyRead();
+    }
+    else if (!m_readyReadDeferred)
+    {
+        m_readyReadDeferred = true;
+#if ALT_MODE == 0
+        armTimer(due_ns);
+#endif
+    }
+}
+
+/**
+ * @brief SerialThread::flushReadyRead
+ * Emits deferred readyRead() when its interval elapsed. On Linux it is
+ * called on timer expiry, otherwise periodically by the thread.
+ */
+void SerialThread::flushReadyRead()
+{
+    if (m_readyReadDeferred)
+    {
+        m_readyReadDeferred = false;
+        notifyReadyRead();
     }
 }
 
-void SerialThread::writeLog(QByteArray &byteArray, bool read)
+/**
+ * @brief SerialThread::updatePinoutSignals
+ * Reports new state of pinout signals if it changed. Mutex shall be locked.
+ *
+ * @param pinoutSignals Current state.
+ * @param monotonic_ns Time of change.
+ */
+void SerialThread::updatePinoutSignals(QSerialPort::PinoutSignals pinoutSignals, qint64 monotonic_ns)
 {
-    if (m_autoLogIsEnabled)
+    if (pinoutSignals != m_pinoutSignals)
     {
-        int len = byteArray.length();
-        for (int i = 0; i < len; i++)
+        emit pinoutSignalsChanged(pinoutSignals);
+        m_pinoutSignals = pinoutSignals;
         {
-            if (!m_logColumnIdx)
-            {
-                m_logFile.flush(); // TODO configurable parameter?
-                m_logFile.write(getTimestamp().toLocal8Bit());
-            }
-            char c = byteArray[i];
-            m_logFile.write(&c, 1);
-            m_logColumnIdx++;
-            if (read && c == m_lineEndingRxBA.right(1)[0])
-            {
-                m_logColumnIdx = 0;
-            }
-            else if (!read && c == m_lineEndingTxBA.right(1)[0])
-            {
-                m_logColumnIdx = 0;
-            }
+            QMutexLocker mutexLocker(&m_portStateMutex);
+            m_portState.pinoutSignals = pinoutSignals;
         }
+        m_captureWriter.writeLineEvent(static_cast<quint32>(pinoutSignals), monotonic_ns);
     }
 }
 
-void SerialThread::stopLogging()
+/**
+ * @brief SerialThread::measureRoundTrip
+ * Data received after sending: time since the last write is the response
+ * time of the device, including adapter and driver latency.
+ *
+ * @param received_ns Monotonic time of reception.
+ */
+void SerialThread::measureRoundTrip(qint64 received_ns)
 {
-    if (m_logFile.isOpen())
+    if (m_lastWrite_ns >= 0)
     {
-        QString str;
-        str = tr("Stop logging on %1, serial port %2").arg(getTimestamp().trimmed()).arg(m_serialSettings->toString()) + m_lineEndingRx;
-        m_logFile.write(str.toLocal8Bit());
-        m_logFile.close();
+        m_roundTrip_ns = received_ns - m_lastWrite_ns;
+        m_lastWrite_ns = -1;
     }
 }
 
-void SerialThread::abortSend()
+/**
+ * @brief SerialThread::roundTripTime_us
+ * @return Time between last sending and the response, -1 if not measured
+ * yet. Can be called from any thread.
+ */
+qint64 SerialThread::roundTripTime_us() const
 {
-    qDebug() << __FUNCTION__;
-    QMutexLocker mutexLocker(&m_mutex);
-    m_writeData.clear();
+    qint64 roundTrip_ns = m_roundTrip_ns;
+    return roundTrip_ns >= 0 ? roundTrip_ns / 1000 : -1;
 }
 
-void SerialThread::processCommand()
+SerialThread::readQueuePolicy_t SerialThread::readQueuePolicy() const
 {
-    bool progressSent = false;
-    const int progressLimit_ms = 2000; /* 2 seconds */
-    float progress_percent = 0.0f;
+    return static_cast<readQueuePolicy_t>(m_readQueuePolicy.load());
+}
 
-    if (m_command == CMD_write)
+/**
+ * @brief SerialThread::setReadQueuePolicy
+ * @param policy What happens to received data when the receive buffer is
+ * full. Data already in overflow is kept until it is put to the buffer.
+ */
+void SerialThread::setReadQueuePolicy(SerialThread::readQueuePolicy_t policy)
+{
+    if (policy < READ_QUEUE_block || policy > READ_QUEUE_spill)
     {
-        progress_percent = 0.0f;
-        if (m_writeData.length())
-        {
-            if (m_writeDataLength * m_delayAfterBytes_ms >= progressLimit_ms)
-            {
-                progressSent = true;
-                emit progress(QString(tr("Sending %1 bytes")).arg(m_writeDataLength), progress_percent);
-            }
-            /* Send data while thread should run */
-            //qDebug() << __PRETTY_FUNCTION__ << m_writeData.length() << m_running << m_serialPort->isOpen() << m_serialPort->isWritable();
-            while (m_writeData.length() > 0 && m_running && m_serialPort->isOpen() && m_serialPort->isWritable())
-            {
-                QByteArray c = m_writeData.left(1);
-                m_writeData.remove(0, 1);
-                m_mutex.unlock();
-                //qDebug() << __PRETTY_FUNCTION__ << "sending" << c;
-                writeLog(c, false);
-                m_serialPort->write(c);
-                m_serialPort->flush();
-                m_writeDataSent++;
-                progress_percent = 100.0f * m_writeDataSent / m_writeDataLength;
-                if (m_writeDataLength * m_delayAfterBytes_ms >= progressLimit_ms)
-                {
-                    progressSent = true;
-                    emit progress(QString(tr("%1 bytes of %2 bytes sent")).arg(m_writeDataSent).arg(m_writeDataLength), progress_percent);
-                }
-                /* Character sent, delay for specified time. Meanwhile check if
-                 * data can be received.
-                 */
-                int delay_ms = 0;
-                if (m_delayChr.length() > 0 && c == m_delayChr)
-                {
-                    delay_ms = m_delayAfterChr_ms;
-                }
-                else
-                {
-                    delay_ms = m_delayAfterBytes_ms;
-                }
-                //qDebug() << __PRETTY_FUNCTION__ << "delay_ms" << delay_ms;
-                QElapsedTimer timer;
-                int elapsed_ms;
-                timer.start();
-                /* Check if data can be received and measure time of
-                 * operation. waitForReadyRead() can block running
-                 * up to delay_ms time.
-                 */
-                if (delay_ms && m_serialPort->waitForReadyRead(delay_ms))
-                {
-                    m_mutex.lock();
-                    QByteArray byteArray = m_serialPort->readAll();
-                    writeLog(byteArray, true);
-                    m_readData.append(byteArray);
-                    m_mutex.unlock();
-                    emit readyRead();
-                }
-                elapsed_ms = timer.elapsed();
-                //qDebug() << __PRETTY_FUNCTION__ << "elapsed_ms" << elapsed_ms;
-                if (elapsed_ms < delay_ms)
-                {
-                    /* Not enough time elapsed, another delay needed */
-                    msleep (delay_ms - elapsed_ms);
-                }
-                m_mutex.lock();
-            }
-            if (progressSent)
-            {
-                emit progress(QString(tr("%1 bytes sent")).arg(m_writeDataSent), 100.0f);
-            }
-            emit finish();
-            m_writeDataSent = 0;
-            m_writeDataLength = 0;
-        }
-        m_command = CMD_undefined;
+        policy = READ_QUEUE_block;
     }
-    else if (m_command == CMD_open)
+    if (m_readQueuePolicy.exchange(policy) != policy)
     {
-        stopLogging();
-        if (m_serialPort->isOpen())
-        {
-            qDebug() << __FUNCTION__ << "port already opened! closing";
-            m_serialPort->close();
-            emit portStatusChanged(false);
-            msleep(500);
-        }
-        if (!m_serialPort->isOpen())
-        {
-            bool isOpened;
-#if WINDOWS
-            /* Workaround for Windows */
-            m_serialPort->setPortName(m_serialSettings->m_serialSettings.name);
-            isOpened = m_serialPort->open(static_cast<QSerialPort::OpenMode>(m_commandParam));
-            if (isOpened)
-            {
-                m_serialPort->close();
-                msleep(50);
-                recreatePort();
-                msleep(50);
-            }
-#endif
-            qDebug() << __FUNCTION__ << m_serialSettings->toString();
-            m_serialPort->setPortName(m_serialSettings->m_serialSettings.name);
-            isOpened = m_serialPort->open(static_cast<QSerialPort::OpenMode>(m_commandParam));
-            if (isOpened)
-            {
-                startLogging();
-                // Parameters shall be set after open on Qt 5.3!
-#if WINDOWS
-                m_serialPort->setBaudRate(m_serialSettings->m_serialSettings.baudRate);
-#else
-                // buggy on Windows 10 with PL2303 (not sure which one is guilty)
-                // m_serialPort->setBaudRate(m_baudRateOutput, QSerialPort::Output);
-                // m_serialPort->setBaudRate(m_baudRateInput, QSerialPort::Input);
-                m_serialPort->setBaudRate(m_serialSettings->m_serialSettings.baudRate);
+#if ALT_MODE == 0
+        /* Reading of port may have to be started */
+        wakeup();
 #endif
-                m_serialPort->setDataBits(m_serialSettings->m_serialSettings.dataBits);
-                m_serialPort->setParity(m_serialSettings->m_serialSettings.parity);
-                m_serialPort->setStopBits(m_serialSettings->m_serialSettings.stopBits);
-                m_serialPort->setFlowControl(m_serialSettings->m_serialSettings.flowControl);
-                emit portStatusChanged(true);
-            }
-            else
-            {
-                emit message(tr("Cannot open port!"), true);
-                qCritical() << __PRETTY_FUNCTION__ << "cannot open port!";
-            }
-        }
-        else
-        {
-            qDebug() << __PRETTY_FUNCTION__ << "port already opened!";
-        }
-        m_command = CMD_undefined;
-    }
-    else if (m_command == CMD_close || m_command == CMD_stop)
-    {
-        stopLogging();
-        if (m_serialPort->isOpen())
-        {
-            m_serialPort->close();
-            emit portStatusChanged(false);
-        }
-        m_command = CMD_undefined;
-    }
-    else if (m_command == CMD_undefined)
-    {
-        emit message(tr("Undefined command!"), true);
-        qDebug() << __PRETTY_FUNCTION__ << "undefined command";
-    }
-    else
-    {
-        emit message(tr("Unknown command!"), true);
-        qCritical() << __PRETTY_FUNCTION__ << "unknown command:" << (int)m_command;
-        Q_ASSERT(0);
     }
 }
 
-QString SerialThread::autoLogFilePath() const
+/**
+ * @brief SerialThread::readOverflowSize
+ * @return Received data waiting outside of the receive buffer.
+ */
+qint64 SerialThread::readOverflowSize() const
 {
-    return m_autoLogFilePath;
+    return m_readOverflowSize;
 }
 
-void SerialThread::setAutoLogFilePath(const QString &newAutoLogFilePath)
+/**
+ * @brief SerialThread::bytesDropped
+ * @return Number of received bytes which were not displayed because of
+ * READ_QUEUE_dropOldest policy or spill file error.
+ */
+quint64 SerialThread::bytesDropped() const
 {
-    m_autoLogFilePath = newAutoLogFilePath;
+    return m_bytesDropped.load(std::memory_order_relaxed);
 }
 
-QString SerialThread::autoLogFileName() const
+/**
+ * @brief SerialThread::bytesSpilled
+ * @return Number of received bytes which went through the spill file.
+ */
+quint64 SerialThread::bytesSpilled() const
 {
-    return m_autoLogFileName;
+    return m_bytesSpilled.load(std::memory_order_relaxed);
 }
 
-void SerialThread::setAutoLogFileName(const QString &newAutoLogFileName)
+/**
+ * @brief SerialThread::overflowReadData
+ * Stores received data which does not fit into the receive buffer. With
+ * READ_QUEUE_dropOldest the consumer is asked to drop the whole backlog of
+ * receive buffer, so it continues with the newest data.
+ */
+void SerialThread::overflowReadData(const char *data, qint64 len, qint64 monotonic_ns, qint64 wallClock_ms)
 {
-    m_autoLogFileName = newAutoLogFileName;
+    bool spill = (readQueuePolicy() == READ_QUEUE_spill);
+
+    if (m_readOverflow.isEmpty())
+    {
+        m_readOverflow.setStore(spill ? ReadOverflow::STORE_FILE : ReadOverflow::STORE_MEMORY,
+                                m_readBuffer.capacity());
+    }
+    m_readOverflow.append(data, len, monotonic_ns, wallClock_ms);
+    if (m_readOverflow.store() == ReadOverflow::STORE_FILE)
+    {
+        m_bytesSpilled.fetch_add(static_cast<quint64>(len), std::memory_order_relaxed);
+    }
+    else
+    {
+        m_readDiscardOffset.store(m_readBuffer.writeOffset());
+    }
+    qint64 dropped = m_readOverflow.takeDroppedBytes();
+    if (dropped)
+    {
+        m_bytesDropped.fetch_add(static_cast<quint64>(dropped), std::memory_order_relaxed);
+    }
+    m_readOverflowSize = m_readOverflow.size();
+    /* Consumer shall wake up the thread when it makes space */
+    m_readStalled = true;
 }
 
-QString SerialThread::getTimestamp() const
+/**
+ * @brief SerialThread::drainReadOverflow
+ * Moves data from overflow to the receive buffer as space allows.
+ */
+void SerialThread::drainReadOverflow()
 {
-    QDateTime now = QDateTime::currentDateTime();
-    return now.toString(m_timestampFormatString);
-}
+    const char *data;
+    qint64 monotonic_ns;
+    qint64 wallClock_ms;
+    qint64 len;
+    bool moved = false;
 
+    if (m_readOverflow.isEmpty())
+    {
+        return;
+    }
+    for (;;)
+    {
+        while ((len = m_readOverflow.peek(&data, &monotonic_ns, &wallClock_ms)) > 0)
+        {
+            char *region;
+            qint64 regionLen = m_readBuffer.writeRegion(&region);
+            if (regionLen == 0)
+            {
+                break;
+            }
+            regionLen = qMin(regionLen, len);
+            m_arrivalTimes.stamp(m_readBuffer.writeOffset(), monotonic_ns, wallClock_ms);
+            memcpy(region, data, static_cast<size_t>(regionLen));
+            m_readBuffer.commit(regionLen);
+            m_readOverflow.consume(regionLen);
+            moved = true;
+        }
+        if (m_readOverflow.isEmpty())
+        {
+            break;
+        }
+        m_readStalled = true;
+        /* Check again, consumer may have made space meanwhile */
+        if (m_readBuffer.freeSpace() == 0)
+        {
+            break;
+        }
+        m_readStalled = false;
+    }
+    qint64 dropped = m_readOverflow.takeDroppedBytes();
+    if (dropped)
+    {
+        m_bytesDropped.fetch_add(static_cast<quint64>(dropped), std::memory_order_relaxed);
+    }
+    m_readOverflowSize = m_readOverflow.size();
+    if (moved)
+    {
+        notifyReadyRead();
+    }
+}
+
+/**
+ * @brief SerialThread::discardReadData
+ * Consumer side of READ_QUEUE_dropOldest: drops data which the thread asked
+ * to drop.
+ */
+void SerialThread::discardReadData()
+{
+    quint64 discardOffset = m_readDiscardOffset.load();
+    quint64 readOffset = m_readBuffer.readOffset();
+
+    if (discardOffset > readOffset)
+    {
+        m_readBuffer.consume(static_cast<qint64>(discardOffset - readOffset));
+        m_bytesDropped.fetch_add(discardOffset - readOffset, std::memory_order_relaxed);
+        releaseReadBuffer();
+    }
+}
+
+void SerialThread::releaseReadBuffer()
+{
+    if (m_readStalled.exchange(false))
+    {
+#if ALT_MODE == 0
+        /* I/O loop stopped reading port because buffer was full */
+        wakeup();
+#endif
+    }
+}
+
+/**
+ * @brief SerialThread::readPortBuffer
+ * Moves data from QSerialPort's buffer to the receive buffer.
+ */
+void SerialThread::readPortBuffer()
+{
+    qint64 freeSpace = m_readOverflow.isEmpty() ? m_readBuffer.freeSpace() : 0;
+    if (freeSpace == 0 && readQueuePolicy() != READ_QUEUE_block)
+    {
+        QByteArray byteArray = m_serialPort->read(m_serialPort->bytesAvailable());
+        if (byteArray.length())
+        {
+            qint64 now_ms = QDateTime::currentMSecsSinceEpoch();
+            qint64 now_ns = monotonicTime_ns();
+            measureRoundTrip(now_ns);
+            writeLog(byteArray, true, now_ms, now_ns);
+            overflowReadData(byteArray.constData(), byteArray.length(), now_ns, now_ms);
+            m_bytesReceived.fetch_add(static_cast<quint64>(byteArray.length()), std::memory_order_relaxed);
+        }
+    }
+    else if (freeSpace == 0)
+    {
+        m_readStalled = true;
+    }
+    else
+    {
+        QByteArray byteArray = m_serialPort->read(freeSpace);
+        if (byteArray.length())
+        {
+            qint64 now_ms = QDateTime::currentMSecsSinceEpoch();
+            qint64 now_ns = monotonicTime_ns();
+            measureRoundTrip(now_ns);
+            m_arrivalTimes.stamp(m_readBuffer.writeOffset(), now_ns, now_ms);
+            writeLog(byteArray, true, now_ms, now_ns);
+            m_readBuffer.write(byteArray.constData(), byteArray.length());
+            m_bytesReceived.fetch_add(static_cast<quint64>(byteArray.length()), std::memory_order_relaxed);
+            notifyReadyRead();
+        }
+    }
+}
+
+#if ALT_MODE == 0
+/**
+ * @brief SerialThread::startReplay
+ * Opens recorded session, pumpReplay() feeds it to the receive buffer like
+ * received data, so it goes through readyRead(), MainWindow::readData() and
+ * Console::putData(). Chunks keep their recorded time, sent data of a
+ * capture is shown as sent. Mutex shall be locked.
+ */
+void SerialThread::startReplay(const QString &fileName, double speed, qint32 baudRate)
+{
+    if (m_serialPort->isOpen())
+    {
+        emit message(tr("Close port before replay!"), true);
+        return;
+    }
+    if (m_replay.source)
+    {
+        emit message(tr("Replay is already running!"), true);
+        return;
+    }
+    m_replay.source = new ReplaySource(fileName);
+    if (!m_replay.source->open(baudRate, m_timestampFormatter.format()))
+    {
+        emit message(tr("Cannot open file %1: %2").arg(fileName).arg(m_replay.source->errorString()), true);
+        delete m_replay.source;
+        m_replay.source = NULL;
+        return;
+    }
+    emit progress(tr("Replaying %1").arg(fileName), 0);
+    m_replay.fileName = fileName;
+    m_replay.speed = speed;
+    m_replay.chunkPending = false;
+    m_replay.chunkOffset = 0;
+    m_replay.firstTime_ns = -1;
+    m_replay.time_ns = 0;
+    m_replay.start_ns = monotonicTime_ns();
+    m_replay.fed_ns = 0;
+    m_replay.bytes = 0;
+    m_replay.draining = false;
+    m_replay.progressTimer.start();
+}
+
+/**
+ * @brief SerialThread::pumpReplay
+ * Feeds chunks of the recorded session until a chunk is not due yet or the
+ * receive buffer is full, then returns to the reactor. Replay is continued
+ * when the timer expires or the consumer makes space.
+ */
+void SerialThread::pumpReplay()
+{
+    const int progressInterval_ms = 100;
+    /* Other sessions are served after this many chunks */
+    const int maxBurst = 64;
+    ReplaySource *source = m_replay.source;
+    int chunks = 0;
+
+    if (!source)
+    {
+        return;
+    }
+    if (!m_running || m_abortSend)
+    {
+        finishReplay(false);
+        return;
+    }
+    while (!m_replay.draining)
+    {
+        if (chunks++ >= maxBurst)
+        {
+            armTimer(monotonicTime_ns());
+            return;
+        }
+        if (!m_replay.chunkPending)
+        {
+            if (!source->next(&m_replay.chunk))
+            {
+                m_replay.fed_ns = monotonicTime_ns();
+                m_replay.draining = true;
+                break;
+            }
+            m_replay.chunkPending = true;
+            m_replay.chunkOffset = 0;
+            if (m_replay.chunk.time_ns >= 0)
+            {
+                if (m_replay.firstTime_ns < 0)
+                {
+                    m_replay.firstTime_ns = m_replay.chunk.time_ns;
+                }
+                m_replay.time_ns = m_replay.chunk.time_ns - m_replay.firstTime_ns;
+            }
+        }
+        if (m_replay.speed > 0 && m_replay.firstTime_ns >= 0)
+        {
+            qint64 due_ns = m_replay.start_ns + static_cast<qint64>(m_replay.time_ns / m_replay.speed);
+            if (due_ns > monotonicTime_ns())
+            {
+                armTimer(due_ns);
+                return;
+            }
+        }
+        if (m_replay.chunk.type == CAPTURE_rx || m_replay.chunk.type == CAPTURE_tx)
+        {
+            const QByteArray &data = m_replay.chunk.data;
+            if (m_replay.chunkOffset == 0)
+            {
+                /* Console shows recorded time and direction */
+                qint64 wallClock_ms = m_replay.chunk.wallClock_ms >= 0 ? m_replay.chunk.wallClock_ms : QDateTime::currentMSecsSinceEpoch();
+                m_arrivalTimes.stamp(m_readBuffer.writeOffset(), monotonicTime_ns(), wallClock_ms, m_replay.chunk.type == CAPTURE_tx);
+            }
+            qint64 pushed = tryPushReadData(data.constData() + m_replay.chunkOffset, data.size() - m_replay.chunkOffset);
+            m_replay.chunkOffset += pushed;
+            m_replay.bytes += pushed;
+            if (m_replay.chunkOffset < data.size())
+            {
+                /* Receive buffer is full, consumer wakes up the session */
+                return;
+            }
+        }
+        else if (m_replay.chunk.type == CAPTURE_lineEvent && m_replay.chunk.data.size() >= 4)
+        {
+            quint32 pinoutSignals = qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(m_replay.chunk.data.constData()));
+            emit pinoutSignalsChanged(QSerialPort::PinoutSignals(pinoutSignals));
+        }
+        m_replay.chunkPending = false;
+        if (m_replay.progressTimer.elapsed() >= progressInterval_ms)
+        {
+            m_replay.progressTimer.restart();
+            emit progress(QString(), 100.0f * source->position() / qMax(source->size(), static_cast<qint64>(1)));
+        }
+    }
+
+    /* Wait until console processed all data */
+    if (m_readBuffer.size() > 0)
+    {
+        m_readStalled = true;
+        /* Check again, consumer may have emptied buffer meanwhile */
+        if (m_readBuffer.size() > 0)
+        {
+            return;
+        }
+        m_readStalled = false;
+    }
+    finishReplay(true);
+}
+
+/**
+ * @brief SerialThread::finishReplay
+ * Reports how long the console took to process the data and closes the
+ * recorded session.
+ *
+ * @param completed false: replay was aborted.
+ */
+void SerialThread::finishReplay(bool completed)
+{
+    ReplaySource *source = m_replay.source;
+    qint64 end_ns = monotonicTime_ns();
+
+    if (!source->errorString().isEmpty())
+    {
+        emit message(tr("Cannot read file %1: %2").arg(m_replay.fileName).arg(source->errorString()), true);
+    }
+    else if (completed)
+    {
+        qint64 total_ms = qMax((end_ns - m_replay.start_ns) / 1000000, static_cast<qint64>(1));
+        QString report = tr("Replayed %1 bytes in %2 ms (%3 kB/s), console finished %4 ms after last byte")
+                .arg(m_replay.bytes)
+                .arg(total_ms)
+                .arg(m_replay.bytes / total_ms)
+                .arg((end_ns - m_replay.fed_ns) / 1000000);
+        qDebug() << __PRETTY_FUNCTION__ << report;
+        emit message(report, false);
+    }
+    else
+    {
+        emit message(tr("Replay aborted"), false);
+    }
+    emit progress(QString(), 100.0f);
+    emit finish();
+    delete source;
+    m_replay.source = NULL;
+    m_replay.draining = false;
+}
+
+/**
+ * @brief SerialThread::tryPushReadData
+ * Puts data to the receive buffer like it was received from the port, as
+ * much as fits.
+ *
+ * @param data Data to put.
+ * @param len Length of data in bytes.
+ * @return Number of bytes put, less than len if buffer is full.
+ */
+qint64 SerialThread::tryPushReadData(const char *data, qint64 len)
+{
+    qint64 pushed = 0;
+
+    while (pushed < len)
+    {
+        char *region;
+        qint64 regionLen = m_readBuffer.writeRegion(&region);
+        if (regionLen == 0)
+        {
+            m_readStalled = true;
+            /* Check again, consumer may have made space meanwhile */
+            if (m_readBuffer.freeSpace() == 0)
+            {
+                break;
+            }
+            m_readStalled = false;
+            continue;
+        }
+        regionLen = qMin(regionLen, len - pushed);
+        memcpy(region, data + pushed, static_cast<size_t>(regionLen));
+        m_readBuffer.commit(regionLen);
+        m_bytesReceived.fetch_add(static_cast<quint64>(regionLen), std::memory_order_relaxed);
+        pushed += regionLen;
+    }
+    if (pushed)
+    {
+        notifyReadyRead();
+    }
+    return pushed;
+}
+#else
+/**
+ * @brief SerialThread::replayFile
+ * Feeds recorded session to the receive buffer like received data, so it
+ * goes through readyRead(), MainWindow::readData() and Console::putData().
+ * Chunks keep their recorded time, sent data of a capture is shown as sent.
+ * Reports how long the console took to process the data.
+ * Mutex shall be locked, it is unlocked while replaying.
+ */
+void SerialThread::replayFile(const QString &fileName, double speed, qint32 baudRate)
+{
+    const int progressInterval_ms = 100;
+
+    if (m_serialPort->isOpen())
+    {
+        emit message(tr("Close port before replay!"), true);
+        return;
+    }
+    m_mutex.unlock();
+
+    ReplaySource source(fileName);
+    if (!source.open(baudRate, m_timestampFormatter.format()))
+    {
+        emit message(tr("Cannot open file %1: %2").arg(fileName).arg(source.errorString()), true);
+        m_mutex.lock();
+        return;
+    }
+    emit progress(tr("Replaying %1").arg(fileName), 0);
+
+    replayChunk_t chunk;
+    qint64 bytes = 0;
+    qint64 firstTime_ns = -1;
+    qint64 time_ns = 0;
+    bool completed = true;
+    QElapsedTimer progressTimer;
+    qint64 start_ns = monotonicTime_ns();
+    progressTimer.start();
+    while (source.next(&chunk))
+    {
+        if (!m_running || m_abortSend)
+        {
+            completed = false;
+            break;
+        }
+        if (chunk.time_ns >= 0)
+        {
+            if (firstTime_ns < 0)
+            {
+                firstTime_ns = chunk.time_ns;
+            }
+            time_ns = chunk.time_ns - firstTime_ns;
+        }
+        if (speed > 0 && firstTime_ns >= 0)
+        {
+            waitUntil(start_ns + static_cast<qint64>(time_ns / speed));
+        }
+        if (chunk.type == CAPTURE_rx || chunk.type == CAPTURE_tx)
+        {
+            /* Console shows recorded time and direction */
+            qint64 wallClock_ms = chunk.wallClock_ms >= 0 ? chunk.wallClock_ms : QDateTime::currentMSecsSinceEpoch();
+            if (!pushReadData(chunk.data.constData(), chunk.data.size(), wallClock_ms, chunk.type == CAPTURE_tx))
+            {
+                completed = false;
+                break;
+            }
+            bytes += chunk.data.size();
+        }
+        else if (chunk.type == CAPTURE_lineEvent && chunk.data.size() >= 4)
+        {
+            quint32 pinoutSignals = qFromLittleEndian<quint32>(reinterpret_cast<const uchar *>(chunk.data.constData()));
+            emit pinoutSignalsChanged(QSerialPort::PinoutSignals(pinoutSignals));
+        }
+        if (progressTimer.elapsed() >= progressInterval_ms)
+        {
+            progressTimer.restart();
+            emit progress(QString(), 100.0f * source.position() / qMax(source.size(), static_cast<qint64>(1)));
+        }
+    }
+    qint64 fed_ns = monotonicTime_ns();
+    /* Wait until console processed all data */
+    if (completed)
+    {
+        completed = waitForReadBuffer(m_readBuffer.capacity());
+    }
+    qint64 end_ns = monotonicTime_ns();
+
+    if (!source.errorString().isEmpty())
+    {
+        emit message(tr("Cannot read file %1: %2").arg(fileName).arg(source.errorString()), true);
+    }
+    else if (completed)
+    {
+        qint64 total_ms = qMax((end_ns - start_ns) / 1000000, static_cast<qint64>(1));
+        QString report = tr("Replayed %1 bytes in %2 ms (%3 kB/s), console finished %4 ms after last byte")
+                .arg(bytes)
+                .arg(total_ms)
+                .arg(bytes / total_ms)
+                .arg((end_ns - fed_ns) / 1000000);
+        qDebug() << __PRETTY_FUNCTION__ << report;
+        emit message(report, false);
+    }
+    else
+    {
+        emit message(tr("Replay aborted"), false);
+    }
+    emit progress(QString(), 100.0f);
+    emit finish();
+    m_mutex.lock();
+}
+
+/**
+ * @brief SerialThread::pushReadData
+ * Puts data to the receive buffer like it was received from the port. If
+ * the buffer is full, it waits for the consumer.
+ *
+ * @param data Data to put.
+ * @param len Length of data in bytes.
+ * @param wallClock_ms Time shown on console.
+ * @param transmitted true: console shows data as sent.
+ * @return false: aborted.
+ */
+bool SerialThread::pushReadData(const char *data, qint64 len, qint64 wallClock_ms, bool transmitted)
+{
+    m_arrivalTimes.stamp(m_readBuffer.writeOffset(), monotonicTime_ns(), wallClock_ms, transmitted);
+    while (len > 0)
+    {
+        char *region;
+        qint64 regionLen = m_readBuffer.writeRegion(&region);
+        if (regionLen == 0)
+        {
+            /* Consumer shall make space without waiting for next frame */
+            notifyReadyRead(true);
+            if (!waitForReadBuffer(1))
+            {
+                return false;
+            }
+            continue;
+        }
+        regionLen = qMin(regionLen, len);
+        memcpy(region, data, static_cast<size_t>(regionLen));
+        m_readBuffer.commit(regionLen);
+        m_bytesReceived.fetch_add(static_cast<quint64>(regionLen), std::memory_order_relaxed);
+        data += regionLen;
+        len -= regionLen;
+    }
+    notifyReadyRead();
+    return true;
+}
+
+/**
+ * @brief SerialThread::waitForReadBuffer
+ * Waits until consumer makes space in the receive buffer.
+ *
+ * @param freeSpace Needed free space in bytes.
+ * @return false: aborted.
+ */
+bool SerialThread::waitForReadBuffer(qint64 freeSpace)
+{
+    while (m_readBuffer.freeSpace() < freeSpace)
+    {
+        if (!m_running || m_abortSend)
+        {
+            return false;
+        }
+        m_readStalled = true;
+        /* Check again, consumer may have made space meanwhile */
+        if (m_readBuffer.freeSpace() >= freeSpace)
+        {
+            m_readStalled = false;
+            break;
+        }
+        msleep(1);
+    }
+    return true;
+}
+#endif
+
+void SerialThread::recreatePort(const QString &name)
+{
+  /* On MingW32/Win7 serial port's handle cannot be reused.
+   * "The handle is invalid" error occurs.
+   * Backend also depends on port name: serial port, pty or simulated device.
+   */
+  delete m_serialPort;
+  m_serialPort = PortBackend::create(name);
+  Q_ASSERT(m_serialPort);
+
+  if (!m_serialPort)
+  {
+    qCritical() << __PRETTY_FUNCTION__ << "not enough memory";
+    m_running = false;
+  }
+  else
+  {
+    MY_ASSERT(connect(m_serialPort, SIGNAL(error(QSerialPort::SerialPortError)), this,
+                      SLOT(portError(QSerialPort::SerialPortError)), Qt::DirectConnection));
+#if ALT_MODE == 0
+    /* Port is used by reactor thread */
+    m_serialPort->moveToThread(IoReactor::instance());
+#endif
+  }
+}
+
+void SerialThread::enableAutoLog(bool enable)
+{
+    m_autoLog.enabled = enable;
+    qDebug() << __PRETTY_FUNCTION__ << enable;
+}
+
+bool SerialThread::isAutoLogEnabled()
+{
+    return m_autoLog.enabled;
+}
+
+void SerialThread::enableAutoLogCapture(bool enable)
+{
+    m_autoLog.capture = enable;
+    qDebug() << __PRETTY_FUNCTION__ << enable;
+}
+
+bool SerialThread::isAutoLogCaptureEnabled()
+{
+    return m_autoLog.capture;
+}
+
+/**
+ * @brief SerialThread::keepAutoLogSettings
+ * Keeps auto-log settings given by enableAutoLog(), setAutoLogFileName()
+ * etc., so open() does not reload them from settings. Used when log file is
+ * given on command line.
+ */
+void SerialThread::keepAutoLogSettings(bool keep)
+{
+    m_autoLogKept = keep;
+}
+
+/**
+ * @brief SerialThread::startLogging
+ * Opens log and capture files. Called by I/O thread, uses m_autoLogIo.
+ */
+void SerialThread::startLogging()
+{
+    if (m_autoLogIo.enabled)
+    {
+        QString fileName;
+        QDateTime now = QDateTime::currentDateTime();
+        fileName = now.toString(m_autoLogIo.fileName);
+        qDebug() << "log file name" << fileName;
+        QString filePath = QDir::cleanPath(m_autoLogIo.filePath + QDir::separator() + fileName);
+        qDebug() << "log file path" << filePath;
+        qDebug() << __FUNCTION__ << (m_autoLogIo.overwrite ? "overwrite" : "append");
+
+        m_logWriter.setTimestampFormatString(m_timestampFormatter.format());
+        m_logWriter.setLineEnding(m_lineEndingRxBA, m_lineEndingTxBA);
+        if (m_logWriter.open(filePath, m_autoLogIo.overwrite))
+        {
+            QString str;
+            str = tr("Start logging on %1, serial port %2").arg(getTimestamp().trimmed()).arg(m_serialSettings->toString()) + m_lineEndingRx;
+            m_logWriter.writeText(str.toLocal8Bit());
+        }
+        else
+        {
+            emit message(tr("Cannot open log file: %1").arg(m_logWriter.errorString()), true);
+        }
+
+        if (m_autoLogIo.capture)
+        {
+            QFileInfo fileInfo(filePath);
+            QString capturePath = QDir::cleanPath(fileInfo.path() + QDir::separator() + fileInfo.completeBaseName() + ".iscap");
+            qDebug() << "capture file path" << capturePath;
+            if (!m_captureWriter.open(capturePath, QDateTime::currentMSecsSinceEpoch(), monotonicTime_ns()))
+            {
+                emit message(tr("Cannot open capture file: %1").arg(m_captureWriter.errorString()), true);
+            }
+        }
+    }
+    else
+    {
+        qDebug() << __FUNCTION__ << "auto log disabled";
+    }
+}
+
+/**
+ * @brief SerialThread::writeLog
+ * Queues data to the log writer thread, so logging does not delay sending
+ * and receiving. Data is also added to the binary capture.
+ *
+ * @param byteArray Received or sent data.
+ * @param read true: data was received, false: data was sent.
+ * @param timestamp_ms Time when data was read/sent, -1: now.
+ * @param monotonic_ns Monotonic time when data was read/sent, -1: now.
+ */
+void SerialThread::writeLog(const QByteArray &byteArray, bool read, qint64 timestamp_ms, qint64 monotonic_ns)
+{
+    if (m_autoLogIo.enabled && m_logWriter.isOpen())
+    {
+        if (timestamp_ms < 0)
+        {
+            timestamp_ms = QDateTime::currentMSecsSinceEpoch();
+        }
+        m_logWriter.write(byteArray, read, timestamp_ms);
+    }
+    if (m_captureWriter.isOpen())
+    {
+        if (monotonic_ns < 0)
+        {
+            monotonic_ns = monotonicTime_ns();
+        }
+        m_captureWriter.write(read ? CAPTURE_rx : CAPTURE_tx, byteArray.constData(), byteArray.size(), monotonic_ns);
+    }
+}
+
+void SerialThread::stopLogging()
+{
+    m_captureWriter.close();
+    if (m_logWriter.isOpen())
+    {
+        QString str;
+        str = tr("Stop logging on %1, serial port %2").arg(getTimestamp().trimmed()).arg(m_serialSettings->toString()) + m_lineEndingRx;
+        m_logWriter.writeText(str.toLocal8Bit());
+        m_logWriter.close();
+    }
+}
+
+/**
+ * @brief SerialThread::abortSend
+ * Stops sending and replay. Data written before this call is dropped, even
+ * if its command is not executed yet.
+ */
+void SerialThread::abortSend()
+{
+    qDebug() << __FUNCTION__;
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_abort;
+    /* Running send loop stops at once, CMD_abort clears the flag */
+    m_abortSend = true;
+    pushCommand(command);
+}
+
+#if ALT_MODE == 0
+/**
+ * @brief SerialThread::pumpSend
+ * Sends queued data until the output buffer of the port is full or a delay
+ * is needed, then returns to the reactor. Sending is continued on EPOLLOUT
+ * or when the timer expires. Data is sent in large slices; it is split only
+ * where a delay is needed.
+ */
+void SerialThread::pumpSend()
+{
+    const int progressLimit_ms = 2000; /* 2 seconds */
+    const int progressInterval_ms = 100;
+    /* Other sessions are served after this many bytes */
+    const qint64 maxBurst = 256 * 1024;
+    qint64 burst = 0;
+
+    if (!m_abortSend)
+    {
+        if (m_send.blocked)
+        {
+            return;
+        }
+        if (m_send.resume_ns > monotonicTime_ns())
+        {
+            /* Timer may have been re-armed for an earlier deadline */
+            armTimer(m_send.resume_ns);
+            return;
+        }
+    }
+    m_send.resume_ns = 0;
+    for (;;)
+    {
+        if (!m_send.job)
+        {
+            QMutexLocker mutexLocker(&m_mutex);
+            if (m_writeJobs.isEmpty() || !m_running || m_abortSend || m_portFd < 0 || !m_serialPort->isWritable())
+            {
+                if (m_send.active || !m_writeJobs.isEmpty())
+                {
+                    finishSend();
+                }
+                return;
+            }
+            /* Take the first job, so later writes can be appended while it is sent */
+            m_send.job = m_writeJobs.takeFirst();
+            m_send.offset = 0;
+            m_send.spanRemaining = 0;
+            m_send.deadline_ns = 0;
+            if (!m_send.active)
+            {
+                m_send.active = true;
+                m_send.progressTimer.start();
+            }
+            m_send.length = m_writeDataLength;
+            qint32 baudRate = qMax(m_serialPort->baudRate(), 1);
+            /* 10 bits per byte on the wire */
+            qint64 estimated_ms = m_send.length * delayAfterBytes_us() / 1000
+                    + m_send.length * 10 * 1000 / baudRate;
+            m_send.showProgress = estimated_ms >= progressLimit_ms;
+            if (m_send.showProgress && !m_send.progressSent)
+            {
+                m_send.progressSent = true;
+                emit progress(QString(tr("Sending %1 bytes")).arg(m_send.length), 0);
+            }
+            mutexLocker.unlock();
+
+            if (!m_send.job->open())
+            {
+                emit message(tr("Cannot open file %1: %2").arg(m_send.job->fileName()).arg(m_send.job->errorString()), true);
+            }
+        }
+
+        SendJob *job = m_send.job;
+        if (m_send.offset >= job->size() || !m_running || m_abortSend || m_portFd < 0)
+        {
+            delete job;
+            m_send.job = NULL;
+            continue;
+        }
+        const char *chunk;
+        qint64 chunkLen = job->chunk(m_send.offset, &chunk);
+        if (chunkLen <= 0)
+        {
+            emit message(tr("Cannot read file %1: %2").arg(job->fileName()).arg(job->errorString()), true);
+            delete job;
+            m_send.job = NULL;
+            continue;
+        }
+        if (m_send.spanRemaining == 0)
+        {
+            m_send.spanRemaining = nextWriteSpan(chunk, chunkLen, &m_send.spanDelay_us);
+        }
+        ssize_t len = ::write(m_portFd, chunk, static_cast<size_t>(qMin(m_send.spanRemaining, chunkLen)));
+        if (len < 0)
+        {
+            if (errno == EINTR)
+            {
+                continue;
+            }
+            if (errno == EAGAIN || errno == EWOULDBLOCK)
+            {
+                /* Output buffer is full, updatePortEvents() waits for space */
+                m_send.blocked = true;
+                return;
+            }
+            qCritical() << __PRETTY_FUNCTION__ << "write failed:" << strerror(errno);
+            emit error(QSerialPort::WriteError);
+            delete job;
+            m_send.job = NULL;
+            continue;
+        }
+        m_lastWrite_ns = monotonicTime_ns();
+        writeLog(QByteArray::fromRawData(chunk, static_cast<int>(len)), false);
+        m_send.offset += len;
+        m_send.spanRemaining -= len;
+        m_writeDataSent += len;
+        m_bytesSent.fetch_add(static_cast<quint64>(len), std::memory_order_relaxed);
+        burst += len;
+        if (m_send.showProgress && (m_send.progressTimer.elapsed() >= progressInterval_ms || m_send.offset == job->size()))
+        {
+            m_send.progressTimer.restart();
+            emit progress(QString(tr("%1 bytes of %2 bytes sent")).arg(m_writeDataSent.load()).arg(m_send.length),
+                          100.0f * m_writeDataSent / qMax(m_send.length, static_cast<qint64>(1)));
+        }
+        if (m_send.spanRemaining == 0 && m_send.spanDelay_us)
+        {
+            /* Deadlines are absolute, so wake up latency does not
+             * accumulate. If sending is late more than a delay (e.g.
+             * output buffer was full), the schedule restarts. */
+            qint64 now_ns = monotonicTime_ns();
+            if (m_send.deadline_ns == 0 || now_ns - m_send.deadline_ns > m_send.spanDelay_us * 1000)
+            {
+                m_send.deadline_ns = now_ns;
+            }
+            m_send.deadline_ns += m_send.spanDelay_us * 1000;
+            m_send.resume_ns = m_send.deadline_ns;
+            armTimer(m_send.deadline_ns);
+            return;
+        }
+        if (burst >= maxBurst)
+        {
+            /* Let the reactor serve other sessions, continue immediately */
+            armTimer(monotonicTime_ns());
+            return;
+        }
+    }
+}
+
+/**
+ * @brief SerialThread::finishSend
+ * Ends sending: drops unsent data and emits finish(). Mutex shall be locked.
+ */
+void SerialThread::finishSend()
+{
+    delete m_send.job;
+    m_send.job = NULL;
+    if (m_send.progressSent)
+    {
+        emit progress(QString(tr("%1 bytes sent")).arg(m_writeDataSent.load()), 100.0f);
+    }
+    emit finish();
+    qDeleteAll(m_writeJobs);
+    m_writeJobs.clear();
+    m_writeDataSent = 0;
+    m_writeDataLength = 0;
+    m_send.spanRemaining = 0;
+    m_send.deadline_ns = 0;
+    m_send.resume_ns = 0;
+    m_send.active = false;
+    m_send.blocked = false;
+    m_send.showProgress = false;
+    m_send.progressSent = false;
+}
+#else
+/**
+ * @brief SerialThread::sendWriteData
+ * Sends queued data. Mutex shall be locked, it is unlocked while sending.
+ * Data is sent in large slices; it is split only where a delay is needed.
+ */
+void SerialThread::sendWriteData()
+{
+    bool progressSent = false;
+    const int progressLimit_ms = 2000; /* 2 seconds */
+    const int progressInterval_ms = 100;
+    QElapsedTimer progressTimer;
+
+    progressTimer.start();
+    /* Send data while thread should run */
+    while (!m_writeJobs.isEmpty() && m_running && !m_abortSend && m_serialPort->isOpen() && m_serialPort->isWritable())
+    {
+        SendJob *job = m_writeJobs.takeFirst();
+        qint64 writeDataLength = m_writeDataLength;
+        qint32 baudRate = qMax(m_serialPort->baudRate(), 1);
+        /* 10 bits per byte on the wire */
+        qint64 estimated_ms = writeDataLength * delayAfterBytes_us() / 1000
+                + writeDataLength * 10 * 1000 / baudRate;
+        bool showProgress = estimated_ms >= progressLimit_ms;
+        if (showProgress && !progressSent)
+        {
+            progressSent = true;
+            emit progress(QString(tr("Sending %1 bytes")).arg(writeDataLength), 0);
+        }
+        m_mutex.unlock();
+
+        if (!job->open())
+        {
+            emit message(tr("Cannot open file %1: %2").arg(job->fileName()).arg(job->errorString()), true);
+        }
+        qint64 offset = 0;
+        qint64 deadline_ns = 0;
+        while (offset < job->size() && m_running && !m_abortSend && m_serialPort->isOpen())
+        {
+            const char *chunk;
+            qint64 chunkLen = job->chunk(offset, &chunk);
+            if (chunkLen <= 0)
+            {
+                emit message(tr("Cannot read file %1: %2").arg(job->fileName()).arg(job->errorString()), true);
+                break;
+            }
+            qint64 delay_us = 0;
+            qint64 len = nextWriteSpan(chunk, chunkLen, &delay_us);
+            if (!writePort(chunk, len))
+            {
+                break;
+            }
+            writeLog(QByteArray::fromRawData(chunk, static_cast<int>(len)), false);
+            offset += len;
+            m_writeDataSent += len;
+            m_bytesSent.fetch_add(static_cast<quint64>(len), std::memory_order_relaxed);
+            if (showProgress && (progressTimer.elapsed() >= progressInterval_ms || offset == job->size()))
+            {
+                progressTimer.restart();
+                emit progress(QString(tr("%1 bytes of %2 bytes sent")).arg(m_writeDataSent.load()).arg(writeDataLength),
+                              100.0f * m_writeDataSent / writeDataLength);
+            }
+            if (delay_us)
+            {
+                /* Deadlines are absolute, so wake up latency does not
+                 * accumulate. If sending is late more than a delay (e.g.
+                 * output buffer was full), the schedule restarts. */
+                qint64 now_ns = monotonicTime_ns();
+                if (deadline_ns == 0 || now_ns - deadline_ns > delay_us * 1000)
+                {
+                    deadline_ns = now_ns;
+                }
+                deadline_ns += delay_us * 1000;
+                waitUntil(deadline_ns);
+            }
+        }
+        delete job;
+
+        m_mutex.lock();
+    }
+    if (progressSent)
+    {
+        emit progress(QString(tr("%1 bytes sent")).arg(m_writeDataSent.load()), 100.0f);
+    }
+    emit finish();
+    qDeleteAll(m_writeJobs);
+    m_writeJobs.clear();
+    m_writeDataSent = 0;
+    m_writeDataLength = 0;
+}
+#endif
+
+/**
+ * @brief SerialThread::nextWriteSpan
+ * Calculates how many bytes can be sent in one write and the delay needed
+ * after them.
+ *
+ * @param data Unsent data.
+ * @param len Length of unsent data.
+ * @param delay_us Delay after the span in microseconds.
+ * @return Length of span in bytes.
+ */
+qint64 SerialThread::nextWriteSpan(const char *data, qint64 len, qint64 *delay_us) const
+{
+    const qint64 maxSpanLength = 64 * 1024;
+    qint64 remaining = qMin(len, maxSpanLength);
+    bool delayChrUsed = m_delayChr.length() > 0 && delayAfterChr_us() > 0;
+
+    if (delayAfterBytes_us() > 0)
+    {
+        /* Delay after every byte, byte by byte sending is needed */
+        if (m_delayChr.length() > 0 && data[0] == m_delayChr[0])
+        {
+            *delay_us = delayAfterChr_us();
+        }
+        else
+        {
+            *delay_us = delayAfterBytes_us();
+        }
+        return 1;
+    }
+
+    *delay_us = 0;
+    if (delayChrUsed)
+    {
+        /* Send until delay character (including it) */
+        const char *found = static_cast<const char *>(memchr(data, m_delayChr[0], static_cast<size_t>(remaining)));
+        if (found)
+        {
+            *delay_us = delayAfterChr_us();
+            return (found - data) + 1;
+        }
+    }
+
+    return remaining;
+}
+
+qint64 SerialThread::delayAfterBytes_us() const
+{
+    return static_cast<qint64>(m_delayAfterBytes_ms) * 1000 + m_delayAfterBytes_us;
+}
+
+qint64 SerialThread::delayAfterChr_us() const
+{
+    return static_cast<qint64>(m_delayAfterChr_ms) * 1000 + m_delayAfterChr_us;
+}
+
+#if ALT_MODE == 0
+/**
+ * @brief SerialThread::monotonicTime_ns
+ * @return CLOCK_MONOTONIC time in nanoseconds.
+ */
+qint64 SerialThread::monotonicTime_ns() const
+{
+    struct timespec ts;
+    clock_gettime(CLOCK_MONOTONIC, &ts);
+    return static_cast<qint64>(ts.tv_sec) * 1000000000 + ts.tv_nsec;
+}
+
+/**
+ * @brief SerialThread::armTimer
+ * Arms the timer of the session, handleEvent() is called when it expires.
+ * If the timer is already armed for an earlier time, it is kept.
+ *
+ * @param deadline_ns Absolute CLOCK_MONOTONIC time in nanoseconds.
+ */
+void SerialThread::armTimer(qint64 deadline_ns)
+{
+    struct itimerspec spec;
+
+    if (m_timerDeadline_ns != 0 && m_timerDeadline_ns <= deadline_ns)
+    {
+        return;
+    }
+    spec.it_interval.tv_sec = 0;
+    spec.it_interval.tv_nsec = 0;
+    spec.it_value.tv_sec = deadline_ns / 1000000000;
+    spec.it_value.tv_nsec = deadline_ns % 1000000000;
+    if (timerfd_settime(m_timerFd, TFD_TIMER_ABSTIME, &spec, NULL) < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot set timer:" << strerror(errno);
+        return;
+    }
+    m_timerDeadline_ns = deadline_ns;
+}
+
+void SerialThread::disarmTimer()
+{
+    struct itimerspec spec;
+
+    memset(&spec, 0, sizeof(spec));
+    if (timerfd_settime(m_timerFd, 0, &spec, NULL) < 0)
+    {
+        qCritical() << __PRETTY_FUNCTION__ << "cannot disarm timer:" << strerror(errno);
+    }
+    m_timerDeadline_ns = 0;
+}
+#else
+qint64 SerialThread::monotonicTime_ns() const
+{
+    return m_monotonicTimer.nsecsElapsed();
+}
+
+void SerialThread::waitUntil(qint64 deadline_ns)
+{
+    while (m_running && !m_abortSend)
+    {
+        qint64 remaining_us = (deadline_ns - monotonicTime_ns()) / 1000;
+        if (remaining_us <= 0)
+        {
+            break;
+        }
+        if (remaining_us >= 1000)
+        {
+            /* waitForReadyRead() can block running up to remaining time */
+            if (m_serialPort->isOpen())
+            {
+                if (m_serialPort->waitForReadyRead(static_cast<int>(remaining_us / 1000)))
+                {
+                    readPortBuffer();
+                }
+                flushReadyRead();
+            }
+            else
+            {
+                /* Replaying recorded session, port is closed */
+                msleep(static_cast<unsigned long>(remaining_us / 1000));
+            }
+        }
+        else
+        {
+            usleep(static_cast<unsigned long>(remaining_us));
+        }
+    }
+}
+
+bool SerialThread::writePort(const char *data, qint64 len)
+{
+    if (m_serialPort->write(data, len) != len)
+    {
+        return false;
+    }
+    /* Wait until data is written, meanwhile receive data */
+    while (m_serialPort->bytesToWrite() > 0 && m_running && !m_abortSend && m_serialPort->isOpen())
+    {
+        m_serialPort->waitForBytesWritten(10);
+        if (m_serialPort->bytesAvailable())
+        {
+            readPortBuffer();
+        }
+    }
+    m_lastWrite_ns = monotonicTime_ns();
+    return true;
+}
+#endif
+
+/**
+ * @brief SerialThread::pushCommand
+ * Queues a command for the I/O thread. It never blocks, so it can be called
+ * while the I/O thread is sending or waiting for data.
+ */
+void SerialThread::pushCommand(serialCommand_t *command)
+{
+    m_commands.push(command);
+#if ALT_MODE == 0
+    wakeup();
+#endif
+}
+
+/**
+ * @brief SerialThread::processCommands
+ * Executes queued commands in the order they were pushed. Mutex shall be
+ * locked.
+ */
+void SerialThread::processCommands()
+{
+    serialCommand_t *command;
+
+    while ((command = m_commands.pop()) != NULL)
+    {
+        bool isStop = command->type == serialCommand_t::CMD_stop;
+#if ALT_MODE != 0
+        if (command->type != serialCommand_t::CMD_write && !m_writeJobs.isEmpty())
+        {
+            /* Data written before the command is sent first */
+            sendWriteData();
+        }
+#endif
+        processCommand(command);
+        delete command;
+        if (isStop)
+        {
+            /* Remaining commands are deleted with the queue */
+            break;
+        }
+    }
+#if ALT_MODE != 0
+    if (!m_writeJobs.isEmpty())
+    {
+        sendWriteData();
+    }
+#else
+    /* pumpSend() takes the jobs */
+#endif
+}
+
+/**
+ * @brief SerialThread::applyPortSettings
+ * Sets parameters of the opened port. Mutex shall be locked.
+ */
+void SerialThread::applyPortSettings(const SerialSettings::serialSettings_t &serialSettings)
+{
+    // Parameters shall be set after open on Qt 5.3!
+#if WINDOWS
+    m_serialPort->setBaudRate(serialSettings.baudRate);
+#else
+    // buggy on Windows 10 with PL2303 (not sure which one is guilty)
+    // m_serialPort->setBaudRate(m_baudRateOutput, QSerialPort::Output);
+    // m_serialPort->setBaudRate(m_baudRateInput, QSerialPort::Input);
+    m_serialPort->setBaudRate(serialSettings.baudRate);
+#endif
+    m_serialPort->setDataBits(serialSettings.dataBits);
+    m_serialPort->setParity(serialSettings.parity);
+    m_serialPort->setStopBits(serialSettings.stopBits);
+    m_serialPort->setFlowControl(serialSettings.flowControl);
+    if (!serialSettings.lowLatency)
+    {
+        /* Restores values changed before */
+        m_serialPort->setLowLatency(false);
+    }
+    else if (m_serialPort->setLowLatency(true))
+    {
+        int latencyTimer_ms = m_serialPort->latencyTimer_ms();
+        if (latencyTimer_ms >= 0)
+        {
+            emit message(tr("Low latency mode, latency timer of adapter: %1 ms").arg(latencyTimer_ms), false);
+        }
+        else
+        {
+            emit message(tr("Low latency mode"), false);
+        }
+    }
+    else
+    {
+        emit message(tr("Low latency mode is not supported by %1").arg(serialSettings.name), true);
+    }
+}
+
+void SerialThread::processCommand(serialCommand_t *command)
+{
+    switch (command->type)
+    {
+        case serialCommand_t::CMD_write:
+            if (m_abortSend)
+            {
+                /* Written before abortSend(), CMD_abort is not executed yet */
+            }
+            else if (!command->fileName.isEmpty())
+            {
+                m_writeJobs.append(new SendJob(command->fileName));
+                m_writeDataLength += command->length;
+            }
+            else
+            {
+                if (!m_writeJobs.isEmpty() && !m_writeJobs.last()->isFile())
+                {
+                    m_writeJobs.last()->append(command->data);
+                }
+                else
+                {
+                    m_writeJobs.append(new SendJob(command->data));
+                }
+                m_writeDataLength += command->length;
+            }
+            m_writePending -= command->length;
+            break;
+        case serialCommand_t::CMD_abort:
+            qDeleteAll(m_writeJobs);
+            m_writeJobs.clear();
+#if ALT_MODE == 0
+            if (m_send.active || m_send.job)
+            {
+                finishSend();
+            }
+            if (m_replay.source)
+            {
+                finishReplay(false);
+            }
+#endif
+            m_abortSend = false;
+            break;
+        case serialCommand_t::CMD_replay:
+#if ALT_MODE == 0
+            startReplay(command->fileName, command->speed, command->serialSettings.baudRate);
+#else
+            replayFile(command->fileName, command->speed, command->serialSettings.baudRate);
+#endif
+            break;
+        case serialCommand_t::CMD_open:
+            stopLogging();
+            /* Auto-log settings were loaded by open() */
+            m_autoLogIo = command->autoLog;
+            m_logWriter.setFlushInterval_ms(m_autoLogIo.flushInterval_ms);
+            m_logWriter.setFlushSize(m_autoLogIo.flushSize);
+            m_logWriter.setSyncOnClose(m_autoLogIo.syncOnClose);
+            m_captureWriter.setFlushInterval_ms(m_autoLogIo.flushInterval_ms);
+            if (m_serialPort->isOpen())
+            {
+                qDebug() << __FUNCTION__ << "port already opened! closing";
+                closePort();
+                publishPortState();
+                emit portStatusChanged(false);
+#if ALT_MODE != 0
+                msleep(500);
+#endif
+            }
+            if (!m_serialPort->isOpen())
+            {
+                bool isOpened;
+                recreatePort(command->serialSettings.name);
+#if WINDOWS
+                /* Workaround for Windows */
+                m_serialPort->setPortName(command->serialSettings.name);
+                isOpened = m_serialPort->open(command->openMode);
+                if (isOpened)
+                {
+                    m_serialPort->close();
+                    msleep(50);
+                    recreatePort(command->serialSettings.name);
+                    msleep(50);
+                }
+#endif
+                qDebug() << __FUNCTION__ << m_serialSettings->toString();
+                m_serialPort->setPortName(command->serialSettings.name);
+                isOpened = m_serialPort->open(command->openMode);
+                if (isOpened)
+                {
+                    startLogging();
+                    m_lastWrite_ns = -1;
+                    m_roundTrip_ns = -1;
+                    applyPortSettings(command->serialSettings);
+                    if (m_serialPort->description() != m_serialPort->portName())
+                    {
+                        emit message(m_serialPort->description(), false);
+                    }
+#if ALT_MODE == 0
+                    /* updatePortEvents() registers the port in reactor */
+                    m_portFd = m_serialPort->handle();
+                    /* Ticks are needed for polling lines or flushing capture */
+                    bool watching = m_lineWatcher.startWatching(m_portFd, m_wakeupFd);
+                    IoReactor::instance()->setTickEnabled(this, !watching || m_captureWriter.isOpen());
+                    updatePinoutSignals(m_serialPort->pinoutSignals(), monotonicTime_ns());
+#endif
+                    publishPortState();
+                    emit portStatusChanged(true);
+                }
+                else
+                {
+                    publishPortState();
+                    emit message(tr("Cannot open port! %1").arg(m_serialPort->errorString()), true);
+                    qCritical() << __PRETTY_FUNCTION__ << "cannot open port!";
+                }
+            }
+            else
+            {
+                qDebug() << __PRETTY_FUNCTION__ << "port already opened!";
+            }
+            break;
+        case serialCommand_t::CMD_reconfigure:
+            if (m_serialPort->isOpen())
+            {
+                applyPortSettings(command->serialSettings);
+                publishPortState();
+                emit portStatusChanged(true);
+            }
+            break;
+        case serialCommand_t::CMD_setTimestampFormat:
+            m_timestampFormatter.setFormat(command->timestampFormat);
+            m_logWriter.setTimestampFormatString(command->timestampFormat);
+            break;
+        case serialCommand_t::CMD_setLines:
+            if (command->line == QSerialPort::DataTerminalReadySignal)
+            {
+                m_serialPort->setDataTerminalReady(command->set);
+            }
+            else
+            {
+                m_serialPort->setRequestToSend(command->set);
+            }
+#if ALT_MODE == 0
+            if (m_lineWatcher.isWatching())
+            {
+                /* Watcher reports input lines only */
+                updatePinoutSignals(m_serialPort->pinoutSignals(), monotonicTime_ns());
+            }
+#endif
+            publishPortState();
+            break;
+        case serialCommand_t::CMD_close:
+        case serialCommand_t::CMD_stop:
+            stopLogging();
+            if (m_serialPort->isOpen())
+            {
+                closePort();
+                publishPortState();
+                emit portStatusChanged(false);
+            }
+#if ALT_MODE == 0
+            if (command->type == serialCommand_t::CMD_stop)
+            {
+                /* Session leaves the reactor, port is given back to owner */
+                if (m_replay.source)
+                {
+                    finishReplay(false);
+                }
+                disarmTimer();
+                IoReactor::instance()->removeHandler(this);
+                m_serialPort->moveToThread(thread());
+                m_attached = false;
+            }
+#endif
+            break;
+        default:
+            emit message(tr("Unknown command!"), true);
+            qCritical() << __PRETTY_FUNCTION__ << "unknown command:" << (int)command->type;
+            Q_ASSERT(0);
+            break;
+    }
+}
+
+QString SerialThread::autoLogFilePath() const
+{
+    return m_autoLog.filePath;
+}
+
+void SerialThread::setAutoLogFilePath(const QString &newAutoLogFilePath)
+{
+    m_autoLog.filePath = newAutoLogFilePath;
+}
+
+QString SerialThread::autoLogFileName() const
+{
+    return m_autoLog.fileName;
+}
+
+void SerialThread::setAutoLogFileName(const QString &newAutoLogFileName)
+{
+    m_autoLog.fileName = newAutoLogFileName;
+}
+
+QString SerialThread::getTimestamp() const
+{
+    QByteArray timestamp;
+    m_timestampFormatter.appendCurrent(timestamp);
+    return QString::fromLocal8Bit(timestamp);
+}
+
+/**
+ * @brief SerialThread::setTimestampFormatString
+ * Sets timestamp format of auto-log. Formatter is used by I/O thread, so it
+ * gets the format by a command.
+ */
 void SerialThread::setTimestampFormatString(const QString &format)
 {
+    serialCommand_t *command = new serialCommand_t();
+    command->type = serialCommand_t::CMD_setTimestampFormat;
+    command->timestampFormat = format;
     m_timestampFormatString = format;
+    pushCommand(command);
 }
 
 QString SerialThread::getTimestampFormatString()
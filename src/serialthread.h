@@ -9,24 +9,48 @@
 
 #include <QThread>
 #include <QMutex>
-#include <QWaitCondition>
 #include <QSerialPort>
-#include <QFile>
-#include <QDataStream>
+#include <QElapsedTimer>
+
+#include <atomic>
+
+#include "common.h"
+#include "ringbuffer.h"
+#include "arrivaltimes.h"
+#include "logwriter.h"
+#include "capturewriter.h"
+#include "timestampformatter.h"
+#include "replaysource.h"
+#include "sendjob.h"
+#include "portbackend.h"
+#include "readoverflow.h"
+#include "commandqueue.h"
 
 class SerialSettings;
 
-#if WINDOWS
-#define ALT_MODE  1
-#else
+/* epoll, timerfd and TIOCMIWAIT are Linux only */
+#if LINUX
 #define ALT_MODE  0
+#else
+#define ALT_MODE  1
+#endif
+
+#if ALT_MODE == 0
+#include <QSemaphore>
+#include "ioreactor.h"
+#include "modemlinewatcher.h"
 #endif
 
 /**
  * @brief The SerialThread class
  * Used to send serial data with delays between bytes.
+ * On Linux the port is served by the shared IoReactor thread, so any number
+ * of sessions use one thread. Otherwise every session runs its own thread.
  */
 class SerialThread : public QThread
+#if ALT_MODE == 0
+    , public IoReactor::Handler
+#endif
 {
     Q_OBJECT
 public:
@@ -42,15 +66,24 @@ public:
         LINE_rts,
         LINE_brk
     } lines_t;
+    /** What happens to received data when the receive buffer is full. */
+    typedef enum
+    {
+        READ_QUEUE_block,       /**< Port is not read, tty and flow control push back. */
+        READ_QUEUE_dropOldest,  /**< Oldest data is dropped before display, log gets everything. */
+        READ_QUEUE_spill        /**< Data is spilled to a temporary file. */
+    } readQueuePolicy_t;
     explicit SerialThread(QObject *parent = 0, SerialSettings * serialSettings = NULL);
     ~SerialThread();
 
-    void run();
+    void startIo(QThread::Priority priority = QThread::InheritPriority);
     void stop(int timeout = 0);
     void loadSettings();
-    QSerialPort *getSerialPort();
+    PortBackend *getSerialPort();
     qint64 write(QByteArray data, const QString &lineEnding = "");
     qint64 write(const char *data, qint64 len);
+    qint64 writeFile(const QString &fileName);
+    void replay(const QString &fileName, double speed);
 
     int getDelayAfterBytes_ms() const;
     void setDelayAfterBytes_ms(int delayAfterBytes_ms);
@@ -59,6 +92,12 @@ public:
     QByteArray getChr() const;
     void setDelayAfterChr_ms(int delayAfterChr_ms, QByteArray chr);
 
+    int getDelayAfterBytes_us() const;
+    void setDelayAfterBytes_us(int delayAfterBytes_us);
+
+    int getDelayAfterChr_us() const;
+    void setDelayAfterChr_us(int delayAfterChr_us);
+
     void setLineEndingRx(const QString &lineEndingRx);
     QString lineEndingRx() const;
 
@@ -72,6 +111,7 @@ public:
 
     bool open(QSerialPort::OpenMode mode);
     void close();
+    void reconfigure();
 
     bool setBaudRate(qint32 baudRate, QSerialPort::Directions directions = QSerialPort::AllDirections);
     qint32 baudRate(QSerialPort::Directions directions = QSerialPort::AllDirections);
@@ -102,14 +142,33 @@ public:
 
     bool isOpen();
 
-    QByteArray readAll(int timeout = 0);
-    void recreatePort();
+    QByteArray readAll();
+    qint64 peekReadData(const char **data, arrivalTime_t *arrivalTime = NULL);
+    void consumeReadData(qint64 len);
+    qint64 bytesAvailable() const;
+    qint64 readBufferSize() const;
+    qint64 bytesToWrite();
+    quint64 bytesReceived() const;
+    quint64 bytesSent() const;
+    void acknowledgeReadyRead();
+    readQueuePolicy_t readQueuePolicy() const;
+    void setReadQueuePolicy(readQueuePolicy_t policy);
+    qint64 readOverflowSize() const;
+    quint64 bytesDropped() const;
+    quint64 bytesSpilled() const;
+    qint64 roundTripTime_us() const;
+    qint64 readyReadInterval_us() const;
+    void setReadyReadInterval_us(qint64 interval_us);
+    void recreatePort(const QString &name);
 
     void enableAutoLog(bool enable=true);
     bool isAutoLogEnabled();
+    void enableAutoLogCapture(bool enable=true);
+    bool isAutoLogCaptureEnabled();
+    void keepAutoLogSettings(bool keep=true);
 
     void startLogging();
-    void writeLog(QByteArray &byteArray, bool read=true);
+    void writeLog(const QByteArray &byteArray, bool read=true, qint64 timestamp_ms=-1, qint64 monotonic_ns=-1);
     void stopLogging();
 
     QString getTimestamp() const;
@@ -134,46 +193,167 @@ signals:
 public slots:
     void abortSend();
 
+protected slots:
+    void portError(QSerialPort::SerialPortError serialPortError);
+
 protected:
-   void processCommand();
+   void pushCommand(serialCommand_t *command);
+   void processCommands();
+   void processCommand(serialCommand_t *command);
+   void applyPortSettings(const SerialSettings::serialSettings_t &serialSettings);
+   void closePort();
+   void publishPortState();
+   qint64 nextWriteSpan(const char *data, qint64 len, qint64 *delay_us) const;
+   qint64 delayAfterBytes_us() const;
+   qint64 delayAfterChr_us() const;
+   qint64 monotonicTime_ns() const;
+   void readPortBuffer();
+   void releaseReadBuffer();
+   void notifyReadyRead(bool force = false);
+   void flushReadyRead();
+   void updatePinoutSignals(QSerialPort::PinoutSignals pinoutSignals, qint64 monotonic_ns);
+   void measureRoundTrip(qint64 received_ns);
+   void overflowReadData(const char *data, qint64 len, qint64 monotonic_ns, qint64 wallClock_ms);
+   void drainReadOverflow();
+   void discardReadData();
+#if ALT_MODE == 0
+   void handleEvent(int fd, quint32 events);
+   void handleTick();
+   void processLineEvents();
+   void updatePortEvents();
+   void readPort(int portFd);
+   bool isReadBufferFull();
+   void clearWakeup();
+   void wakeup();
+   void armTimer(qint64 deadline_ns);
+   void disarmTimer();
+   void pumpSend();
+   void finishSend();
+   void startReplay(const QString &fileName, double speed, qint32 baudRate);
+   void pumpReplay();
+   void finishReplay(bool completed);
+   qint64 tryPushReadData(const char *data, qint64 len);
+#else
+   void run();
+   void sendWriteData();
+   bool writePort(const char *data, qint64 len);
+   void waitUntil(qint64 deadline_ns);
+   void replayFile(const QString &fileName, double speed, qint32 baudRate);
+   bool pushReadData(const char *data, qint64 len, qint64 wallClock_ms, bool transmitted);
+   bool waitForReadBuffer(qint64 freeSpace);
+#endif
 
 protected:
-    typedef enum
+    CommandQueue m_commands;    /**< Commands of other threads, executed in order by I/O thread. */
+    PortBackend* m_serialPort;  /**< Serial device, real or virtual */
+    QList<SendJob *> m_writeJobs; /**< Data and files to send */
+    std::atomic<qint64> m_writeDataLength;  /**< Bytes of queued jobs, written by I/O thread, read by bytesToWrite(). */
+    std::atomic<qint64> m_writeDataSent;    /**< Sent bytes of queued jobs, written by I/O thread, read by bytesToWrite(). */
+    std::atomic<qint64> m_writePending; /**< Bytes of CMD_write commands not executed yet. */
+    RingBuffer m_readBuffer;    /**< Received data, filled by thread and drained by GUI without locking. */
+    ArrivalTimes m_arrivalTimes;    /**< Arrival time of chunks in m_readBuffer. */
+    std::atomic<bool> m_readStalled; /**< Thread stopped reading port because m_readBuffer is full. */
+    std::atomic<bool> m_abortSend;   /**< Sending shall be stopped, set by abortSend(). */
+    std::atomic<quint64> m_bytesReceived;   /**< Put to m_readBuffer since start, for statistics. */
+    std::atomic<quint64> m_bytesSent;       /**< Written to port since start, for statistics. */
+    std::atomic<bool> m_readyReadPending;   /**< readyRead() is queued, consumer has not started reading yet. */
+    std::atomic<qint64> m_readyReadInterval_us; /**< Minimum time between readyRead() signals, 0: no limit. */
+    bool m_readyReadDeferred;   /**< Data arrived too early after last readyRead(), flushReadyRead() emits it. */
+    qint64 m_readyReadTime_ns;  /**< Time of last readyRead(), -1: none yet. */
+    std::atomic<int> m_readQueuePolicy;     /**< See readQueuePolicy_t. */
+    ReadOverflow m_readOverflow;    /**< Received data which did not fit into m_readBuffer. Used by I/O thread only. */
+    QByteArray m_readOverflowChunk; /**< Port is read here when m_readBuffer is full. */
+    std::atomic<qint64> m_readOverflowSize; /**< Size of m_readOverflow, for statistics. */
+    std::atomic<quint64> m_readDiscardOffset;   /**< Consumer drops received data before this offset. */
+    std::atomic<quint64> m_bytesDropped;    /**< Received but not displayed, for statistics. */
+    std::atomic<quint64> m_bytesSpilled;    /**< Received data spilled to disk, for statistics. */
+    qint64 m_lastWrite_ns;      /**< Time of last write to port, -1: response already measured. */
+    std::atomic<qint64> m_roundTrip_ns;     /**< Response time of device after last write, -1: unknown. */
+    std::atomic<bool> m_running;    /**< Thread is running, used to stop thread gently. */
+    QMutex m_mutex;             /**< Mutex to protect port and m_writeJobs while I/O thread uses them. */
+    /** State of the port, published by I/O thread for getters of other threads. */
+    typedef struct
     {
-        CMD_undefined,
-        CMD_open,
-        CMD_close,
-        CMD_write,
-        CMD_stop
-    } command_t;
-    command_t m_command;
-    int m_commandParam;
-    QSerialPort* m_serialPort;  /**< Serial device */
-    QByteArray m_writeData;     /**< Data to send */
-    int m_writeDataLength;
-    int m_writeDataSent;
-    QByteArray m_readData;      /**< Received data */
-    bool m_running;             /**< Thread is running, used to stop thread gently. */
-    QMutex m_mutex;             /**< Mutex to protect m_writeData, m_readData. */
+        QString portName;
+        qint32 baudRate;
+        QSerialPort::DataBits dataBits;
+        QSerialPort::Parity parity;
+        QSerialPort::StopBits stopBits;
+        QSerialPort::FlowControl flowControl;
+        bool dataTerminalReady;
+        bool requestToSend;
+        QSerialPort::PinoutSignals pinoutSignals;
+        QString errorString;
+    } portState_t;
+    portState_t m_portState;
+    QMutex m_portStateMutex;    /**< Protects m_portState only, it is never held while the port is used. */
+    std::atomic<bool> m_portOpen;   /**< Port is opened, published by I/O thread. */
 #if ALT_MODE == 0
-    QWaitCondition m_commandEvent; /**< Thread waits for this condition. */
+    /** State of sending, it is continued by pumpSend() when port or timer is ready. */
+    typedef struct
+    {
+        SendJob *job;           /**< Job being sent, NULL if none. */
+        qint64 offset;          /**< Sent bytes of job. */
+        qint64 spanRemaining;   /**< Unsent bytes of current span, see nextWriteSpan(). */
+        qint64 spanDelay_us;    /**< Delay after current span. */
+        qint64 deadline_ns;     /**< Schedule of delays, 0: not started. */
+        qint64 resume_ns;       /**< Sending is continued at this time, 0: immediately. */
+        qint64 length;          /**< Length of all data to send, for progress. */
+        bool active;            /**< finish() shall be emitted when queue is empty. */
+        bool blocked;           /**< Output buffer is full, waiting for EPOLLOUT. */
+        bool showProgress;
+        bool progressSent;
+        QElapsedTimer progressTimer;
+    } sendState_t;
+
+    /** State of replay, it is continued by pumpReplay(). */
+    typedef struct
+    {
+        ReplaySource *source;   /**< NULL if not replaying. */
+        QString fileName;
+        double speed;           /**< 1.0: original speed, 0: as fast as possible. */
+        replayChunk_t chunk;
+        bool chunkPending;      /**< chunk is not processed yet. */
+        qint64 chunkOffset;     /**< Bytes of chunk already put to receive buffer. */
+        qint64 firstTime_ns;    /**< Time of first timed chunk, -1: not found yet. */
+        qint64 time_ns;         /**< Time of current chunk relative to first one. */
+        qint64 start_ns;
+        qint64 fed_ns;          /**< Time when last chunk was put to receive buffer. */
+        qint64 bytes;
+        bool draining;          /**< All data fed, waiting for consumer. */
+        QElapsedTimer progressTimer;
+    } replayState_t;
+
+    int m_wakeupFd;             /**< eventfd to wake up reactor when command arrives. */
+    int m_timerFd;              /**< timerfd (CLOCK_MONOTONIC) used to pace sending. */
+    qint64 m_timerDeadline_ns;  /**< Expiry of m_timerFd, 0: not armed. */
+    bool m_attached;            /**< Descriptors are registered in IoReactor. */
+    int m_portFd;               /**< Descriptor of opened port, -1 if closed. */
+    quint32 m_portEvents;       /**< Events of m_portFd registered in reactor, 0: not registered. */
+    QSemaphore m_stopped;       /**< Released when CMD_stop is processed. */
+    ModemLineWatcher m_lineWatcher; /**< Reports modem line changes of real serial ports without polling. */
+    sendState_t m_send;
+    replayState_t m_replay;
+#else
+    QElapsedTimer m_monotonicTimer;
 #endif
     int m_delayAfterBytes_ms;   /**< After sending a byte this delay will be applied. */
+    int m_delayAfterBytes_us;   /**< Sub-millisecond part of delay after a byte. */
     int m_delayAfterChr_ms;
-    /** After this character m_delayAfterChr_ms microseconds delay will be applied instead of m_delayAfterBytes_ms.
+    int m_delayAfterChr_us;     /**< Sub-millisecond part of delay after m_delayChr. */
+    /** After this character m_delayAfterChr_ms milliseconds delay will be applied instead of m_delayAfterBytes_ms.
      * This is usually a new line charater (CR, LF). */
     QByteArray m_delayChr;
     QSerialPort::PinoutSignals m_pinoutSignals;
     // TODO this should be a local copy and mutex protected...
     SerialSettings * m_serialSettings;
-    bool m_autoLogIsEnabled;
-    bool m_autoLogOverwriteIsEnabled;
-    QString m_autoLogFileName;
-    QString m_autoLogFilePath;
-    QFile m_logFile;
-    QDataStream m_logFileStream;
-    int m_logColumnIdx;
-    QString m_timestampFormatString;
+    autoLogSettings_t m_autoLog;    /**< Used by the thread calling open() and setters. */
+    autoLogSettings_t m_autoLogIo;  /**< Copy of m_autoLog used by I/O thread, taken by CMD_open. */
+    bool m_autoLogKept;         /**< Auto-log was set by caller, loadSettings() does not overwrite it. */
+    LogWriter m_logWriter;      /**< Writes auto-log on its own thread. */
+    CaptureWriter m_captureWriter;  /**< Writes binary capture next to auto-log. */
+    QString m_timestampFormatString;    /**< Used by the thread calling setTimestampFormatString(). */
+    mutable TimestampFormatter m_timestampFormatter;    /**< Used by I/O thread only, set by CMD_setTimestampFormat. */
     QString m_lineEndingRx;
     QByteArray m_lineEndingRxBA;
     QString m_lineEndingTx;
@@ -39,6 +39,7 @@
 #include "settingsdialog.h"
 #include "ui_settingsdialog.h"
 #include "common.h"
+#include "portbackend.h"
 
 #include <QtSerialPort/QSerialPortInfo>
 #include <QIntValidator>
@@ -365,6 +366,20 @@ void SettingsDialog::fillPortsInfo(bool forceUpdate)
             }
         }
 
+        /* Virtual ports: pseudo-terminal and simulated devices */
+        foreach (const QString &portName, PortBackend::virtualPortNames())
+        {
+            QStringList list;
+            list << portName
+                 << PortBackend::virtualPortDescription(portName)
+                 << blankString
+                 << blankString
+                 << portName
+                 << blankString
+                 << blankString;
+            ui->serialPortInfoListBox->addItem(list.first(), list);
+        }
+
 #if USE_POLICY_CHECK
         ui->serialPortInfoListBox->addItem(tr("Custom"));
 #endif
@@ -445,6 +460,7 @@ void SettingsDialog::ui2settings(SerialSettings::serialSettings_t *settings)
     settings->flowControl = static_cast<QSerialPort::FlowControl>(
                 ui->flowControlBox->itemData(ui->flowControlBox->currentIndex()).toInt());
     settings->stringFlowControl = ui->flowControlBox->currentText();
+    settings->lowLatency = ui->lowLatencyCheckBox->isChecked();
 }
 
 void SettingsDialog::settings2ui(SerialSettings::serialSettings_t *settings)
@@ -463,6 +479,7 @@ void SettingsDialog::settings2ui(SerialSettings::serialSettings_t *settings)
     ui->parityBox->setCurrentText(settings->stringParity);
     ui->stopBitsBox->setCurrentText(settings->stringStopBits);
     ui->flowControlBox->setCurrentText(settings->stringFlowControl);
+    ui->lowLatencyCheckBox->setChecked(settings->lowLatency);
 }
 
 /**
@@ -482,6 +499,7 @@ void SettingsDialog::settings2item(QListWidgetItem *item, SerialSettings::serial
     item->setData(role_stringStopBits, settings->stringStopBits);
     item->setData(role_flowControl, settings->flowControl);
     item->setData(role_stringFlowControl, settings->stringFlowControl);
+    item->setData(role_lowLatency, settings->lowLatency);
 }
 
 /**
@@ -501,6 +519,7 @@ void SettingsDialog::item2settings(QListWidgetItem *item, SerialSettings::serial
     settings->stringStopBits = item->data(role_stringStopBits).toString();
     settings->flowControl = static_cast<QSerialPort::FlowControl> (item->data(role_flowControl).toInt());
     settings->stringFlowControl = item->data(role_stringFlowControl).toString();
+    settings->lowLatency = item->data(role_lowLatency).toBool();
 }
 
 
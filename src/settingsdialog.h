@@ -118,7 +118,8 @@ private:
         role_stopBits,
         role_stringStopBits,
         role_flowControl,
-        role_stringFlowControl
+        role_stringFlowControl,
+        role_lowLatency
     };
 };
 
@@ -0,0 +1,294 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QElapsedTimer>
+#include <QStringList>
+
+#include <poll.h>
+#include <unistd.h>
+#include <fcntl.h>
+#include <errno.h>
+#include <string.h>
+#include <sys/socket.h>
+
+#include "simulatedportbackend.h"
+
+/** Generated data is produced in time slices of this length. */
+static const qint64 generateSlice_ns = 10000000;
+/** Chunk size when generating without rate limit. */
+static const int generateBlockSize = 65536;
+/** Echo stops reading when this much data waits to be sent back. */
+static const int echoBufferSize = 1024 * 1024;
+static const int defaultLineLength = 80;
+static const int minLineLength = 12;
+
+SimulatedDevice::SimulatedDevice(int fd, deviceMode_t mode, qint64 rate_Bps, int lineLength, QObject *parent)
+    : QThread(parent)
+    , m_fd(fd)
+    , m_mode(mode)
+    , m_rate_Bps(rate_Bps)
+    , m_lineLength(qMax(lineLength, minLineLength))
+    , m_stop(0)
+    , m_linePos(0)
+    , m_lineNumber(0)
+{
+}
+
+SimulatedDevice::~SimulatedDevice()
+{
+    stop();
+}
+
+void SimulatedDevice::stop()
+{
+    m_stop.store(1);
+    wait();
+}
+
+/**
+ * @brief SimulatedDevice::generate
+ * Appends next len bytes of the line stream: "00000001 !"#$%...\r\n"
+ */
+void SimulatedDevice::generate(QByteArray &out, qint64 len)
+{
+    while (len > 0)
+    {
+        if (m_linePos >= m_line.size())
+        {
+            int i;
+            m_lineNumber++;
+            m_line = QByteArray::number(m_lineNumber).rightJustified(8, '0');
+            m_line.append(' ');
+            for (i = m_line.size(); i < m_lineLength - 2; i++)
+            {
+                m_line.append(static_cast<char>('!' + (m_lineNumber + i) % 94));
+            }
+            m_line.append("\r\n");
+            m_linePos = 0;
+        }
+        int n = static_cast<int>(qMin(len, static_cast<qint64>(m_line.size() - m_linePos)));
+        out.append(m_line.constData() + m_linePos, n);
+        m_linePos += n;
+        len -= n;
+    }
+}
+
+void SimulatedDevice::run()
+{
+    QElapsedTimer timer;
+    QByteArray in;
+    QByteArray out;
+    qint64 next_ns = 0;
+    qint64 credit_nB = 0;     /**< Bytes allowed to be generated, multiplied by 1e9. */
+
+    in.resize(4096);
+    out.reserve(generateBlockSize);
+    timer.start();
+    while (!m_stop.load())
+    {
+        struct pollfd fd;
+        int timeout_ms = 100;
+        fd.fd = m_fd;
+        fd.events = 0;
+        fd.revents = 0;
+        if (m_mode == MODE_generate || out.size() < echoBufferSize)
+        {
+            fd.events |= POLLIN;
+        }
+        if (out.size())
+        {
+            fd.events |= POLLOUT;
+        }
+        if (m_mode == MODE_generate)
+        {
+            if (m_rate_Bps == 0)
+            {
+                timeout_ms = out.size() ? 100 : 0;
+            }
+            else
+            {
+                qint64 wait_ns = next_ns - timer.nsecsElapsed();
+                timeout_ms = wait_ns > 0 ? static_cast<int>((wait_ns + 999999) / 1000000) : 0;
+            }
+        }
+        if (::poll(&fd, 1, timeout_ms) < 0 && errno != EINTR)
+        {
+            break;
+        }
+        if (fd.revents & (POLLERR | POLLNVAL))
+        {
+            break;
+        }
+        if (fd.revents & (POLLIN | POLLHUP))
+        {
+            ssize_t len = recv(m_fd, in.data(), static_cast<size_t>(in.size()), MSG_DONTWAIT);
+            if (len == 0)
+            {
+                /* Port closed */
+                break;
+            }
+            if (len > 0 && m_mode == MODE_echo)
+            {
+                out.append(in.constData(), static_cast<int>(len));
+            }
+        }
+        if (m_mode == MODE_generate)
+        {
+            if (m_rate_Bps == 0)
+            {
+                if (out.isEmpty())
+                {
+                    generate(out, generateBlockSize);
+                }
+            }
+            else
+            {
+                qint64 now_ns = timer.nsecsElapsed();
+                if (now_ns - next_ns > 1000000000LL)
+                {
+                    /* Reader could not keep up for a long time, do not burst */
+                    next_ns = now_ns;
+                }
+                while (now_ns >= next_ns)
+                {
+                    credit_nB += m_rate_Bps * generateSlice_ns;
+                    next_ns += generateSlice_ns;
+                }
+                /* At most one second of data is kept back */
+                credit_nB = qMin(credit_nB, m_rate_Bps * 1000000000LL);
+                qint64 len = credit_nB / 1000000000LL;
+                if (len > 0 && out.size() < echoBufferSize)
+                {
+                    generate(out, len);
+                    credit_nB -= len * 1000000000LL;
+                }
+            }
+        }
+        if (out.size())
+        {
+            ssize_t len = send(m_fd, out.constData(), static_cast<size_t>(out.size()), MSG_DONTWAIT | MSG_NOSIGNAL);
+            if (len > 0)
+            {
+                out.remove(0, static_cast<int>(len));
+            }
+            else if (len < 0 && errno != EAGAIN && errno != EWOULDBLOCK && errno != EINTR)
+            {
+                break;
+            }
+        }
+    }
+}
+
+SimulatedPortBackend::SimulatedPortBackend(QObject *parent)
+    : FdPortBackend(parent)
+    , m_device(NULL)
+    , m_deviceFd(-1)
+{
+}
+
+SimulatedPortBackend::~SimulatedPortBackend()
+{
+    closeDevice();
+}
+
+bool SimulatedPortBackend::parsePortName(const QString &portName, SimulatedDevice::deviceMode_t *mode,
+                                         qint64 *rate_Bps, int *lineLength)
+{
+    QStringList fields = portName.split(':');
+    bool ok = true;
+
+    *rate_Bps = 0;
+    *lineLength = defaultLineLength;
+    if (fields.size() == 2 && fields.at(0) == "sim" && fields.at(1) == "echo")
+    {
+        *mode = SimulatedDevice::MODE_echo;
+        return true;
+    }
+    if (fields.size() < 3 || fields.size() > 4 || fields.at(0) != "sim" || fields.at(1) != "gen")
+    {
+        return false;
+    }
+    *mode = SimulatedDevice::MODE_generate;
+    *rate_Bps = fields.at(2).toLongLong(&ok);
+    if (!ok || *rate_Bps < 0)
+    {
+        return false;
+    }
+    if (fields.size() == 4)
+    {
+        *lineLength = fields.at(3).toInt(&ok);
+        if (!ok || *lineLength < minLineLength)
+        {
+            return false;
+        }
+    }
+    return true;
+}
+
+QString SimulatedPortBackend::description() const
+{
+    return description(portName());
+}
+
+QString SimulatedPortBackend::description(const QString &portName)
+{
+    SimulatedDevice::deviceMode_t mode;
+    qint64 rate_Bps;
+    int lineLength;
+
+    if (!parsePortName(portName, &mode, &rate_Bps, &lineLength))
+    {
+        return tr("Simulated device (invalid name)");
+    }
+    if (mode == SimulatedDevice::MODE_echo)
+    {
+        return tr("Simulated device, echo");
+    }
+    if (rate_Bps == 0)
+    {
+        return tr("Simulated device, %1 character lines at maximum rate").arg(lineLength);
+    }
+    return tr("Simulated device, %1 character lines at %2 bytes/s").arg(lineLength).arg(rate_Bps);
+}
+
+int SimulatedPortBackend::openDevice()
+{
+    SimulatedDevice::deviceMode_t mode;
+    qint64 rate_Bps;
+    int lineLength;
+    int fds[2];
+
+    if (!parsePortName(portName(), &mode, &rate_Bps, &lineLength))
+    {
+        setErrorString(tr("Invalid simulated device name: %1. Use sim:echo or sim:gen:<bytes/s>[:<line length>]")
+                       .arg(portName()));
+        return -1;
+    }
+    if (socketpair(AF_UNIX, SOCK_STREAM | SOCK_CLOEXEC, 0, fds) < 0)
+    {
+        setErrorString(tr("Cannot create simulated device: %1").arg(QString::fromLocal8Bit(strerror(errno))));
+        return -1;
+    }
+    m_deviceFd = fds[1];
+    m_device = new SimulatedDevice(m_deviceFd, mode, rate_Bps, lineLength);
+    m_device->start();
+    return fds[0];
+}
+
+void SimulatedPortBackend::closeDevice()
+{
+    if (m_device)
+    {
+        m_device->stop();
+        delete m_device;
+        m_device = NULL;
+    }
+    if (m_deviceFd >= 0)
+    {
+        ::close(m_deviceFd);
+        m_deviceFd = -1;
+    }
+}
@@ -0,0 +1,83 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef SIMULATEDPORTBACKEND_H
+#define SIMULATEDPORTBACKEND_H
+
+#include <QThread>
+#include <QAtomicInt>
+#include <QByteArray>
+
+#include "fdportbackend.h"
+
+/**
+ * @brief The SimulatedDevice class
+ * Device at the other end of a socket pair, running on its own thread.
+ * It echoes the received data or generates numbered lines at a given rate.
+ */
+class SimulatedDevice : public QThread
+{
+    Q_OBJECT
+public:
+    typedef enum
+    {
+        MODE_echo,
+        MODE_generate
+    } deviceMode_t;
+
+    SimulatedDevice(int fd, deviceMode_t mode, qint64 rate_Bps, int lineLength, QObject *parent = 0);
+    ~SimulatedDevice();
+
+    void stop();
+
+protected:
+    void run();
+
+private:
+    Q_DISABLE_COPY(SimulatedDevice)
+
+    void generate(QByteArray &out, qint64 len);
+
+    int m_fd;
+    deviceMode_t m_mode;
+    qint64 m_rate_Bps;      /**< 0: as fast as possible. */
+    int m_lineLength;       /**< Including line ending. */
+    QAtomicInt m_stop;
+    QByteArray m_line;      /**< Line being generated. */
+    int m_linePos;
+    quint32 m_lineNumber;
+};
+
+/**
+ * @brief The SimulatedPortBackend class
+ * Virtual port connected to a SimulatedDevice. Port name selects the device:
+ * "sim:echo" or "sim:gen:<bytes/s>[:<line length>]", 0 bytes/s means no limit.
+ */
+class SimulatedPortBackend : public FdPortBackend
+{
+    Q_OBJECT
+public:
+    explicit SimulatedPortBackend(QObject *parent = 0);
+    ~SimulatedPortBackend();
+
+    QString description() const;
+    static QString description(const QString &portName);
+
+protected:
+    int openDevice();
+    void closeDevice();
+
+private:
+    Q_DISABLE_COPY(SimulatedPortBackend)
+
+    static bool parsePortName(const QString &portName, SimulatedDevice::deviceMode_t *mode,
+                              qint64 *rate_Bps, int *lineLength);
+
+    SimulatedDevice *m_device;
+    int m_deviceFd;
+};
+
+#endif // SIMULATEDPORTBACKEND_H
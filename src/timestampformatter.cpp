@@ -0,0 +1,192 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#include <QDateTime>
+
+#include <string.h>
+
+#include "timestampformatter.h"
+
+/** Placeholders of millisecond fields in compiled format */
+static const char markerZzz = '\x01';
+static const char markerZ = '\x02';
+
+TimestampFormatter::TimestampFormatter(const QString &format)
+    : m_renderedSecond(0)
+{
+    setFormat(format);
+}
+
+QString TimestampFormatter::format() const
+{
+    return m_format;
+}
+
+/**
+ * @brief TimestampFormatter::setFormat
+ * Compiles format string. Millisecond fields (z, zzz) are replaced by quoted
+ * marker characters, everything else is left to QDateTime::toString() which
+ * is called once per second.
+ *
+ * @param format Format string, see QDateTime::toString().
+ */
+void TimestampFormatter::setFormat(const QString &format)
+{
+    m_format = format;
+    m_compiledFormat.clear();
+    m_compiledFormat.reserve(format.size() + 8);
+
+    bool quoted = false;
+    int i = 0;
+    while (i < format.size())
+    {
+        QChar c = format.at(i);
+        if (c == QLatin1Char('\''))
+        {
+            quoted = !quoted;
+            m_compiledFormat.append(c);
+            i++;
+        }
+        else if (!quoted && c == QLatin1Char('z'))
+        {
+            int repeat = 1;
+            while (i + repeat < format.size() && repeat < 3 && format.at(i + repeat) == QLatin1Char('z'))
+            {
+                repeat++;
+            }
+            m_compiledFormat.append(QLatin1Char('\''));
+            if (repeat == 3)
+            {
+                m_compiledFormat.append(QLatin1Char(markerZzz));
+                i += 3;
+            }
+            else
+            {
+                m_compiledFormat.append(QLatin1Char(markerZ));
+                i++;
+            }
+            m_compiledFormat.append(QLatin1Char('\''));
+        }
+        else
+        {
+            m_compiledFormat.append(c);
+            i++;
+        }
+    }
+
+    /* Invalidate cache */
+    m_rendered.clear();
+    m_segmentEnd.clear();
+    m_segmentField.clear();
+    m_renderedSecond = 0;
+}
+
+/**
+ * @brief TimestampFormatter::render
+ * Renders all fields except milliseconds and splits the result to segments
+ * at the millisecond fields.
+ *
+ * @param second Seconds since epoch.
+ */
+void TimestampFormatter::render(qint64 second)
+{
+    QByteArray rendered = QDateTime::fromMSecsSinceEpoch(second * 1000).toString(m_compiledFormat).toLocal8Bit();
+
+    m_rendered.clear();
+    m_segmentEnd.clear();
+    m_segmentField.clear();
+    for (int i = 0; i < rendered.size(); i++)
+    {
+        char c = rendered.at(i);
+        if (c == markerZzz || c == markerZ)
+        {
+            m_segmentEnd.append(m_rendered.size());
+            m_segmentField.append(c == markerZzz ? FIELD_zzz : FIELD_z);
+        }
+        else
+        {
+            m_rendered.append(c);
+        }
+    }
+    m_segmentEnd.append(m_rendered.size());
+    m_segmentField.append(FIELD_none);
+    m_renderedSecond = second;
+}
+
+/**
+ * @brief TimestampFormatter::append
+ * Appends formatted timestamp to buffer.
+ *
+ * @param buf Timestamp is appended to this buffer.
+ * @param msecsSinceEpoch Time to format.
+ */
+void TimestampFormatter::append(QByteArray &buf, qint64 msecsSinceEpoch)
+{
+    qint64 second = msecsSinceEpoch / 1000;
+    int msec = static_cast<int>(msecsSinceEpoch % 1000);
+    if (msec < 0)
+    {
+        second--;
+        msec += 1000;
+    }
+    if (second != m_renderedSecond || m_segmentEnd.isEmpty())
+    {
+        render(second);
+    }
+
+    int oldSize = buf.size();
+    buf.resize(oldSize + m_rendered.size() + 3 * (m_segmentEnd.size() - 1));
+    char *p = buf.data() + oldSize;
+    const char *rendered = m_rendered.constData();
+    int start = 0;
+    for (int i = 0; i < m_segmentEnd.size(); i++)
+    {
+        int end = m_segmentEnd.at(i);
+        memcpy(p, rendered + start, static_cast<size_t>(end - start));
+        p += end - start;
+        start = end;
+        switch (m_segmentField.at(i))
+        {
+            case FIELD_zzz:
+                *p++ = static_cast<char>('0' + msec / 100);
+                *p++ = static_cast<char>('0' + msec / 10 % 10);
+                *p++ = static_cast<char>('0' + msec % 10);
+                break;
+            case FIELD_z:
+                if (msec >= 100)
+                {
+                    *p++ = static_cast<char>('0' + msec / 100);
+                }
+                if (msec >= 10)
+                {
+                    *p++ = static_cast<char>('0' + msec / 10 % 10);
+                }
+                *p++ = static_cast<char>('0' + msec % 10);
+                break;
+            case FIELD_none:
+                break;
+        }
+    }
+    buf.resize(static_cast<int>(p - buf.constData()));
+}
+
+/**
+ * @brief TimestampFormatter::appendCurrent
+ * Appends current time to buffer.
+ *
+ * @param buf Timestamp is appended to this buffer.
+ */
+void TimestampFormatter::appendCurrent(QByteArray &buf)
+{
+    append(buf, QDateTime::currentMSecsSinceEpoch());
+}
+
+QByteArray TimestampFormatter::toByteArray(qint64 msecsSinceEpoch)
+{
+    QByteArray buf;
+    append(buf, msecsSinceEpoch);
+    return buf;
+}
@@ -0,0 +1,54 @@
+/****************************************************************************
+**
+** iSerTerm - RS-232 Serial terminal
+** Copyright (C) 2015-2024 Peter Ivanov <ivanovp@gmail.com>
+**
+****************************************************************************/
+#ifndef TIMESTAMPFORMATTER_H
+#define TIMESTAMPFORMATTER_H
+
+#include <QtGlobal>
+#include <QByteArray>
+#include <QString>
+#include <QVector>
+
+/**
+ * @brief The TimestampFormatter class
+ * Formats timestamps like QDateTime::toString(), but the format string is
+ * compiled only once. Everything except the milliseconds is rendered once
+ * per second and reused, so formatting a timestamp within the same second
+ * is only copying bytes and writing the millisecond digits.
+ * Not thread-safe: each thread shall use its own instance.
+ */
+class TimestampFormatter
+{
+public:
+    explicit TimestampFormatter(const QString &format = "HH:mm:ss.zzz ");
+
+    QString format() const;
+    void setFormat(const QString &format);
+
+    void append(QByteArray &buf, qint64 msecsSinceEpoch);
+    void appendCurrent(QByteArray &buf);
+    QByteArray toByteArray(qint64 msecsSinceEpoch);
+
+private:
+    typedef enum
+    {
+        FIELD_none,             /**< Segment is not followed by a field. */
+        FIELD_z,                /**< Milliseconds without leading zeroes. */
+        FIELD_zzz               /**< Milliseconds, three digits. */
+    } field_t;
+
+    void render(qint64 second);
+
+    QString m_format;
+    /** m_format with millisecond fields replaced by marker characters. */
+    QString m_compiledFormat;
+    qint64 m_renderedSecond;            /**< Seconds since epoch of m_rendered. */
+    QByteArray m_rendered;              /**< Rendered timestamp without milliseconds. */
+    QVector<int> m_segmentEnd;          /**< End of each segment in m_rendered. */
+    QVector<field_t> m_segmentField;    /**< Field which follows each segment. */
+};
+
+#endif // TIMESTAMPFORMATTER_H